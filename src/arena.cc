@@ -0,0 +1,98 @@
+/**
+ * src/arena.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace clang_include_graph {
+
+constexpr std::size_t arena_t::default_block_size;
+constexpr std::size_t arena_t::max_block_size;
+
+arena_t::arena_t(std::size_t block_size)
+    : block_size_{block_size}
+{
+}
+
+void *arena_t::allocate(std::size_t size, std::size_t alignment)
+{
+    void *result = current_;
+    auto space = static_cast<std::size_t>(end_ - current_);
+    if (current_ == nullptr ||
+        std::align(alignment, size, result, space) == nullptr)
+        return allocate_slow(size, alignment);
+
+    current_ = static_cast<char *>(result) + size;
+    return result;
+}
+
+boost::string_view arena_t::store(boost::string_view str)
+{
+    if (str.empty())
+        return {};
+
+    auto *data = static_cast<char *>(allocate(str.size(), 1));
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+void *arena_t::allocate_slow(std::size_t size, std::size_t alignment)
+{
+    // Memory returned by new is aligned for any fundamental type
+    const auto required = size + alignment - 1;
+
+    // Skip blocks kept since the last reset that are too small
+    while (next_block_ < blocks_.size() &&
+        blocks_[next_block_].size < required)
+        next_block_++;
+
+    if (next_block_ == blocks_.size()) {
+        auto block_size = blocks_.empty()
+            ? block_size_
+            : std::min(blocks_.back().size * 2, max_block_size);
+        block_size = std::max(block_size, required);
+
+        blocks_.push_back(
+            {std::unique_ptr<char[]>{new char[block_size]}, block_size});
+    }
+
+    auto &block = blocks_[next_block_++];
+    current_ = block.data.get();
+    end_ = current_ + block.size;
+
+    return allocate(size, alignment);
+}
+
+void arena_t::reset() noexcept
+{
+    next_block_ = 0;
+    current_ = nullptr;
+    end_ = nullptr;
+}
+
+std::size_t arena_t::capacity() const noexcept
+{
+    std::size_t result{0};
+    for (const auto &block : blocks_)
+        result += block.size;
+    return result;
+}
+
+} // namespace clang_include_graph
@@ -0,0 +1,132 @@
+/**
+ * src/arena.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_ARENA_H
+#define CLANG_INCLUDE_GRAPH_ARENA_H
+
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Monotonic arena, which hands out memory from large blocks and frees it
+ * all at once.
+ *
+ * Objects in the arena are never freed one by one, `reset` makes all of
+ * the memory available again while keeping the blocks, so an arena reset
+ * before each translation unit allocates from the heap only while it grows
+ * to fit the largest one. Blocks grow geometrically, an allocation larger
+ * than the maximum block size gets a block of its own. Arenas aren't
+ * thread-safe.
+ */
+class arena_t {
+public:
+    static constexpr std::size_t default_block_size{4096};
+    static constexpr std::size_t max_block_size{1024 * 1024};
+
+    explicit arena_t(std::size_t block_size = default_block_size);
+
+    arena_t(const arena_t &) = delete;
+    arena_t &operator=(const arena_t &) = delete;
+
+    void *allocate(std::size_t size,
+        std::size_t alignment = alignof(std::max_align_t));
+
+    /**
+     * Copy a string to the arena, the copy isn't null-terminated.
+     */
+    boost::string_view store(boost::string_view str);
+
+    /**
+     * Make all of the memory available again, without freeing the blocks.
+     * Objects allocated before aren't destroyed.
+     */
+    void reset() noexcept;
+
+    /**
+     * Total size of the arena's blocks.
+     */
+    std::size_t capacity() const noexcept;
+
+private:
+    struct block_t {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    void *allocate_slow(std::size_t size, std::size_t alignment);
+
+    std::size_t block_size_;
+    std::vector<block_t> blocks_;
+    // Index of the block after the current one
+    std::size_t next_block_{0};
+    char *current_{nullptr};
+    char *end_{nullptr};
+};
+
+/**
+ * Allocator of standard containers using an arena, memory of deallocated
+ * elements is only reclaimed when the arena is reset.
+ */
+template <typename T> class arena_allocator_t {
+public:
+    using value_type = T;
+
+    explicit arena_allocator_t(arena_t &arena) noexcept
+        : arena_{&arena}
+    {
+    }
+
+    template <typename U>
+    arena_allocator_t(const arena_allocator_t<U> &other) noexcept
+        : arena_{other.arena_}
+    {
+    }
+
+    T *allocate(std::size_t n)
+    {
+        return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T * /*p*/, std::size_t /*n*/) noexcept { }
+
+    template <typename U>
+    bool operator==(const arena_allocator_t<U> &other) const noexcept
+    {
+        return arena_ == other.arena_;
+    }
+
+    template <typename U>
+    bool operator!=(const arena_allocator_t<U> &other) const noexcept
+    {
+        return arena_ != other.arena_;
+    }
+
+private:
+    template <typename U> friend class arena_allocator_t;
+
+    arena_t *arena_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_ARENA_H
@@ -24,8 +24,66 @@
 #include <boost/program_options.hpp>
 #include <clang-c/CXCompilationDatabase.h>
 
+#include <algorithm>
+#include <array>
+
 namespace clang_include_graph {
 
+namespace {
+// Options followed by a path, either joined or as a separate argument
+constexpr std::array<const char *, 8> path_options{{"-I", "-isystem",
+    "-iquote", "-idirafter", "-include", "-imacros", "-isysroot",
+    "--sysroot"}};
+
+// Options followed by any other value, either joined or as a separate
+// argument
+constexpr std::array<const char *, 4> value_options{
+    {"-D", "-U", "-x", "-target"}};
+
+// Options with a value joined by '='
+constexpr std::array<const char *, 4> joined_value_options{
+    {"-std=", "--std=", "--target=", "-stdlib="}};
+
+constexpr std::array<const char *, 3> flag_options{
+    {"-nostdinc", "-nostdinc++", "-nostdlibinc"}};
+
+bool starts_with(const std::string &s, const char *prefix)
+{
+    return s.compare(0, std::char_traits<char>::length(prefix), prefix) == 0;
+}
+
+/**
+ * Match option with a value at `args[i]`, advancing `i` if the value is
+ * a separate argument.
+ */
+bool match_value_option(const std::vector<std::string> &args, std::size_t &i,
+    const char *option, std::string &value)
+{
+    const auto &arg = args[i];
+    const auto option_length = std::char_traits<char>::length(option);
+
+    if (arg == option) {
+        if (i + 1 >= args.size())
+            return false;
+        value = args[++i];
+        return true;
+    }
+
+    if (!starts_with(arg, option))
+        return false;
+
+    value = arg.substr(option_length);
+    // Long options are joined with their value by '='
+    if (starts_with(option, "--")) {
+        if (value.empty() || value[0] != '=')
+            return false;
+        value.erase(0, 1);
+    }
+
+    return true;
+}
+} // namespace
+
 std::set<boost::filesystem::path> get_all_files(CXCompilationDatabase database)
 {
     std::set<boost::filesystem::path> result;
@@ -154,4 +212,109 @@ boost::filesystem::path get_canonical_file(CXCompileCommand command)
 
     return weakly_canonical(directory / file);
 }
-} // namespace clang_include_graph
\ No newline at end of file
+
+std::vector<std::string> get_compile_command_arguments(
+    const config_t &config, CXCompileCommand command)
+{
+    std::vector<std::string> args;
+    args.reserve(clang_CompileCommand_getNumArgs(command));
+
+    for (auto i = 0U; i < clang_CompileCommand_getNumArgs(command); i++) {
+        std::string arg{
+            clang_getCString(clang_CompileCommand_getArg(command, i))};
+        args.emplace_back(std::move(arg));
+    }
+
+    if (!config.add_compile_flag().empty()) {
+        args.insert(
+            // Add flags after argv[0]
+            args.begin() + 1, config.add_compile_flag().begin(),
+            config.add_compile_flag().end());
+    }
+
+    for (const auto &flag : config.remove_compile_flag()) {
+        args.erase(std::remove_if(args.begin(), args.end(),
+                       [&flag](const auto &arg) {
+                           return util::match_flag_glob(arg, flag);
+                       }),
+            args.end());
+    }
+
+    return args;
+}
+std::vector<std::string> get_preprocessor_arguments(
+    const std::vector<std::string> &args,
+    const boost::filesystem::path &directory)
+{
+    std::vector<std::string> result;
+
+    if (args.empty())
+        return result;
+
+    // Different compilers have different builtin include directories and
+    // predefined macros
+    result.emplace_back(args[0]);
+
+    // Optimization changes predefined macros such as `__OPTIMIZE__`, which
+    // system headers check, but only optimizing for speed or for size and
+    // not optimizing at all are distinguishable
+    std::string optimization;
+
+    for (std::size_t i = 1; i < args.size(); i++) {
+        const auto &arg = args[i];
+        std::string value;
+
+        if (starts_with(arg, "-O")) {
+            const auto level = arg.substr(2);
+            if (level == "0")
+                optimization.clear();
+            else if (level == "s" || level == "z")
+                optimization = "-Os";
+            else
+                optimization = "-O";
+            continue;
+        }
+
+        if (std::find(flag_options.begin(), flag_options.end(), arg) !=
+            flag_options.end()) {
+            result.emplace_back(arg);
+            continue;
+        }
+
+        if (std::any_of(joined_value_options.begin(),
+                joined_value_options.end(),
+                [&arg](const char *option) {
+                    return starts_with(arg, option);
+                })) {
+            result.emplace_back(arg);
+            continue;
+        }
+
+        auto matched = std::find_if(path_options.begin(), path_options.end(),
+            [&](const char *option) {
+                return match_value_option(args, i, option, value);
+            });
+        if (matched != path_options.end()) {
+            boost::filesystem::path path{value};
+            if (!path.is_absolute())
+                path = (directory / path).lexically_normal();
+
+            result.emplace_back(std::string{*matched} + path.string());
+            continue;
+        }
+
+        matched = std::find_if(value_options.begin(), value_options.end(),
+            [&](const char *option) {
+                return match_value_option(args, i, option, value);
+            });
+        if (matched != value_options.end())
+            result.emplace_back(std::string{*matched} + value);
+    }
+
+    if (!optimization.empty())
+        result.emplace_back(optimization);
+
+    return result;
+}
+
+} // namespace clang_include_graph
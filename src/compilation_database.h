@@ -19,6 +19,7 @@
 #ifndef CLANG_INCLUDE_GRAPH_COMPILATION_DATABASE_H
 #define CLANG_INCLUDE_GRAPH_COMPILATION_DATABASE_H
 
+#include "config.h"
 #include "util.h"
 
 #include <boost/filesystem.hpp>
@@ -27,6 +28,8 @@
 #include <clang-c/CXCompilationDatabase.h>
 
 #include <set>
+#include <string>
+#include <vector>
 
 namespace clang_include_graph {
 
@@ -49,6 +52,26 @@ void filter_blacklist_glob_patterns(
 
 boost::filesystem::path get_canonical_file(CXCompileCommand command);
 
+/**
+ * Get the arguments of a compile command, with the `--add-compile-flag` and
+ * `--remove-compile-flag` options applied.
+ */
+std::vector<std::string> get_compile_command_arguments(
+    const config_t &config, CXCompileCommand command);
+
+/**
+ * Reduce compile command arguments to the compiler and the options which
+ * affect preprocessing (include directories, macro definitions, forced
+ * includes, language standard, target, sysroot and whether optimization is
+ * enabled), so that commands which differ only in e.g. warning, code
+ * generation or output options compare equal. Options with values are
+ * joined with their values and relative paths are resolved against
+ * `directory`.
+ */
+std::vector<std::string> get_preprocessor_arguments(
+    const std::vector<std::string> &args,
+    const boost::filesystem::path &directory);
+
 } // namespace clang_include_graph
 
 #endif // CLANG_INCLUDE_GRAPH_COMPILATION_DATABASE_H
\ No newline at end of file
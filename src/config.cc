@@ -17,9 +17,11 @@
  */
 
 #include "config.h"
+#include "coordinator.h"
 #include "util.h"
 
 #include <boost/filesystem/path.hpp>
+#include <boost/lexical_cast.hpp>
 #include <boost/optional/optional.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -48,6 +50,225 @@ void config_t::init(
         }
     }
 
+    if (vm.count("parse-mode") == 1) {
+        const auto parse_mode_arg = vm["parse-mode"].as<std::string>();
+        if (parse_mode_arg == "full") {
+            parse_mode_ = parse_mode_t::full;
+        }
+        else if (parse_mode_arg == "fast") {
+            parse_mode_ = parse_mode_t::fast;
+        }
+        else if (parse_mode_arg == "compare") {
+            parse_mode_ = parse_mode_t::compare;
+        }
+        else if (parse_mode_arg == "scan") {
+            parse_mode_ = parse_mode_t::scan;
+        }
+        else {
+            std::cerr << "ERROR: Invalid parse mode '" << parse_mode_arg
+                      << "' - aborting..." << '\n';
+            exit(-1);
+        }
+    }
+
+    if (vm.count("schedule") == 1) {
+        const auto schedule_arg = vm["schedule"].as<std::string>();
+        if (schedule_arg == "database") {
+            schedule_ = schedule_t::database;
+        }
+        else if (schedule_arg == "lpt") {
+            schedule_ = schedule_t::lpt;
+        }
+        else if (schedule_arg == "locality") {
+            schedule_ = schedule_t::locality;
+        }
+        else {
+            std::cerr << "ERROR: Invalid schedule '" << schedule_arg
+                      << "' - aborting..." << '\n';
+            exit(-1);
+        }
+    }
+
+    if (vm.count("shared-index") == 1) {
+        shared_index_ = true;
+    }
+
+    if (vm.count("background-priority") == 1) {
+        background_priority_ = true;
+    }
+
+    if (vm.count("worker-processes") == 1) {
+        worker_processes_ = vm["worker-processes"].as<unsigned>();
+#if defined(_WIN32)
+        if (worker_processes_ > 0) {
+            std::cerr << "ERROR: --worker-processes is not supported on "
+                         "Windows - aborting..."
+                      << '\n';
+            exit(-1);
+        }
+#endif
+    }
+
+    if (vm.count("tu-timeout") == 1) {
+        tu_timeout_ = vm["tu-timeout"].as<unsigned>();
+    }
+
+    if (vm.count("cache-dir") == 1) {
+        cache_dir_ = util::to_absolute_path(vm["cache-dir"].as<std::string>());
+    }
+
+    if (vm.count("cache-size-limit") == 1) {
+        cache_size_limit_ = vm["cache-size-limit"].as<unsigned>();
+    }
+
+    if (vm.count("watch") == 1) {
+#if !defined(__linux__)
+        std::cerr << "ERROR: --watch is only supported on Linux - aborting..."
+                  << '\n';
+        exit(-1);
+#endif
+        watch_ = true;
+    }
+
+    if (vm.count("max-memory") == 1) {
+        const auto max_memory_arg = vm["max-memory"].as<std::string>();
+        if (max_memory_arg == "auto") {
+            max_memory_ = 0;
+        }
+        else {
+            try {
+                max_memory_ = boost::lexical_cast<unsigned>(max_memory_arg);
+            }
+            catch (const boost::bad_lexical_cast & /*e*/) {
+                max_memory_.reset();
+            }
+
+            if (!max_memory_ || *max_memory_ == 0) {
+                std::cerr << "ERROR: Invalid memory limit '" << max_memory_arg
+                          << "' - aborting..." << '\n';
+                exit(-1);
+            }
+        }
+
+        if (worker_processes_ > 0) {
+            std::cerr << "ERROR: --max-memory cannot be used with "
+                         "--worker-processes - aborting..."
+                      << '\n';
+            exit(-1);
+        }
+    }
+
+    if (vm.count("shard") == 1) {
+        const auto shard_arg = vm["shard"].as<std::string>();
+        const auto separator = shard_arg.find('/');
+
+        shard_t shard;
+        try {
+            shard.number =
+                boost::lexical_cast<unsigned>(shard_arg.substr(0, separator));
+            shard.count =
+                boost::lexical_cast<unsigned>(shard_arg.substr(separator + 1));
+        }
+        catch (const boost::bad_lexical_cast & /*e*/) {
+            shard.count = 0;
+        }
+
+        if (separator == std::string::npos || shard.number == 0 ||
+            shard.number > shard.count) {
+            std::cerr << "ERROR: Invalid shard '" << shard_arg
+                      << "', expected <number>/<count> - aborting..." << '\n';
+            exit(-1);
+        }
+
+        if (watch_) {
+            std::cerr << "ERROR: --shard cannot be used with --watch"
+                      << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        shard_ = shard;
+    }
+
+    if (vm.count("coordinator") + vm.count("worker") > 1) {
+        std::cerr << "ERROR: --coordinator and --worker cannot be enabled at "
+                     "the same time - aborting..."
+                  << '\n';
+        exit(-1);
+    }
+
+    for (const auto *option : {"coordinator", "worker"}) {
+        if (vm.count(option) == 0)
+            continue;
+
+        const auto endpoint = vm[option].as<std::string>();
+#if defined(_WIN32)
+        std::cerr << "ERROR: --" << option
+                  << " is not supported on Windows - aborting..." << '\n';
+        exit(-1);
+#endif
+        if (!parse_endpoint(endpoint)) {
+            std::cerr << "ERROR: Invalid endpoint '" << endpoint
+                      << "', expected <host>:<port> or unix:<path>"
+                      << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        if (watch_ || worker_processes_ > 0) {
+            std::cerr << "ERROR: --" << option
+                      << " cannot be used with --watch or --worker-processes"
+                      << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        if (std::string{option} == "coordinator")
+            coordinator_ = endpoint;
+        else
+            worker_ = endpoint;
+    }
+
+    if (vm.count("partial-graph") == 1) {
+        for (const auto &partial_graph :
+            vm["partial-graph"].as<std::vector<std::string>>()) {
+            partial_graphs_.emplace_back(
+                util::to_absolute_path(partial_graph));
+        }
+    }
+
+    if (vm.count("save-graph") == 1) {
+        if (shard_ || worker_) {
+            std::cerr << "ERROR: --save-graph cannot be used with --shard or "
+                         "--worker - aborting..."
+                      << '\n';
+            exit(-1);
+        }
+
+        save_graph_ =
+            util::to_absolute_path(vm["save-graph"].as<std::string>());
+    }
+
+    if (vm.count("load-graph") == 1) {
+        if (watch_ || shard_ || coordinator_ || worker_ ||
+            !partial_graphs_.empty()) {
+            std::cerr << "ERROR: --load-graph cannot be used with --watch, "
+                         "--shard, --coordinator, --worker or merge"
+                      << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        load_graph_ =
+            util::to_absolute_path(vm["load-graph"].as<std::string>());
+    }
+
+    if (vm.count("one-config-per-file") == 1) {
+        one_config_per_file_ = true;
+    }
+
+    if (tu_timeout_ > 0 && worker_processes_ == 0) {
+        std::cerr << "ERROR: --tu-timeout requires --worker-processes"
+                  << " - aborting..." << '\n';
+        exit(-1);
+    }
+
     if (vm.count("compilation-database-dir") == 1) {
         compilation_database_directory_ = util::to_absolute_path(
             vm["compilation-database-dir"].as<std::string>());
@@ -66,6 +287,15 @@ void config_t::init(
         exit(-1);
     }
 
+    if (vm.count("timings-file") == 1) {
+        timings_file_ =
+            util::to_absolute_path(vm["timings-file"].as<std::string>());
+    }
+    else if (schedule_ != schedule_t::database) {
+        timings_file_ =
+            *compilation_database_directory_ / ".clang-include-graph-timings";
+    }
+
     if (vm.count("relative-to") == 1) {
         relative_to_ =
             util::to_absolute_path(vm["relative-to"].as<std::string>());
@@ -245,6 +475,144 @@ unsigned config_t::jobs() const noexcept { return jobs_; }
 
 void config_t::jobs(unsigned j) noexcept { jobs_ = j; }
 
+parse_mode_t config_t::parse_mode() const noexcept { return parse_mode_; }
+
+void config_t::parse_mode(parse_mode_t pm) noexcept { parse_mode_ = pm; }
+
+bool config_t::shared_index() const noexcept { return shared_index_; }
+
+void config_t::shared_index(bool si) noexcept { shared_index_ = si; }
+
+bool config_t::background_priority() const noexcept
+{
+    return background_priority_;
+}
+
+void config_t::background_priority(bool bp) noexcept
+{
+    background_priority_ = bp;
+}
+
+unsigned config_t::worker_processes() const noexcept
+{
+    return worker_processes_;
+}
+
+void config_t::worker_processes(unsigned wp) noexcept
+{
+    worker_processes_ = wp;
+}
+
+unsigned config_t::tu_timeout() const noexcept { return tu_timeout_; }
+
+void config_t::tu_timeout(unsigned t) noexcept { tu_timeout_ = t; }
+
+const boost::optional<boost::filesystem::path> &
+config_t::cache_dir() const noexcept
+{
+    return cache_dir_;
+}
+
+void config_t::cache_dir(const boost::filesystem::path &cd) { cache_dir_ = cd; }
+
+unsigned config_t::cache_size_limit() const noexcept
+{
+    return cache_size_limit_;
+}
+
+void config_t::cache_size_limit(unsigned csl) noexcept
+{
+    cache_size_limit_ = csl;
+}
+
+bool config_t::watch() const noexcept { return watch_; }
+
+void config_t::watch(bool w) noexcept { watch_ = w; }
+
+bool config_t::one_config_per_file() const noexcept
+{
+    return one_config_per_file_;
+}
+
+void config_t::one_config_per_file(bool ocpf) noexcept
+{
+    one_config_per_file_ = ocpf;
+}
+
+schedule_t config_t::schedule() const noexcept { return schedule_; }
+
+void config_t::schedule(schedule_t s) noexcept { schedule_ = s; }
+
+const boost::optional<boost::filesystem::path> &
+config_t::timings_file() const noexcept
+{
+    return timings_file_;
+}
+
+void config_t::timings_file(const boost::filesystem::path &tf)
+{
+    timings_file_ = tf;
+}
+
+const boost::optional<unsigned> &config_t::max_memory() const noexcept
+{
+    return max_memory_;
+}
+
+void config_t::max_memory(unsigned mm) { max_memory_ = mm; }
+
+const boost::optional<shard_t> &config_t::shard() const noexcept
+{
+    return shard_;
+}
+
+void config_t::shard(const shard_t &s) { shard_ = s; }
+
+const boost::optional<std::string> &config_t::coordinator() const noexcept
+{
+    return coordinator_;
+}
+
+void config_t::coordinator(const std::string &endpoint)
+{
+    coordinator_ = endpoint;
+}
+
+const boost::optional<std::string> &config_t::worker() const noexcept
+{
+    return worker_;
+}
+
+void config_t::worker(const std::string &endpoint) { worker_ = endpoint; }
+
+const std::vector<boost::filesystem::path> &
+config_t::partial_graphs() const noexcept
+{
+    return partial_graphs_;
+}
+
+const boost::optional<boost::filesystem::path> &
+config_t::save_graph() const noexcept
+{
+    return save_graph_;
+}
+
+void config_t::save_graph(const boost::filesystem::path &sg)
+{
+    save_graph_ = sg;
+}
+
+const boost::optional<boost::filesystem::path> &
+config_t::load_graph() const noexcept
+{
+    return load_graph_;
+}
+
+void config_t::load_graph(const boost::filesystem::path &lg)
+{
+    load_graph_ = lg;
+}
+
 const std::vector<std::string> &config_t::add_compile_flag() const noexcept
 {
     return add_compile_flag_;
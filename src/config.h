@@ -42,6 +42,28 @@ enum class printer_t : std::uint8_t {
     unknown
 };
 
+enum class parse_mode_t : std::uint8_t {
+    full,    // Complete semantic analysis of each translation unit
+    fast,    // Skip function bodies, template instantiation and diagnostics
+    compare, // Use fast mode, but also time full mode for comparison
+    scan,    // Evaluate only preprocessor directives, fall back to fast mode
+};
+
+enum class schedule_t : std::uint8_t {
+    database, // Compilation database order
+    lpt,      // Longest expected parse time first
+    locality, // Grouped by directory, largest groups first
+};
+
+/**
+ * Subset of translation units parsed by a single run, selected with
+ * `--shard=<number>/<count>`.
+ */
+struct shard_t {
+    unsigned number{1};
+    unsigned count{1};
+};
+
 struct json_printer_opts_t {
     bool numeric_ids{false};
 };
@@ -91,6 +113,66 @@ public:
     unsigned jobs() const noexcept;
     void jobs(unsigned j) noexcept;
 
+    parse_mode_t parse_mode() const noexcept;
+    void parse_mode(parse_mode_t pm) noexcept;
+
+    bool shared_index() const noexcept;
+    void shared_index(bool si) noexcept;
+
+    bool background_priority() const noexcept;
+    void background_priority(bool bp) noexcept;
+
+    unsigned worker_processes() const noexcept;
+    void worker_processes(unsigned wp) noexcept;
+
+    unsigned tu_timeout() const noexcept;
+    void tu_timeout(unsigned t) noexcept;
+
+    const boost::optional<boost::filesystem::path> &cache_dir() const noexcept;
+    void cache_dir(const boost::filesystem::path &cd);
+
+    unsigned cache_size_limit() const noexcept;
+    void cache_size_limit(unsigned csl) noexcept;
+
+    bool watch() const noexcept;
+    void watch(bool w) noexcept;
+
+    bool one_config_per_file() const noexcept;
+    void one_config_per_file(bool ocpf) noexcept;
+
+    schedule_t schedule() const noexcept;
+    void schedule(schedule_t s) noexcept;
+
+    const boost::optional<boost::filesystem::path> &
+    timings_file() const noexcept;
+    void timings_file(const boost::filesystem::path &tf);
+
+    const boost::optional<unsigned> &max_memory() const noexcept;
+    void max_memory(unsigned mm);
+
+    const boost::optional<shard_t> &shard() const noexcept;
+    void shard(const shard_t &s);
+
+    const boost::optional<std::string> &coordinator() const noexcept;
+    void coordinator(const std::string &endpoint);
+
+    const boost::optional<std::string> &worker() const noexcept;
+    void worker(const std::string &endpoint);
+
+    /**
+     * Partial include graphs combined by the `merge` command.
+     */
+    const std::vector<boost::filesystem::path> &
+    partial_graphs() const noexcept;
+
+    const boost::optional<boost::filesystem::path> &
+    save_graph() const noexcept;
+    void save_graph(const boost::filesystem::path &sg);
+
+    const boost::optional<boost::filesystem::path> &
+    load_graph() const noexcept;
+    void load_graph(const boost::filesystem::path &lg);
+
     const std::vector<std::string> &add_compile_flag() const noexcept;
 
     const std::vector<std::string> &remove_compile_flag() const noexcept;
@@ -119,6 +201,27 @@ private:
     json_printer_opts_t json_printer_opts_;
     printer_t printer_{printer_t::topological_sort};
     unsigned jobs_{std::thread::hardware_concurrency()};
+    parse_mode_t parse_mode_{parse_mode_t::full};
+    bool shared_index_{false};
+    bool background_priority_{false};
+    unsigned worker_processes_{0};
+    unsigned tu_timeout_{0};
+    boost::optional<boost::filesystem::path> cache_dir_;
+    // In megabytes
+    unsigned cache_size_limit_{1024};
+    bool watch_{false};
+    bool one_config_per_file_{false};
+    schedule_t schedule_{schedule_t::database};
+    boost::optional<boost::filesystem::path> timings_file_;
+    // In megabytes, 0 selects the limit based on available memory
+    boost::optional<unsigned> max_memory_;
+    boost::optional<shard_t> shard_;
+    // Endpoints in the `<host>:<port>` or `unix:<path>` form
+    boost::optional<std::string> coordinator_;
+    boost::optional<std::string> worker_;
+    std::vector<boost::filesystem::path> partial_graphs_;
+    boost::optional<boost::filesystem::path> save_graph_;
+    boost::optional<boost::filesystem::path> load_graph_;
     std::vector<std::string> add_compile_flag_;
     std::vector<std::string> remove_compile_flag_;
     std::string cli_arguments_;
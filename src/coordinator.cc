@@ -0,0 +1,504 @@
+/**
+ * src/coordinator.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "coordinator.h"
+#include "include_graph_parser.h"
+#include "util.h"
+#include "worker_message.h"
+
+#include <algorithm>
+
+namespace clang_include_graph {
+
+boost::optional<endpoint_t> parse_endpoint(const std::string &endpoint)
+{
+    endpoint_t result;
+
+    if (endpoint.compare(0, 5, "unix:") == 0) {
+        result.unix_path = endpoint.substr(5);
+        if (result.unix_path.empty())
+            return {};
+        return result;
+    }
+
+    const auto separator = endpoint.rfind(':');
+    if (separator == std::string::npos)
+        return {};
+
+    result.host = endpoint.substr(0, separator);
+    result.port = endpoint.substr(separator + 1);
+
+    // IPv6 addresses are enclosed in brackets, e.g. `[::1]:4000`
+    if (result.host.size() >= 2 && result.host.front() == '[' &&
+        result.host.back() == ']')
+        result.host = result.host.substr(1, result.host.size() - 2);
+
+    if (result.port.empty() ||
+        !std::all_of(result.port.begin(), result.port.end(),
+            [](char c) { return c >= '0' && c <= '9'; }))
+        return {};
+
+    return result;
+}
+
+std::string endpoint_t::to_string() const
+{
+    if (!unix_path.empty())
+        return "unix:" + unix_path;
+
+    if (host.find(':') != std::string::npos)
+        return "[" + host + "]:" + port;
+
+    return host + ":" + port;
+}
+
+} // namespace clang_include_graph
+
+#if !defined(_WIN32)
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <utility>
+
+namespace clang_include_graph {
+
+namespace {
+/**
+ * Detect hosts which went down without closing their connections within
+ * about half a minute, instead of the system default of hours.
+ */
+void enable_keepalive(int fd)
+{
+    int enabled{1};
+    setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &enabled, sizeof(enabled));
+#if defined(TCP_KEEPIDLE) && defined(TCP_KEEPINTVL) && defined(TCP_KEEPCNT)
+    int idle_s{10};
+    int interval_s{5};
+    int count{3};
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle_s, sizeof(idle_s));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval_s, sizeof(interval_s));
+    setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+#endif
+}
+
+bool make_unix_address(const std::string &path, sockaddr_un &address)
+{
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+/**
+ * Resolve TCP endpoint and call `f` for each address until it returns a
+ * valid socket.
+ */
+template <typename F>
+int for_each_address(const endpoint_t &endpoint, bool passive, F f)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (passive)
+        hints.ai_flags = AI_PASSIVE;
+
+    const char *host = nullptr;
+    if (!endpoint.host.empty())
+        host = endpoint.host.c_str();
+    else if (!passive)
+        host = "localhost";
+
+    addrinfo *addresses{nullptr};
+    const auto error =
+        getaddrinfo(host, endpoint.port.c_str(), &hints, &addresses);
+    if (error != 0) {
+        LOG(warning) << "Cannot resolve " << endpoint.to_string() << ": "
+                     << gai_strerror(error);
+        return -1;
+    }
+
+    int fd{-1};
+    for (auto *address = addresses; address != nullptr && fd < 0;
+         address = address->ai_next) {
+        fd = f(*address);
+    }
+
+    freeaddrinfo(addresses);
+
+    return fd;
+}
+
+int connect_to(const endpoint_t &endpoint)
+{
+    if (!endpoint.unix_path.empty()) {
+        sockaddr_un address{};
+        if (!make_unix_address(endpoint.unix_path, address))
+            return -1;
+
+        const auto fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+
+        if (connect(fd, reinterpret_cast<const sockaddr *>(&address),
+                sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+
+        return fd;
+    }
+
+    return for_each_address(endpoint, false, [](const addrinfo &address) {
+        const auto fd = socket(address.ai_family,
+            address.ai_socktype | SOCK_CLOEXEC, address.ai_protocol);
+        if (fd < 0)
+            return -1;
+
+        if (connect(fd, address.ai_addr, address.ai_addrlen) != 0) {
+            close(fd);
+            return -1;
+        }
+
+        enable_keepalive(fd);
+
+        return fd;
+    });
+}
+} // namespace
+
+coordinator_t::coordinator_t(const endpoint_t &endpoint)
+    : endpoint_{endpoint}
+{
+    if (!endpoint_.unix_path.empty()) {
+        sockaddr_un address{};
+        if (make_unix_address(endpoint_.unix_path, address)) {
+            // Remove the socket left behind by a previous coordinator
+            unlink(endpoint_.unix_path.c_str());
+
+            listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (listen_fd_ >= 0 &&
+                (bind(listen_fd_, reinterpret_cast<const sockaddr *>(&address),
+                     sizeof(address)) != 0 ||
+                    listen(listen_fd_, SOMAXCONN) != 0)) {
+                close(listen_fd_);
+                listen_fd_ = -1;
+            }
+        }
+    }
+    else {
+        listen_fd_ =
+            for_each_address(endpoint_, true, [](const addrinfo &address) {
+                const auto fd = socket(address.ai_family,
+                    address.ai_socktype | SOCK_CLOEXEC, address.ai_protocol);
+                if (fd < 0)
+                    return -1;
+
+                int reuse{1};
+                setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+                if (bind(fd, address.ai_addr, address.ai_addrlen) != 0 ||
+                    listen(fd, SOMAXCONN) != 0) {
+                    close(fd);
+                    return -1;
+                }
+
+                return fd;
+            });
+
+        sockaddr_storage address{};
+        socklen_t address_size{sizeof(address)};
+        if (listen_fd_ >= 0 &&
+            getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&address),
+                &address_size) == 0) {
+            const auto port = address.ss_family == AF_INET6
+                ? reinterpret_cast<const sockaddr_in6 *>(&address)->sin6_port
+                : reinterpret_cast<const sockaddr_in *>(&address)->sin_port;
+            endpoint_.port = std::to_string(ntohs(port));
+        }
+    }
+
+    if (listen_fd_ < 0) {
+        LOG(error) << "ERROR: Cannot listen on " << endpoint_.to_string()
+                   << ": " << std::strerror(errno) << " - aborting..." << '\n';
+        exit(-1);
+    }
+}
+
+coordinator_t::~coordinator_t()
+{
+    close(listen_fd_);
+
+    if (!endpoint_.unix_path.empty())
+        unlink(endpoint_.unix_path.c_str());
+}
+
+const endpoint_t &coordinator_t::endpoint() const noexcept
+{
+    return endpoint_;
+}
+
+unsigned coordinator_t::peak_workers() const noexcept { return peak_workers_; }
+
+std::vector<failed_job_t> coordinator_t::run(
+    const std::vector<remote_job_t> &jobs, parse_statistics_t &statistics,
+    const result_handler_t &on_result)
+{
+    std::vector<failed_job_t> failed_jobs;
+
+    // Writing to the connection of a lost worker must not terminate the
+    // coordinator
+    auto *const previous_sigpipe_handler = signal(SIGPIPE, SIG_IGN);
+
+    LOG(info) << "Waiting for workers on " << endpoint_.to_string();
+
+    std::deque<std::size_t> pending_jobs;
+    for (auto i = 0U; i < jobs.size(); i++)
+        pending_jobs.push_back(i);
+
+    std::vector<unsigned> attempts(jobs.size(), 0U);
+    std::vector<connection_t> connections;
+    std::size_t finished_jobs{0};
+
+    const auto close_connection = [&](connection_t &connection) {
+        close(connection.fd);
+        connection.fd = -1;
+
+        if (!connection.busy)
+            return;
+
+        const auto job = connection.job;
+        if (++attempts[job] < max_attempts) {
+            LOG(warning) << "Lost connection to worker parsing "
+                         << jobs[job].tu_path << ", sending it to another "
+                         << "worker";
+            pending_jobs.push_front(job);
+            return;
+        }
+
+        const auto reason = "lost connection to " +
+            std::to_string(max_attempts) + " workers parsing it";
+        LOG(debug) << "Job " << job << " failed: " << reason;
+
+        failed_jobs.push_back({job, reason});
+        finished_jobs++;
+    };
+
+    while (finished_jobs < jobs.size()) {
+        connections.erase(std::remove_if(connections.begin(),
+                              connections.end(),
+                              [](const auto &c) { return c.fd == -1; }),
+            connections.end());
+
+        for (auto &connection : connections) {
+            if (connection.busy || pending_jobs.empty())
+                continue;
+
+            const auto job = pending_jobs.front();
+            pending_jobs.pop_front();
+
+            message_writer_t message;
+            message.write(jobs[job].tu_path);
+            message.write(jobs[job].directory);
+            message.write(static_cast<std::uint64_t>(jobs[job].args.size()));
+            for (const auto &arg : jobs[job].args)
+                message.write(arg);
+
+            connection.busy = true;
+            connection.job = job;
+            connection.job_start = std::chrono::steady_clock::now();
+
+            if (!message.send(connection.fd))
+                close_connection(connection);
+        }
+
+        if (finished_jobs == jobs.size())
+            break;
+
+        // Idle connections are polled too, to notice workers which exit
+        std::vector<pollfd> fds;
+        fds.push_back({listen_fd_, POLLIN, 0});
+        // Closed connections have negative descriptors, which poll ignores
+        for (const auto &connection : connections)
+            fds.push_back({connection.fd, POLLIN, 0});
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LOG(error) << "ERROR: Waiting for workers failed: "
+                       << std::strerror(errno) << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        for (auto i = 1U; i < fds.size(); i++) {
+            auto &connection = connections[i - 1];
+            if (fds[i].revents == 0)
+                continue;
+
+            message_reader_t message;
+            if (!connection.busy || !message.receive(connection.fd)) {
+                close_connection(connection);
+                continue;
+            }
+
+            const auto job = connection.job;
+            connection.busy = false;
+            finished_jobs++;
+
+            const auto success = message.read_uint64() == 1U;
+            read_statistics(message, statistics);
+
+            if (success) {
+                auto edges = read_edges(message);
+                on_result(job, edges,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() -
+                        connection.job_start));
+            }
+            else {
+                const auto reason = message.read_string();
+                LOG(debug) << "Job " << job << " failed: " << reason;
+                failed_jobs.push_back({job, reason});
+            }
+        }
+
+        if (fds[0].revents != 0) {
+            connection_t connection;
+            connection.fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+            if (connection.fd >= 0) {
+                if (endpoint_.unix_path.empty())
+                    enable_keepalive(connection.fd);
+
+                connections.push_back(connection);
+                peak_workers_ = std::max(peak_workers_,
+                    static_cast<unsigned>(connections.size()));
+
+                LOG(info) << "Worker connected, " << connections.size()
+                          << " workers are connected";
+            }
+        }
+    }
+
+    // Workers exit when their connection is closed
+    for (auto &connection : connections)
+        close(connection.fd);
+
+    signal(SIGPIPE, previous_sigpipe_handler);
+
+    std::sort(failed_jobs.begin(), failed_jobs.end(),
+        [](const auto &lhs, const auto &rhs) {
+            return lhs.index < rhs.index;
+        });
+
+    return failed_jobs;
+}
+
+bool run_remote_worker(const endpoint_t &endpoint,
+    std::chrono::seconds connect_timeout, const remote_job_handler_t &handler)
+{
+    // A lost coordinator is reported by failed writes instead
+    signal(SIGPIPE, SIG_IGN);
+
+    // Workers may be started before the coordinator is listening
+    const auto connect_deadline =
+        std::chrono::steady_clock::now() + connect_timeout;
+
+    int fd{-1};
+    for (;;) {
+        fd = connect_to(endpoint);
+        if (fd >= 0)
+            break;
+
+        if (std::chrono::steady_clock::now() >= connect_deadline) {
+            LOG(error) << "ERROR: Cannot connect to coordinator at "
+                       << endpoint.to_string() << ": " << std::strerror(errno);
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+    }
+
+    LOG(debug) << "Connected to coordinator at " << endpoint.to_string();
+
+    bool result{true};
+
+    // The coordinator closes the connection when all jobs are done
+    message_reader_t request;
+    while (request.receive(fd)) {
+        remote_job_t job;
+        job.tu_path = request.read_string();
+        job.directory = request.read_string();
+        const auto args_size = request.read_uint64();
+        for (std::uint64_t i = 0; i < args_size && !request.is_truncated();
+             i++)
+            job.args.emplace_back(request.read_string());
+
+        std::vector<include_edge_t> edges;
+        parse_statistics_t statistics;
+        std::string error;
+        bool success{false};
+
+        try {
+            success = handler(job, edges, statistics, error);
+        }
+        catch (const std::exception &e) {
+            error = e.what();
+        }
+
+        message_writer_t response;
+        response.write(success ? 1U : 0U);
+        write_statistics(response, statistics);
+
+        if (success)
+            write_edges(response, edges);
+        else
+            response.write(error);
+
+        if (!response.send(fd)) {
+            LOG(error) << "ERROR: Lost connection to coordinator at "
+                       << endpoint.to_string();
+            result = false;
+            break;
+        }
+    }
+
+    close(fd);
+
+    return result;
+}
+
+} // namespace clang_include_graph
+
+#endif
@@ -0,0 +1,144 @@
+/**
+ * src/coordinator.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_COORDINATOR_H
+#define CLANG_INCLUDE_GRAPH_COORDINATOR_H
+
+#include "include_graph.h"
+#include "worker_pool.h"
+
+#include <boost/optional.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace clang_include_graph {
+
+struct parse_statistics_t;
+
+/**
+ * Address of a coordinator, either `<host>:<port>` for TCP or
+ * `unix:<path>` for a UNIX domain socket.
+ */
+struct endpoint_t {
+    std::string host;
+    std::string port;
+    std::string unix_path;
+
+    std::string to_string() const;
+};
+
+boost::optional<endpoint_t> parse_endpoint(const std::string &endpoint);
+
+/**
+ * Compile command of a translation unit sent to a remote worker, with the
+ * `--add-compile-flag` and `--remove-compile-flag` options already
+ * applied.
+ */
+struct remote_job_t {
+    std::string tu_path;
+    std::string directory;
+    std::vector<std::string> args;
+};
+
+/**
+ * Distributes jobs to workers connecting over a socket, one job at a time
+ * per connection, so that faster workers get more jobs.
+ *
+ * Workers send back the include edges and parse statistics of each job.
+ * If a connection is lost while its job is in progress, e.g. because the
+ * worker crashed or its host went down, the job is sent to another worker,
+ * unless it was already lost by `max_attempts` workers, in which case it's
+ * reported as failed.
+ *
+ * Only supported on POSIX systems.
+ */
+class coordinator_t {
+public:
+    using result_handler_t = worker_pool_t::result_handler_t;
+
+    /**
+     * Start listening on endpoint, a TCP port 0 selects any free port.
+     */
+    explicit coordinator_t(const endpoint_t &endpoint);
+
+    ~coordinator_t();
+    coordinator_t(const coordinator_t &) = delete;
+    coordinator_t(coordinator_t &&) = delete;
+    coordinator_t &operator=(const coordinator_t &) = delete;
+    coordinator_t &operator=(coordinator_t &&) = delete;
+
+    /**
+     * Endpoint on which the coordinator listens, with the actual port.
+     */
+    const endpoint_t &endpoint() const noexcept;
+
+    /**
+     * Run jobs and wait until all of them complete or fail. Statistics
+     * reported by workers are added to `statistics`. Connections of workers
+     * are closed afterwards, which makes them exit.
+     *
+     * @return Jobs which failed, ordered by job index
+     */
+    std::vector<failed_job_t> run(const std::vector<remote_job_t> &jobs,
+        parse_statistics_t &statistics, const result_handler_t &on_result);
+
+    /**
+     * Largest number of workers connected at the same time.
+     */
+    unsigned peak_workers() const noexcept;
+
+    static constexpr unsigned max_attempts{3};
+
+private:
+    struct connection_t {
+        int fd{-1};
+        bool busy{false};
+        std::size_t job{0};
+        std::chrono::steady_clock::time_point job_start;
+    };
+
+    endpoint_t endpoint_;
+    int listen_fd_{-1};
+    unsigned peak_workers_{0};
+};
+
+/**
+ * Function executed by a worker for each job received from a coordinator.
+ *
+ * @return False and an error message if the job failed
+ */
+using remote_job_handler_t = std::function<bool(const remote_job_t &job,
+    std::vector<include_edge_t> &edges, parse_statistics_t &statistics,
+    std::string &error)>;
+
+/**
+ * Connect to a coordinator, waiting up to `connect_timeout` for it to
+ * start, and run jobs received from it until it closes the connection.
+ *
+ * @return False if the connection couldn't be established or was broken
+ */
+bool run_remote_worker(const endpoint_t &endpoint,
+    std::chrono::seconds connect_timeout, const remote_job_handler_t &handler);
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_COORDINATOR_H
@@ -0,0 +1,184 @@
+/**
+ * src/dag_view.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "dag_view.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace clang_include_graph {
+
+bool dag_view_t::is_kept_edge_t::operator()(std::size_t edge) const
+{
+    return !(*is_back_edge)[edge];
+}
+
+dag_view_t::vertex_id_t dag_view_t::edge_target_t::operator()(
+    std::size_t edge) const noexcept
+{
+    return graph->target(edge);
+}
+
+dag_view_t::dag_view_t(const frozen_graph_t &graph,
+    const std::function<std::string(vertex_id_t)> &path)
+    : dag_view_t{graph, find_back_edges(graph, path)}
+{
+}
+
+dag_view_t::dag_view_t(
+    const frozen_graph_t &graph, std::vector<bool> is_back_edge)
+    : graph_{&graph}
+    , is_back_edge_{std::move(is_back_edge)}
+    , back_edge_count_{static_cast<std::size_t>(
+          std::count(is_back_edge_.begin(), is_back_edge_.end(), true))}
+{
+}
+
+const frozen_graph_t &dag_view_t::graph() const noexcept { return *graph_; }
+
+dag_view_t::vertex_id_t dag_view_t::vertex_count() const noexcept
+{
+    return graph_->vertex_count();
+}
+
+bool dag_view_t::is_back_edge(std::size_t edge) const
+{
+    return is_back_edge_[edge];
+}
+
+std::size_t dag_view_t::back_edge_count() const noexcept
+{
+    return back_edge_count_;
+}
+
+dag_view_t::adjacency_t dag_view_t::out(vertex_id_t v) const
+{
+    const is_kept_edge_t is_kept{&is_back_edge_};
+    const boost::counting_iterator<std::size_t> first{
+        graph_->first_out_edge(v)};
+    const boost::counting_iterator<std::size_t> last{
+        graph_->first_out_edge(v + 1)};
+
+    const edge_target_t target{graph_};
+    return {boost::make_transform_iterator(
+                edge_iterator_t{is_kept, first, last}, target),
+        boost::make_transform_iterator(
+            edge_iterator_t{is_kept, last, last}, target)};
+}
+
+std::vector<dag_view_t::vertex_id_t> dag_view_t::finish_order() const
+{
+    return graph_->finish_order(is_back_edge_);
+}
+
+std::vector<bool> dag_view_t::find_back_edges(const frozen_graph_t &graph,
+    const std::function<std::string(vertex_id_t)> &path)
+{
+    std::vector<bool> result(graph.edge_count(), false);
+
+    const auto component = graph.strong_components();
+
+    std::vector<vertex_id_t> component_size(graph.vertex_count(), 0);
+    for (vertex_id_t v = 0; v < graph.vertex_count(); v++)
+        component_size[component[v]]++;
+
+    // Rank vertices of components with cycles by their paths
+    std::vector<std::pair<std::string, vertex_id_t>> paths;
+    for (vertex_id_t v = 0; v < graph.vertex_count(); v++) {
+        if (component_size[component[v]] > 1)
+            paths.emplace_back(path(v), v);
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<vertex_id_t> rank(graph.vertex_count(), 0);
+    for (std::size_t i = 0; i < paths.size(); i++)
+        rank[paths[i].second] = static_cast<vertex_id_t>(i);
+
+    enum class state_t : std::uint8_t { unvisited, on_stack, finished };
+    std::vector<state_t> state(graph.vertex_count(), state_t::unvisited);
+
+    // Each entry holds a vertex, its edges within the component ordered
+    // by the rank of their targets, and the next of those edges to visit
+    struct entry_t {
+        vertex_id_t vertex;
+        std::vector<std::size_t> edges;
+        std::size_t next_edge;
+    };
+    std::vector<entry_t> stack;
+
+    const auto visit = [&](vertex_id_t v) {
+        entry_t entry{v, {}, 0};
+        for (auto e = graph.first_out_edge(v); e < graph.first_out_edge(v + 1);
+             e++) {
+            const auto target = graph.target(e);
+            if (target == v)
+                result[e] = true;
+            else if (component[target] == component[v])
+                entry.edges.emplace_back(e);
+        }
+        std::sort(entry.edges.begin(), entry.edges.end(),
+            [&graph, &rank](std::size_t lhs, std::size_t rhs) {
+                return rank[graph.target(lhs)] < rank[graph.target(rhs)];
+            });
+
+        state[v] = state_t::on_stack;
+        stack.emplace_back(std::move(entry));
+    };
+
+    // Components are searched from their first vertex by path, the order
+    // in which components are searched doesn't matter
+    for (const auto &root : paths) {
+        if (state[root.second] != state_t::unvisited)
+            continue;
+
+        visit(root.second);
+
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            if (top.next_edge == top.edges.size()) {
+                state[top.vertex] = state_t::finished;
+                stack.pop_back();
+                continue;
+            }
+
+            const auto edge = top.edges[top.next_edge++];
+            const auto target = graph.target(edge);
+            if (state[target] == state_t::on_stack)
+                result[edge] = true;
+            else if (state[target] == state_t::unvisited)
+                visit(target);
+        }
+    }
+
+    // Self includes of vertices outside of cycles
+    for (vertex_id_t v = 0; v < graph.vertex_count(); v++) {
+        if (component_size[component[v]] > 1)
+            continue;
+
+        for (auto e = graph.first_out_edge(v); e < graph.first_out_edge(v + 1);
+             e++) {
+            if (graph.target(e) == v)
+                result[e] = true;
+        }
+    }
+
+    return result;
+}
+
+} // namespace clang_include_graph
@@ -0,0 +1,114 @@
+/**
+ * src/dag_view.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_DAG_VIEW_H
+#define CLANG_INCLUDE_GRAPH_DAG_VIEW_H
+
+#include "frozen_graph.h"
+
+#include <boost/iterator/counting_iterator.hpp>
+#include <boost/iterator/filter_iterator.hpp>
+#include <boost/iterator/transform_iterator.hpp>
+#include <boost/range/iterator_range.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * DAG of a frozen graph, in which include cycles are broken by masking
+ * their back edges instead of copying the remaining edges.
+ *
+ * Edges between strongly connected components are always kept, as they
+ * can't be part of a cycle. Each component with more than one vertex is
+ * searched from the vertex with the first path, following its edges in
+ * the order of their target paths, and the back edges of that search are
+ * masked, along with all self includes. Which edges are masked therefore
+ * depends only on the paths of the vertices, and not on the order in
+ * which the parser threads added them.
+ */
+class dag_view_t {
+public:
+    using vertex_id_t = frozen_graph_t::vertex_id_t;
+
+private:
+    struct is_kept_edge_t {
+        bool operator()(std::size_t edge) const;
+
+        const std::vector<bool> *is_back_edge;
+    };
+
+    struct edge_target_t {
+        vertex_id_t operator()(std::size_t edge) const noexcept;
+
+        const frozen_graph_t *graph;
+    };
+
+    using edge_iterator_t = boost::filter_iterator<is_kept_edge_t,
+        boost::counting_iterator<std::size_t>>;
+
+public:
+    using adjacency_t = boost::iterator_range<
+        boost::transform_iterator<edge_target_t, edge_iterator_t>>;
+
+    /**
+     * Mask the back edges of a frozen graph, which must outlive the view.
+     * `path` is called for vertices in cycles, to order them.
+     */
+    dag_view_t(const frozen_graph_t &graph,
+        const std::function<std::string(vertex_id_t)> &path);
+
+    dag_view_t(const frozen_graph_t &graph, std::vector<bool> is_back_edge);
+
+    const frozen_graph_t &graph() const noexcept;
+
+    vertex_id_t vertex_count() const noexcept;
+
+    /**
+     * Whether an edge of the frozen graph, by its index, is masked.
+     */
+    bool is_back_edge(std::size_t edge) const;
+
+    std::size_t back_edge_count() const noexcept;
+
+    /**
+     * Targets of out edges of a vertex, which aren't back edges.
+     */
+    adjacency_t out(vertex_id_t v) const;
+
+    /**
+     * Vertices in the order in which a depth first search finishes them,
+     * see `frozen_graph_t::finish_order()`.
+     */
+    std::vector<vertex_id_t> finish_order() const;
+
+private:
+    static std::vector<bool> find_back_edges(const frozen_graph_t &graph,
+        const std::function<std::string(vertex_id_t)> &path);
+
+    const frozen_graph_t *graph_;
+    std::vector<bool> is_back_edge_;
+    std::size_t back_edge_count_{0};
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_DAG_VIEW_H
@@ -0,0 +1,137 @@
+/**
+ * src/file_path_cache.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "file_path_cache.h"
+#include "util.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <functional>
+#include <utility>
+
+namespace clang_include_graph {
+
+namespace {
+std::string get_file_name(CXFile file)
+{
+    const CXString cx_file_name = clang_getFileName(file);
+    const char *cstr = clang_getCString(cx_file_name);
+    std::string file_name = (cstr != nullptr) ? cstr : "";
+    clang_disposeString(cx_file_name);
+    return file_name;
+}
+} // namespace
+
+std::size_t file_path_cache_t::file_id_hash_t::operator()(
+    const CXFileUniqueID &id) const noexcept
+{
+    std::size_t seed{0};
+    for (const auto value : id.data) {
+        seed ^= std::hash<unsigned long long>{}(value) + 0x9e3779b9 +
+            (seed << 6U) + (seed >> 2U);
+    }
+    return seed;
+}
+
+bool file_path_cache_t::file_id_equal_t::operator()(
+    const CXFileUniqueID &lhs, const CXFileUniqueID &rhs) const noexcept
+{
+    return lhs.data[0] == rhs.data[0] && lhs.data[1] == rhs.data[1] &&
+        lhs.data[2] == rhs.data[2];
+}
+
+file_path_cache_t::file_path_cache_t(
+    boost::optional<boost::filesystem::path> relative_to)
+    : relative_to_{std::move(relative_to)}
+{
+}
+
+const file_path_t &file_path_cache_t::get(CXFile file)
+{
+    CXFileUniqueID id;
+    const auto has_id = clang_getFileUniqueID(file, &id) == 0;
+
+    std::string file_name;
+    std::size_t shard_index{0};
+
+    if (has_id) {
+        shard_index = file_id_hash_t{}(id) % shards_count;
+    }
+    else {
+        file_name = get_file_name(file);
+
+        shard_index = std::hash<std::string>{}(file_name) % shards_count;
+    }
+
+    auto &shard = shards_[shard_index];
+
+    {
+        const std::lock_guard<std::mutex> guard{shard.mutex};
+
+        if (has_id) {
+            auto it = shard.by_id.find(id);
+            if (it != shard.by_id.end()) {
+                hits_++;
+                return it->second;
+            }
+        }
+        else {
+            auto it = shard.by_name.find(file_name);
+            if (it != shard.by_name.end()) {
+                hits_++;
+                return it->second;
+            }
+        }
+    }
+
+    misses_++;
+
+    if (has_id)
+        file_name = get_file_name(file);
+
+    // Resolve the path without holding the lock, if another thread got
+    // there first its entry is kept
+    auto file_path = make_file_path(file_name);
+
+    const std::lock_guard<std::mutex> guard{shard.mutex};
+
+    if (has_id)
+        return shard.by_id.emplace(id, std::move(file_path)).first->second;
+
+    return shard.by_name.emplace(file_name, std::move(file_path))
+        .first->second;
+}
+
+file_path_t file_path_cache_t::make_file_path(
+    const std::string &file_name) const
+{
+    file_path_t result;
+    result.path =
+        boost::filesystem::weakly_canonical(boost::filesystem::path(file_name))
+            .string();
+    result.is_relative =
+        relative_to_ && util::is_relative(result.path, *relative_to_);
+
+    return result;
+}
+
+std::uint64_t file_path_cache_t::hits() const noexcept { return hits_; }
+
+std::uint64_t file_path_cache_t::misses() const noexcept { return misses_; }
+
+} // namespace clang_include_graph
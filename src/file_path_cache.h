@@ -0,0 +1,98 @@
+/**
+ * src/file_path_cache.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_FILE_PATH_CACHE_H
+#define CLANG_INCLUDE_GRAPH_FILE_PATH_CACHE_H
+
+#include <boost/filesystem/path.hpp>
+#include <boost/optional.hpp>
+#include <clang-c/Index.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace clang_include_graph {
+
+/**
+ * Canonical path of a file and its precomputed properties.
+ */
+struct file_path_t {
+    std::string path;
+    // Whether the path is inside of the `relative_to` directory
+    bool is_relative{false};
+};
+
+/**
+ * Cache of canonical paths of files entered by libclang, shared by all
+ * translation units parsed in the process.
+ *
+ * Files are identified by their unique ID (device, inode and modification
+ * time), which libclang obtains without any additional syscalls, so the
+ * chain of `stat` and `readlink` calls behind `weakly_canonical` runs once
+ * per file instead of once per include directive. Entries are never
+ * removed, so returned references stay valid for the cache's lifetime.
+ */
+class file_path_cache_t {
+public:
+    explicit file_path_cache_t(
+        boost::optional<boost::filesystem::path> relative_to);
+
+    const file_path_t &get(CXFile file);
+
+    std::uint64_t hits() const noexcept;
+
+    std::uint64_t misses() const noexcept;
+
+private:
+    struct file_id_hash_t {
+        std::size_t operator()(const CXFileUniqueID &id) const noexcept;
+    };
+
+    struct file_id_equal_t {
+        bool operator()(const CXFileUniqueID &lhs,
+            const CXFileUniqueID &rhs) const noexcept;
+    };
+
+    // Each shard has its own lock to reduce contention between threads
+    struct shard_t {
+        std::mutex mutex;
+        std::unordered_map<CXFileUniqueID, file_path_t, file_id_hash_t,
+            file_id_equal_t>
+            by_id;
+        // Files for which libclang cannot provide a unique ID
+        std::unordered_map<std::string, file_path_t> by_name;
+    };
+
+    static constexpr std::size_t shards_count{16};
+
+    file_path_t make_file_path(const std::string &file_name) const;
+
+    boost::optional<boost::filesystem::path> relative_to_;
+    std::array<shard_t, shards_count> shards_;
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_FILE_PATH_CACHE_H
@@ -0,0 +1,168 @@
+/**
+ * src/file_watcher.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "file_watcher.h"
+#include "util.h"
+
+#if defined(__linux__)
+
+#include <boost/filesystem/path.hpp>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace clang_include_graph {
+
+namespace {
+constexpr std::uint32_t watch_mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+    IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+} // namespace
+
+file_watcher_t::file_watcher_t()
+    : fd_{inotify_init1(IN_CLOEXEC | IN_NONBLOCK)}
+{
+    if (fd_ < 0) {
+        LOG(error) << "ERROR: Cannot initialize inotify: "
+                   << std::strerror(errno) << " - aborting..." << '\n';
+        exit(-1);
+    }
+}
+
+file_watcher_t::~file_watcher_t() { ::close(fd_); }
+
+void file_watcher_t::add(const std::set<std::string> &files)
+{
+    for (const auto &file : files) {
+        if (!files_.emplace(file).second)
+            continue;
+
+        const auto directory = boost::filesystem::path{file}.parent_path();
+        if (directory.empty() ||
+            !watched_directories_.emplace(directory.string()).second)
+            continue;
+
+        const auto wd = inotify_add_watch(fd_, directory.c_str(), watch_mask);
+        if (wd < 0) {
+            LOG(warning) << "Cannot watch directory " << directory << ": "
+                         << std::strerror(errno);
+            watched_directories_.erase(directory.string());
+            continue;
+        }
+
+        directories_[wd] = directory.string();
+    }
+
+    LOG(info) << "Watching " << files_.size() << " files in "
+              << directories_.size() << " directories for modifications";
+}
+
+std::set<std::string> file_watcher_t::wait(
+    std::chrono::milliseconds quiet_period)
+{
+    std::set<std::string> modified;
+
+    pollfd pfd{fd_, POLLIN, 0};
+
+    // Wait indefinitely for the first relevant event, and then until the
+    // files stop changing, so that saving many files at once or a build
+    // regenerating headers triggers a single update
+    for (;;) {
+        const auto timeout =
+            modified.empty() ? -1 : static_cast<int>(quiet_period.count());
+
+        const auto ready = poll(&pfd, 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LOG(error) << "ERROR: Waiting for file changes failed: "
+                       << std::strerror(errno) << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        if (ready == 0)
+            return modified;
+
+        read_events(modified);
+    }
+}
+
+void file_watcher_t::read_events(std::set<std::string> &modified)
+{
+    alignas(inotify_event) char buffer[16384];
+
+    for (;;) {
+        const auto n = ::read(fd_, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+
+        for (auto offset = 0L; offset < n;) {
+            const auto *event =
+                reinterpret_cast<const inotify_event *>(buffer + offset);
+            offset += static_cast<long>(sizeof(inotify_event) + event->len);
+
+            if ((event->mask & IN_Q_OVERFLOW) != 0U) {
+                LOG(warning) << "Too many file events, assuming all watched "
+                                "files were modified";
+                modified.insert(files_.begin(), files_.end());
+                continue;
+            }
+
+            auto it = directories_.find(event->wd);
+            if (it == directories_.end())
+                continue;
+
+            // The directory itself was removed, watch it again when files
+            // in it are added after the next parse
+            if ((event->mask & IN_IGNORED) != 0U) {
+                for (auto file = files_.begin(); file != files_.end();) {
+                    if (boost::filesystem::path{*file}.parent_path() ==
+                        it->second)
+                        file = files_.erase(file);
+                    else
+                        ++file;
+                }
+                watched_directories_.erase(it->second);
+                directories_.erase(it);
+                continue;
+            }
+
+            if (event->len == 0)
+                continue;
+
+            auto path =
+                (boost::filesystem::path{it->second} / event->name).string();
+            if (files_.count(path) > 0) {
+                LOG(debug) << "File " << path << " modified";
+                modified.emplace(std::move(path));
+            }
+        }
+    }
+}
+
+} // namespace clang_include_graph
+
+#endif // defined(__linux__)
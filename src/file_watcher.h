@@ -0,0 +1,81 @@
+/**
+ * src/file_watcher.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_FILE_WATCHER_H
+#define CLANG_INCLUDE_GRAPH_FILE_WATCHER_H
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <string>
+
+namespace clang_include_graph {
+
+/**
+ * Watches files for modifications using inotify.
+ *
+ * The directories containing the files are watched instead of the files
+ * themselves, so a single watch covers all headers in a directory, and
+ * files which editors save by renaming a new file over them are still
+ * reported.
+ *
+ * Only supported on Linux.
+ */
+class file_watcher_t {
+public:
+    file_watcher_t();
+
+    ~file_watcher_t();
+    file_watcher_t(const file_watcher_t &) = delete;
+    file_watcher_t(file_watcher_t &&) = delete;
+    file_watcher_t &operator=(const file_watcher_t &) = delete;
+    file_watcher_t &operator=(file_watcher_t &&) = delete;
+
+    /**
+     * Start watching files which are not watched yet.
+     *
+     * @param files Absolute, canonical paths of files
+     */
+    void add(const std::set<std::string> &files);
+
+    /**
+     * Block until at least one of the watched files is modified, created or
+     * removed, then keep collecting modified files until no more events
+     * arrive for `quiet_period`.
+     *
+     * @return Paths of modified files
+     */
+    std::set<std::string> wait(std::chrono::milliseconds quiet_period);
+
+private:
+    /**
+     * Read pending events and add watched files they refer to into
+     * `modified`.
+     */
+    void read_events(std::set<std::string> &modified);
+
+    int fd_{-1};
+    // Watch descriptors of watched directories
+    std::map<int, std::string> directories_;
+    std::set<std::string> watched_directories_;
+    std::set<std::string> files_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_FILE_WATCHER_H
@@ -0,0 +1,207 @@
+/**
+ * src/frozen_graph.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "frozen_graph.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace clang_include_graph {
+
+frozen_graph_t::vertex_id_t frozen_graph_t::vertex_count() const noexcept
+{
+    return static_cast<vertex_id_t>(out_offsets_.size() - 1);
+}
+
+std::size_t frozen_graph_t::edge_count() const noexcept
+{
+    return out_targets_.size();
+}
+
+std::size_t frozen_graph_t::edge_index(vertex_id_t from, vertex_id_t to) const
+{
+    const auto targets = out(from);
+    const auto it = std::find(targets.begin(), targets.end(), to);
+    if (it == targets.end())
+        return edge_count();
+
+    return static_cast<std::size_t>(it - out_targets_.data());
+}
+
+std::size_t frozen_graph_t::first_out_edge(vertex_id_t v) const noexcept
+{
+    return out_offsets_[v];
+}
+
+frozen_graph_t::vertex_id_t frozen_graph_t::target(
+    std::size_t edge) const noexcept
+{
+    return out_targets_[edge];
+}
+
+frozen_graph_t::adjacency_t frozen_graph_t::out(vertex_id_t v) const noexcept
+{
+    return {out_targets_.data() + out_offsets_[v],
+        out_targets_.data() + out_offsets_[v + 1]};
+}
+
+frozen_graph_t::adjacency_t frozen_graph_t::in(vertex_id_t v) const noexcept
+{
+    return {in_sources_.data() + in_offsets_[v],
+        in_sources_.data() + in_offsets_[v + 1]};
+}
+
+std::size_t frozen_graph_t::out_degree(vertex_id_t v) const noexcept
+{
+    return out_offsets_[v + 1] - out_offsets_[v];
+}
+
+std::size_t frozen_graph_t::in_degree(vertex_id_t v) const noexcept
+{
+    return in_offsets_[v + 1] - in_offsets_[v];
+}
+
+bool frozen_graph_t::is_system(vertex_id_t v, std::size_t index) const
+{
+    return is_system_[out_offsets_[v] + index];
+}
+
+void frozen_graph_t::build_in_edges()
+{
+    // Count in edges of each vertex, then place sources at the offsets
+    in_offsets_.assign(out_offsets_.size(), 0);
+    for (const auto target : out_targets_)
+        in_offsets_[target + 1]++;
+    for (vertex_id_t v = 0; v < vertex_count(); v++)
+        in_offsets_[v + 1] += in_offsets_[v];
+
+    in_sources_.resize(out_targets_.size());
+    auto next_in_edge = in_offsets_;
+    for (vertex_id_t v = 0; v < vertex_count(); v++) {
+        for (const auto target : out(v))
+            in_sources_[next_in_edge[target]++] = v;
+    }
+}
+
+std::vector<frozen_graph_t::vertex_id_t> frozen_graph_t::finish_order(
+    const std::vector<bool> &is_removed_edge) const
+{
+    std::vector<vertex_id_t> result;
+    result.reserve(vertex_count());
+
+    std::vector<bool> is_visited(vertex_count(), false);
+
+    // Each entry holds a vertex and the offset of its next out edge to
+    // visit, so deep include chains don't overflow the call stack
+    std::vector<std::pair<vertex_id_t, std::uint32_t>> stack;
+
+    for (vertex_id_t root = 0; root < vertex_count(); root++) {
+        if (is_visited[root])
+            continue;
+
+        is_visited[root] = true;
+        stack.emplace_back(root, out_offsets_[root]);
+
+        while (!stack.empty()) {
+            auto &top = stack.back();
+            if (top.second == out_offsets_[top.first + 1]) {
+                result.emplace_back(top.first);
+                stack.pop_back();
+                continue;
+            }
+
+            const auto edge = top.second++;
+            if (!is_removed_edge.empty() && is_removed_edge[edge])
+                continue;
+
+            const auto target = out_targets_[edge];
+            if (!is_visited[target]) {
+                is_visited[target] = true;
+                stack.emplace_back(target, out_offsets_[target]);
+            }
+        }
+    }
+
+    return result;
+}
+
+std::vector<frozen_graph_t::vertex_id_t>
+frozen_graph_t::strong_components() const
+{
+    constexpr auto unvisited = std::numeric_limits<vertex_id_t>::max();
+
+    std::vector<vertex_id_t> component(vertex_count(), unvisited);
+    // Order in which the search visited each vertex, and the lowest
+    // order of a vertex still on the component stack reachable from it
+    std::vector<vertex_id_t> order(vertex_count(), unvisited);
+    std::vector<vertex_id_t> low(vertex_count(), 0);
+    std::vector<vertex_id_t> component_stack;
+    std::vector<std::pair<vertex_id_t, std::uint32_t>> stack;
+
+    vertex_id_t next_order{0};
+    vertex_id_t next_component{0};
+
+    const auto visit = [&](vertex_id_t v) {
+        order[v] = low[v] = next_order++;
+        component_stack.emplace_back(v);
+        stack.emplace_back(v, out_offsets_[v]);
+    };
+
+    for (vertex_id_t root = 0; root < vertex_count(); root++) {
+        if (order[root] != unvisited)
+            continue;
+
+        visit(root);
+
+        while (!stack.empty()) {
+            const auto v = stack.back().first;
+            if (stack.back().second < out_offsets_[v + 1]) {
+                const auto target = out_targets_[stack.back().second++];
+                if (order[target] == unvisited)
+                    visit(target);
+                else if (component[target] == unvisited)
+                    low[v] = std::min(low[v], order[target]);
+                continue;
+            }
+
+            stack.pop_back();
+            if (!stack.empty()) {
+                const auto parent = stack.back().first;
+                low[parent] = std::min(low[parent], low[v]);
+            }
+
+            if (low[v] != order[v])
+                continue;
+
+            // The vertex is the root of a component, which consists of
+            // vertices above it on the component stack
+            vertex_id_t member{0};
+            do {
+                member = component_stack.back();
+                component_stack.pop_back();
+                component[member] = next_component;
+            } while (member != v);
+            next_component++;
+        }
+    }
+
+    return component;
+}
+
+} // namespace clang_include_graph
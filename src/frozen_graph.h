@@ -0,0 +1,151 @@
+/**
+ * src/frozen_graph.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_FROZEN_GRAPH_H
+#define CLANG_INCLUDE_GRAPH_FROZEN_GRAPH_H
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/range/iterator_range.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Read-only copy of a graph in the compressed sparse row layout.
+ *
+ * Out and in edges of all vertices are stored in two contiguous arrays of
+ * 32-bit vertex IDs, indexed by arrays of offsets, and whether each out
+ * edge includes a system header is stored in a bit array. Traversals then
+ * read consecutive memory instead of following the nodes of per-vertex
+ * edge sets. Edges of each vertex keep the order of the source graph, so
+ * traversals visit vertices in the same order.
+ */
+class frozen_graph_t {
+public:
+    using vertex_id_t = std::uint32_t;
+    using adjacency_t = boost::iterator_range<const vertex_id_t *>;
+
+    frozen_graph_t() = default;
+
+    /**
+     * Copy a `boost::adjacency_list` graph, whose vertex descriptors are
+     * indices and whose edges have an `is_system` property.
+     */
+    template <typename Graph> explicit frozen_graph_t(const Graph &graph);
+
+    vertex_id_t vertex_count() const noexcept;
+
+    std::size_t edge_count() const noexcept;
+
+    /**
+     * Index of the edge between two vertices in the order of all out
+     * edges, or `edge_count()` if there's no such edge.
+     */
+    std::size_t edge_index(vertex_id_t from, vertex_id_t to) const;
+
+    /**
+     * Index of the first out edge of a vertex, its out edges are the ones
+     * up to the first out edge of the next vertex.
+     */
+    std::size_t first_out_edge(vertex_id_t v) const noexcept;
+
+    /**
+     * Target of an edge by its index.
+     */
+    vertex_id_t target(std::size_t edge) const noexcept;
+
+    /**
+     * Targets of out edges of a vertex.
+     */
+    adjacency_t out(vertex_id_t v) const noexcept;
+
+    /**
+     * Sources of in edges of a vertex.
+     */
+    adjacency_t in(vertex_id_t v) const noexcept;
+
+    std::size_t out_degree(vertex_id_t v) const noexcept;
+
+    std::size_t in_degree(vertex_id_t v) const noexcept;
+
+    /**
+     * Whether the `index`-th out edge of a vertex includes a system header.
+     */
+    bool is_system(vertex_id_t v, std::size_t index) const;
+
+    /**
+     * Vertices in the order in which a depth first search started from
+     * each unvisited vertex in turn finishes them, which for a DAG is the
+     * reverse topological order of `boost::topological_sort()`. Edges
+     * marked as removed, if any, are skipped.
+     */
+    std::vector<vertex_id_t> finish_order(
+        const std::vector<bool> &is_removed_edge = {}) const;
+
+    /**
+     * Strongly connected component of each vertex. Components are
+     * numbered in the order Tarjan's algorithm finds them, which is a
+     * reverse topological order of the condensation of the graph.
+     */
+    std::vector<vertex_id_t> strong_components() const;
+
+private:
+    /**
+     * Build in edges from out edges, ordered by source like the in edge
+     * sets of `boost::adjacency_list`.
+     */
+    void build_in_edges();
+
+    // `vertex_count() + 1` offsets into the adjacency arrays
+    std::vector<std::uint32_t> out_offsets_{0};
+    std::vector<vertex_id_t> out_targets_;
+    std::vector<std::uint32_t> in_offsets_{0};
+    std::vector<vertex_id_t> in_sources_;
+    std::vector<bool> is_system_;
+};
+
+template <typename Graph>
+frozen_graph_t::frozen_graph_t(const Graph &graph)
+{
+    const auto vertex_count = boost::num_vertices(graph);
+    const auto edge_count = boost::num_edges(graph);
+
+    out_offsets_.reserve(vertex_count + 1);
+    out_targets_.reserve(edge_count);
+    is_system_.reserve(edge_count);
+
+    for (auto v : boost::make_iterator_range(boost::vertices(graph))) {
+        for (auto e :
+            boost::make_iterator_range(boost::out_edges(v, graph))) {
+            out_targets_.emplace_back(
+                static_cast<vertex_id_t>(boost::target(e, graph)));
+            is_system_.push_back(graph[e].is_system);
+        }
+        out_offsets_.emplace_back(
+            static_cast<std::uint32_t>(out_targets_.size()));
+    }
+
+    build_in_edges();
+}
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_FROZEN_GRAPH_H
@@ -20,12 +20,12 @@
 
 #include "config.h"
 
-#include <boost/graph/depth_first_search.hpp>
 #include <boost/graph/labeled_graph.hpp>
-#include <boost/graph/named_function_params.hpp>
 #include <boost/optional/optional.hpp>
 
+#include <chrono>
 #include <string>
+#include <utility>
 
 namespace clang_include_graph {
 
@@ -39,43 +39,148 @@ void include_graph_t::add_edge(const std::string &to, const std::string &from,
     const std::string &include_spelling, bool from_translation_unit,
     bool is_system)
 {
-    const std::lock_guard<std::mutex> guard{mutex_};
+    const auto guard = lock_shared();
 
-    if (graph_.vertex(to) == graph_t::null_vertex()) {
+    add_edge_unlocked(to, from, include_spelling, from_translation_unit,
+        is_system, vertices_.reserve_sequence(2));
+}
+
+void include_graph_t::add_edges(const std::vector<include_edge_t> &edges)
+{
+    if (edges.empty())
+        return;
+
+    const auto guard = lock_shared();
+
+    // Each edge takes the sequence numbers of its target and source vertex
+    auto sequence = vertices_.reserve_sequence(2 * edges.size());
+    for (const auto &edge : edges) {
+        add_edge_unlocked(edge.to, edge.from, edge.include_spelling,
+            edge.from_translation_unit, edge.is_system, sequence);
+        sequence += 2;
+    }
+}
+
+include_graph_t::graph_t::vertex_descriptor include_graph_t::add_vertex(
+    const std::string &file, const std::string &include_spelling,
+    bool is_system_header, bool is_translation_unit)
+{
+    const auto guard = lock();
+
+    flush_unlocked();
+
+    vertex_properties_t::flags_t flags{0U};
+    if (is_system_header)
+        flags |= vertex_properties_t::system_header;
+    if (is_translation_unit)
+        flags |= vertex_properties_t::translation_unit;
+
+    const auto v = boost::add_vertex(graph_.graph());
+    vertex_properties_.push_back(
+        paths_.intern(file), paths_.intern(include_spelling), flags);
+
+    // Indices of the table and the adjacency list stay the same
+    vertices_.insert(file);
+
+    return v;
+}
+
+void include_graph_t::add_edge_between(graph_t::vertex_descriptor from,
+    graph_t::vertex_descriptor to, bool is_system)
+{
+    const auto guard = lock();
+
+    if (is_reversed())
+        std::swap(from, to);
+
+    // Edges of a saved graph are unique, and any edge added again through
+    // the vertex table is ignored by the adjacency list when it's flushed
+    flush_unlocked();
+
+    const auto edge_pair = boost::add_edge(from, to, graph_.graph());
+    if (edge_pair.second)
+        graph_.graph()[edge_pair.first].is_system = is_system;
+}
+
+void include_graph_t::add_edge_unlocked(const std::string &to,
+    const std::string &from, const std::string &include_spelling,
+    bool from_translation_unit, bool is_system, std::uint64_t sequence)
+{
+    const auto to_v = vertices_.emplace(to, sequence);
+    if (to_v.second) {
         LOG(trace) << "Adding target vertex " << to
                    << " [is_system_header=" << is_system
                    << ", include_spelling=" << include_spelling << "]";
 
-        const auto &to_v = boost::add_vertex(to, graph_);
-        graph_.graph()[to_v].file = to;
-        graph_.graph()[to_v].is_system_header = is_system;
-        graph_.graph()[to_v].include_spelling = include_spelling;
+        to_v.first->is_system_header = is_system;
+        to_v.first->include_spelling = include_spelling;
     }
 
-    if (graph_.vertex(from) == graph_t::null_vertex()) {
+    const auto from_v = vertices_.emplace(from, sequence + 1);
+    if (from_v.second) {
         LOG(trace) << "Adding source vertex " << from
                    << " [is_system_header=" << is_system
                    << ", include_spelling=" << include_spelling << "]";
 
-        const auto &from_v = boost::add_vertex(from, graph_);
-        graph_.graph()[from_v].file = from;
-        graph_.graph()[from_v].is_translation_unit = from_translation_unit;
+        from_v.first->is_translation_unit = from_translation_unit;
     }
 
-    std::pair<graph_t::edge_descriptor, bool> edge_pair;
-    if (printer_ == printer_t::reverse_tree ||
-        printer_ == printer_t::dependants) {
-        edge_pair = boost::add_edge_by_label(to, from, graph_);
-    }
-    else {
-        edge_pair = boost::add_edge_by_label(from, to, graph_);
+    if (is_reversed())
+        vertices_.add_edge(*to_v.first, *from_v.first, is_system, sequence);
+    else
+        vertices_.add_edge(*from_v.first, *to_v.first, is_system, sequence);
+}
+
+void include_graph_t::flush() const
+{
+    if (!vertices_.has_pending())
+        return;
+
+    const auto guard = lock();
+
+    flush_unlocked();
+}
+
+void include_graph_t::flush_unlocked() const
+{
+    if (!vertices_.has_pending())
+        return;
+
+    std::vector<
+        std::pair<boost::string_view, const vertex_table_t::vertex_t *>>
+        vertices;
+    std::vector<vertex_table_t::flushed_edge_t> edges;
+    vertices_.flush(vertices, edges);
+
+    // Vertices are added in the order of their indices in the table
+    for (const auto &vertex : vertices) {
+        vertex_properties_t::flags_t flags{0U};
+        if (vertex.second->is_system_header)
+            flags |= vertex_properties_t::system_header;
+        if (vertex.second->is_translation_unit)
+            flags |= vertex_properties_t::translation_unit;
+
+        boost::add_vertex(graph_.graph());
+        vertex_properties_.push_back(paths_.intern(vertex.first),
+            paths_.intern(vertex.second->include_spelling), flags);
     }
 
-    if (edge_pair.second) {
-        graph_.graph()[edge_pair.first].is_system = is_system;
+    // Edges flushed before are added again if repeated later, the
+    // adjacency list keeps the first one
+    for (const auto &edge : edges) {
+        const auto edge_pair =
+            boost::add_edge(edge.from, edge.to, graph_.graph());
+        if (edge_pair.second)
+            graph_.graph()[edge_pair.first].is_system = edge.is_system;
     }
 }
 
+bool include_graph_t::is_reversed() const noexcept
+{
+    return printer_ == printer_t::reverse_tree ||
+        printer_ == printer_t::dependants;
+}
+
 void include_graph_t::init(const config_t &config)
 {
     relative_to_ = config.relative_to();
@@ -89,36 +194,141 @@ void include_graph_t::init(const config_t &config)
     exclude_system_headers_ = config.exclude_system_headers();
 }
 
+std::unique_lock<std::shared_timed_mutex> include_graph_t::lock() const
+{
+    return acquire(std::unique_lock<std::shared_timed_mutex>{
+        mutex_, std::try_to_lock});
+}
+
+std::shared_lock<std::shared_timed_mutex>
+include_graph_t::lock_shared() const
+{
+    return acquire(std::shared_lock<std::shared_timed_mutex>{
+        mutex_, std::try_to_lock});
+}
+
+template <typename Lock> Lock include_graph_t::acquire(Lock lock) const
+{
+    lock_acquisitions_++;
+
+    if (!lock.owns_lock()) {
+        const auto wait_start = std::chrono::steady_clock::now();
+        lock.lock();
+
+        lock_contentions_++;
+        lock_wait_time_us_ += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - wait_start)
+                .count());
+    }
+
+    return lock;
+}
+
+include_graph_t::lock_statistics_t
+include_graph_t::lock_statistics() const noexcept
+{
+    lock_statistics_t result;
+    result.acquisitions = lock_acquisitions_;
+    result.contentions = lock_contentions_;
+    result.wait_time_us = lock_wait_time_us_;
+    return result;
+}
+
+void include_graph_t::clear()
+{
+    const auto guard = lock();
+
+    graph_ = graph_t{};
+    vertex_properties_.clear();
+    paths_.clear();
+    vertices_.clear();
+    dag_.reset();
+    frozen_graph_.reset();
+}
+
 void include_graph_t::build_dag()
 {
-    const std::lock_guard<std::mutex> guard{mutex_};
+    const auto guard = lock();
 
     if (dag_) {
         return;
     }
 
-    dag_ = include_graph_t::graph_t{};
-    const detail::dag_include_graph_visitor_t visitor{*this};
+    flush_unlocked();
+
+    const auto freeze_start = std::chrono::steady_clock::now();
 
-    boost::depth_first_search(graph_, boost::visitor(visitor));
+    frozen_graph_.emplace(graph_.graph());
+    dag_.emplace(*frozen_graph_,
+        [this](frozen_graph_t::vertex_id_t v) { return file(v); });
+
+    LOG(debug) << "Froze include graph with " << frozen_graph_->vertex_count()
+               << " vertices and " << frozen_graph_->edge_count()
+               << " edges, of which " << dag_->back_edge_count()
+               << " are back edges, in "
+               << std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - freeze_start)
+                      .count()
+               << " us";
 }
 
-const boost::optional<include_graph_t::graph_t> &
-include_graph_t::dag() const noexcept
+const boost::optional<dag_view_t> &include_graph_t::dag() const noexcept
 {
     return dag_;
 }
 
-boost::optional<include_graph_t::graph_t> &include_graph_t::dag() noexcept
+const boost::optional<frozen_graph_t> &
+include_graph_t::frozen_graph() const noexcept
 {
-    return dag_;
+    return frozen_graph_;
 }
 
-const include_graph_t::graph_t &include_graph_t::graph() const noexcept
+
+const include_graph_t::graph_t &include_graph_t::graph() const
 {
+    flush();
+
     return graph_;
 }
 
+include_graph_t::graph_t::vertex_descriptor include_graph_t::vertex(
+    const std::string &file) const
+{
+    flush();
+
+    const auto *vertex = vertices_.find(file);
+    if (vertex == nullptr)
+        return graph_t::null_vertex();
+
+    return vertex->index;
+}
+
+std::string include_graph_t::file(graph_t::vertex_descriptor v) const
+{
+    return paths_.path(vertex_properties_.file(v));
+}
+
+std::string include_graph_t::include_spelling(
+    graph_t::vertex_descriptor v) const
+{
+    return paths_.path(vertex_properties_.include_spelling(v));
+}
+
+const vertex_properties_t &include_graph_t::vertex_properties() const
+{
+    flush();
+
+    return vertex_properties_;
+}
+
+const path_table_t &include_graph_t::paths() const
+{
+    flush();
+
+    return paths_;
+}
+
 bool include_graph_t::relative_only() const noexcept { return relative_only_; }
 
 bool include_graph_t::translation_units_only() const noexcept
@@ -20,35 +20,51 @@
 #define CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_H
 
 #include "config.h"
+#include "dag_view.h"
+#include "frozen_graph.h"
+#include "path_table.h"
+#include "vertex_properties.h"
+#include "vertex_table.h"
 
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/labeled_graph.hpp>
-#include <boost/graph/topological_sort.hpp>
 #include <boost/optional.hpp>
 
+#include <atomic>
+#include <cstdint>
 #include <map>
+#include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace clang_include_graph {
 
+/**
+ * Single resolved include directive, as reported by one of the frontends.
+ */
+struct include_edge_t {
+    std::string to;
+    std::string from;
+    std::string include_spelling;
+    bool from_translation_unit{false};
+    bool is_system{false};
+};
+
 class include_graph_t {
 public:
-    struct vertex_t {
-        std::string file;
-        std::string include_spelling;
-        bool is_system_header{false};
-        bool is_translation_unit{false};
-    };
-
     struct edge_t {
         bool is_system{false};
     };
 
+    // Vertex properties are stored in `vertex_properties()` instead
     using graph_adjlist_t = boost::adjacency_list<boost::setS, boost::vecS,
-        boost::bidirectionalS, vertex_t, edge_t>;
+        boost::bidirectionalS, boost::no_property, edge_t>;
+    // Vertices are looked up in the vertex table instead of by their label
     using graph_t =
-        boost::labeled_graph<graph_adjlist_t, std::string, boost::hash_mapS>;
+        boost::labeled_graph<graph_adjlist_t, path_id_t, boost::hash_mapS>;
 
     void add_edge(const std::string &to, const std::string &from,
         bool from_translation_unit = false, bool is_system = false);
@@ -57,15 +73,70 @@ public:
         const std::string &include_spelling, bool from_translation_unit = false,
         bool is_system = false);
 
+    /**
+     * Add all edges of a translation unit while holding the graph lock only
+     * once. The lock is shared by all threads adding edges, which resolve
+     * vertices in the vertex table instead. Added vertices and edges are
+     * moved to the adjacency list when the graph is accessed.
+     */
+    void add_edges(const std::vector<include_edge_t> &edges);
+
+    /**
+     * Add vertex for a file, which must not be in the graph yet. Used to
+     * restore a saved graph, along with `add_edge_between()`.
+     */
+    graph_t::vertex_descriptor add_vertex(const std::string &file,
+        const std::string &include_spelling, bool is_system_header,
+        bool is_translation_unit);
+
+    /**
+     * Add edge from including file to included file, in the direction
+     * required by the printer.
+     */
+    void add_edge_between(graph_t::vertex_descriptor from,
+        graph_t::vertex_descriptor to, bool is_system);
+
     void init(const config_t &config);
 
+    /**
+     * Remove all vertices and edges, along with the DAG built from them.
+     */
+    void clear();
+
+    /**
+     * Freeze the graph, as no more edges are added once printing starts,
+     * and build the DAG without include cycles as a view of it.
+     */
     void build_dag();
 
-    const boost::optional<graph_t> &dag() const noexcept;
+    const boost::optional<dag_view_t> &dag() const noexcept;
+
+    /**
+     * Copy of the graph in the compressed sparse row layout, made by
+     * `build_dag()` for printers traversing it.
+     */
+    const boost::optional<frozen_graph_t> &frozen_graph() const noexcept;
+
+    const graph_t &graph() const;
+
+    /**
+     * Get vertex of a file, or `graph_t::null_vertex()` if the file isn't
+     * in the graph.
+     */
+    graph_t::vertex_descriptor vertex(const std::string &file) const;
 
-    boost::optional<graph_t> &dag() noexcept;
+    std::string file(graph_t::vertex_descriptor v) const;
 
-    const graph_t &graph() const noexcept;
+    std::string include_spelling(graph_t::vertex_descriptor v) const;
+
+    /**
+     * Properties of all vertices, indexed by their descriptors. Paths and
+     * include spellings are interned in `paths()`, and decoded with
+     * `file()` and `include_spelling()`.
+     */
+    const vertex_properties_t &vertex_properties() const;
+
+    const path_table_t &paths() const;
 
     bool relative_only() const noexcept;
 
@@ -87,9 +158,48 @@ public:
 
     const boost::optional<std::string> &title() const noexcept;
 
+    /**
+     * Number of times the graph lock was acquired, either shared or
+     * exclusively, how many of those had to wait for another thread and the
+     * total time spent waiting.
+     */
+    struct lock_statistics_t {
+        std::uint64_t acquisitions{0};
+        std::uint64_t contentions{0};
+        std::uint64_t wait_time_us{0};
+    };
+
+    lock_statistics_t lock_statistics() const noexcept;
+
 private:
-    graph_t graph_;
-    boost::optional<graph_t> dag_;
+    std::unique_lock<std::shared_timed_mutex> lock() const;
+
+    std::shared_lock<std::shared_timed_mutex> lock_shared() const;
+
+    template <typename Lock> Lock acquire(Lock lock) const;
+
+    void add_edge_unlocked(const std::string &to, const std::string &from,
+        const std::string &include_spelling, bool from_translation_unit,
+        bool is_system, std::uint64_t sequence);
+
+    /**
+     * Move vertices and edges added to the vertex table since the last
+     * call to the adjacency list.
+     */
+    void flush() const;
+
+    void flush_unlocked() const;
+
+    bool is_reversed() const noexcept;
+
+    // Filled from `vertices_` on first access after edges are added
+    mutable graph_t graph_;
+    mutable vertex_properties_t vertex_properties_;
+    mutable path_table_t paths_;
+    mutable vertex_table_t vertices_;
+    boost::optional<frozen_graph_t> frozen_graph_;
+    // Refers to `frozen_graph_`
+    boost::optional<dag_view_t> dag_;
     boost::optional<boost::filesystem::path> relative_to_;
     bool relative_only_{false};
     boost::optional<boost::filesystem::path> dependants_of_;
@@ -101,44 +211,12 @@ private:
 
     printer_t printer_{printer_t::unknown};
 
-    std::mutex mutex_;
-};
-
-namespace detail {
-class dag_include_graph_visitor_t : public boost::default_dfs_visitor {
-public:
-    explicit dag_include_graph_visitor_t(include_graph_t &graph)
-        : graph_{graph}
-        , dag_{graph_.dag().value()}
-    {
-    }
-
-    template <typename E, typename G>
-    void tree_edge(E edge, const G &graph) const
-    {
-        boost::add_edge(
-            boost::source(edge, graph), boost::target(edge, graph), dag_);
-    }
-
-    template <typename E, typename G>
-    void forward_or_cross_edge(E edge, const G &graph) const
-    {
-        boost::add_edge(
-            boost::source(edge, graph), boost::target(edge, graph), dag_);
-    }
-
-    template <typename E, typename G>
-    void back_edge(E /*edge*/, const G & /*graph*/) const
-    {
-        // skip
-    }
-
-private:
-    include_graph_t &graph_;
-    include_graph_t::graph_t &dag_;
+    mutable std::shared_timed_mutex mutex_;
+    mutable std::atomic<std::uint64_t> lock_acquisitions_{0};
+    mutable std::atomic<std::uint64_t> lock_contentions_{0};
+    mutable std::atomic<std::uint64_t> lock_wait_time_us_{0};
 };
 
-} // namespace detail
 } // namespace clang_include_graph
 
 #endif // CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_H
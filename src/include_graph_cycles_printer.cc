@@ -34,9 +34,9 @@ void renumber_vertex_indices(
 namespace clang_include_graph {
 namespace detail {
 
-cycle_printer_t::cycle_printer_t(const include_graph_t::graph_t &graph,
+cycle_printer_t::cycle_printer_t(const include_graph_t &include_graph,
     const path_printer_t &pp, std::ostream &stream)
-    : graph_{graph}
+    : include_graph_{include_graph}
     , path_printer_{pp}
     , os{stream}
 {
@@ -47,7 +47,8 @@ void cycle_printer_t::cycle(const Path &p, const Graph & /*g*/)
 {
     os << "[\n";
     for (auto it = p.begin(); it != p.end(); ++it) {
-        os << "  " << path_printer_.print(graph_.graph()[*it]) << "\n";
+        os << "  "
+           << path_printer_.print(include_graph_.file(*it)) << "\n";
     }
     os << "]\n";
 }
@@ -57,7 +58,7 @@ void cycle_printer_t::cycle(const Path &p, const Graph & /*g*/)
 void include_graph_cycles_printer_t::operator()(std::ostream &os) const
 {
     const detail::cycle_printer_t cycle_printer_visitor{
-        include_graph().graph(), path_printer(), os};
+        include_graph(), path_printer(), os};
 
     boost::tiernan_all_cycles(
         include_graph().graph().graph(), cycle_printer_visitor);
@@ -30,14 +30,14 @@ namespace clang_include_graph {
 namespace detail {
 
 struct cycle_printer_t {
-    cycle_printer_t(const include_graph_t::graph_t &graph,
+    cycle_printer_t(const include_graph_t &include_graph,
         const path_printer_t &pp, std::ostream &stream);
 
     template <typename Path, typename Graph>
     void cycle(const Path &p, const Graph & /*g*/);
 
 private:
-    const include_graph_t::graph_t &graph_;
+    const include_graph_t &include_graph_;
     const path_printer_t &path_printer_;
     std::ostream &os;
 };
@@ -18,14 +18,11 @@
 
 #include "include_graph_dependants_printer.h"
 
-#include <boost/graph/detail/adjacency_list.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <boost/graph/labeled_graph.hpp>
-
-#include <algorithm>
 #include <cassert>
-#include <iterator>
+#include <numeric>
 #include <ostream>
+#include <utility>
+#include <vector>
 
 namespace clang_include_graph {
 
@@ -39,58 +36,64 @@ void include_graph_dependants_printer_t::operator()(std::ostream &os) const
 {
     assert(include_graph().dag());
 
-    const auto &dag = include_graph().dag().value().graph();
-    const auto &graph = include_graph().graph().graph();
+    const auto &frozen_graph = include_graph().frozen_graph().value();
 
     const auto &dependants_root = include_graph().dependants_of().value();
 
-    auto vertices_range = boost::vertices(dag);
-    auto it = std::find_if(vertices_range.first, vertices_range.second,
-        [&](include_graph_t::graph_t::vertex_descriptor v) {
-            return graph[v].file == dependants_root;
-        });
+    auto start = include_graph().dag()->vertex_count();
+    for (frozen_graph_t::vertex_id_t v = 0;
+         v < include_graph().dag()->vertex_count(); v++) {
+        if (include_graph().file(v) == dependants_root) {
+            start = v;
+            break;
+        }
+    }
 
-    if (it == vertices_range.second) {
+    if (start == include_graph().dag()->vertex_count()) {
         LOG(error) << "ERROR: Dependants root '" << dependants_root
                    << "' not found.\n";
         return;
     }
 
-    auto start = *it;
+    std::vector<bool> is_dependant(frozen_graph.vertex_count(), false);
+    is_dependant[start] = true;
 
-    std::set<include_graph_t::graph_t::vertex_descriptor> dependants;
-
-    std::set<include_graph_t::graph_t::vertex_descriptor> current_out_set;
-    current_out_set.emplace(start);
+    std::vector<frozen_graph_t::vertex_id_t> current_out_set{start};
 
     // Perform breadth first search over all outgoing edges starting from
     // vertex representing root of dependants tree
     while (!current_out_set.empty()) {
-        std::set<include_graph_t::graph_t::vertex_descriptor> next_out_set;
+        std::vector<frozen_graph_t::vertex_id_t> next_out_set;
 
-        for (const auto &itt : current_out_set) {
-            for (const auto &it : graph.out_edge_list(itt)) {
-                if (dependants.count(it.get_target()) == 0) {
-                    next_out_set.emplace(it.get_target());
+        for (const auto v : current_out_set) {
+            for (const auto target : frozen_graph.out(v)) {
+                if (!is_dependant[target]) {
+                    is_dependant[target] = true;
+                    next_out_set.emplace_back(target);
                 }
             }
         }
 
-        dependants.insert(current_out_set.begin(), current_out_set.end());
-
         std::swap(next_out_set, current_out_set);
     }
 
-    for (const auto &v : dependants) {
-        if (v == start) {
+    std::vector<vertex_properties_t::vertex_index_t> candidates;
+    if (include_graph().translation_units_only()) {
+        candidates = include_graph().vertex_properties().translation_units(
+            frozen_graph.vertex_count());
+    }
+    else {
+        candidates.resize(frozen_graph.vertex_count());
+        std::iota(candidates.begin(), candidates.end(), 0U);
+    }
+
+    for (const auto v : candidates) {
+        if (!is_dependant[v] || v == start) {
             continue;
         }
 
-        if (!include_graph().translation_units_only() ||
-            graph[v].is_translation_unit) {
-            auto dependant_path = path_printer().print(graph[v]);
-            os << dependant_path << '\n';
-        }
+        auto dependant_path = path_printer().print(include_graph().file(v));
+        os << dependant_path << '\n';
     }
 }
 
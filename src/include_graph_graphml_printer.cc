@@ -21,6 +21,7 @@
 #include "path_printer.h"
 
 #include <boost/graph/graphml.hpp>
+#include <boost/property_map/function_property_map.hpp>
 #include <boost/property_map/transform_value_property_map.hpp>
 
 #include <ostream>
@@ -30,6 +31,7 @@ namespace clang_include_graph {
 void include_graph_graphml_printer_t::operator()(std::ostream &os) const
 {
     const auto &printer = path_printer();
+    const auto &graph = include_graph();
 
     boost::dynamic_properties dp;
 
@@ -43,10 +45,12 @@ void include_graph_graphml_printer_t::operator()(std::ostream &os) const
     }
 #endif
 
-    auto file_map = boost::make_transform_value_property_map(
-        [&printer](
-            const include_graph_t::vertex_t &v) { return printer.print(v); },
-        get(boost::vertex_bundle, include_graph().graph()));
+    using vertex_descriptor_t = include_graph_t::graph_t::vertex_descriptor;
+
+    auto file_map = boost::make_function_property_map<vertex_descriptor_t>(
+        [&printer, &graph](vertex_descriptor_t v) {
+            return printer.print(graph.file(v));
+        });
 
     dp.property("file", file_map);
 
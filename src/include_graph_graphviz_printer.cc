@@ -29,22 +29,23 @@ namespace clang_include_graph {
 namespace detail {
 
 label_writer::label_writer(
-    const include_graph_t::graph_t &graph, const path_printer_t &pp)
-    : graph_{graph}
+    const include_graph_t &include_graph, const path_printer_t &pp)
+    : include_graph_{include_graph}
     , path_printer_{pp}
 {
 }
 template <typename Vertex>
 void label_writer::operator()(std::ostream &out, const Vertex &v) const
 {
-    out << "[label=\"" << path_printer_.print(graph_.graph()[v]) << "\"]";
+    out << "[label=\""
+        << path_printer_.print(include_graph_.file(v)) << "\"]";
 }
 
 } // namespace detail
 
 void include_graph_graphviz_printer_t::operator()(std::ostream &os) const
 {
-    const detail::label_writer writer{include_graph().graph(), path_printer()};
+    const detail::label_writer writer{include_graph(), path_printer()};
 
     boost::write_graphviz(os, include_graph().graph(), writer);
 }
@@ -32,13 +32,13 @@ namespace detail {
 class label_writer {
 public:
     label_writer(
-        const include_graph_t::graph_t &graph, const path_printer_t &pp);
+        const include_graph_t &include_graph, const path_printer_t &pp);
 
     template <typename Vertex>
     void operator()(std::ostream &out, const Vertex &v) const;
 
 private:
-    const include_graph_t::graph_t &graph_;
+    const include_graph_t &include_graph_;
     const path_printer_t &path_printer_;
 };
 
@@ -39,8 +39,8 @@ void include_graph_json_printer_t::operator()(std::ostream &os) const
 {
     assert(include_graph().dag());
 
-    auto begin = boost::vertices(include_graph().dag().value().graph()).first;
-    auto end = boost::vertices(include_graph().dag().value().graph()).second;
+    auto begin = boost::vertices(include_graph().graph()).first;
+    auto end = boost::vertices(include_graph().graph()).second;
 
     boost::json::object g;
     g["directed"] = true;
@@ -55,17 +55,18 @@ void include_graph_json_printer_t::operator()(std::ostream &os) const
 
     boost::json::object nodes;
 
+    const auto &properties = include_graph().vertex_properties();
+
     std::for_each(
         begin, end, [&](const include_graph_t::graph_t::vertex_descriptor &v) {
-            const auto &graph = include_graph().graph().graph();
-            const auto &vertex = graph[v];
-
-            const auto file_path = path_printer().print(vertex);
+            const auto file_path =
+                path_printer().print(include_graph().file(v));
             boost::json::object node;
             node["label"] = file_path;
             boost::json::object metadata;
-            metadata["is_system_header"] = vertex.is_system_header;
-            metadata["is_translation_unit"] = vertex.is_translation_unit;
+            metadata["is_system_header"] = properties.is_system_header(v);
+            metadata["is_translation_unit"] =
+                properties.is_translation_unit(v);
             node["metadata"] = std::move(metadata);
 
             if (include_graph().numeric_ids())
@@ -96,11 +97,11 @@ void include_graph_json_printer_t::operator()(std::ostream &os) const
                 edge["source"] = std::to_string(from);
             }
             else {
-                const auto &from_vertex = graph[from];
-                const auto from_file_path = path_printer().print(from_vertex);
+                const auto from_file_path =
+                    path_printer().print(include_graph().file(from));
 
-                const auto &to_vertex = graph[to];
-                const auto to_file_path = path_printer().print(to_vertex);
+                const auto to_file_path =
+                    path_printer().print(include_graph().file(to));
 
                 edge["target"] = to_file_path;
                 edge["source"] = from_file_path;
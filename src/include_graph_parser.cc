@@ -17,78 +17,174 @@
  */
 
 #include "include_graph_parser.h"
+#include "arena.h"
 #include "compilation_database.h"
 #include "config.h"
 #include "include_graph.h"
+#include "include_graph_shard.h"
+#include "translation_unit_cache.h"
+#include "translation_unit_schedule.h"
 #include "util.h"
+#include "worker_pool.h"
 
 #include <boost/algorithm/string/join.hpp>
-#include <boost/algorithm/string/predicate.hpp>
 #include <boost/asio/post.hpp>
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/range/algorithm.hpp>
+#include <boost/utility/string_view.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <limits>
 #include <ostream>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 namespace clang_include_graph {
 
-using visitor_context_t = std::pair<include_graph_t &, std::string>;
+/**
+ * Tree of files entered by the preprocessor, in the order reported by
+ * `clang_getInclusions`. A header entered several times has an entry for
+ * each inclusion.
+ */
+struct inclusion_tree_t {
+    using indices_t =
+        std::vector<std::size_t, arena_allocator_t<std::size_t>>;
+
+    struct entry_t {
+        CXFile file;
+        // Offset of the included file name in the parent entry's file
+        unsigned offset;
+        indices_t children;
+    };
+
+    explicit inclusion_tree_t(arena_t &arena)
+        : entries{arena_allocator_t<entry_t>{arena}}
+        , stack{arena_allocator_t<std::size_t>{arena}}
+    {
+    }
 
-void print_diagnostics(const CXTranslationUnit &tu);
+    std::vector<entry_t, arena_allocator_t<entry_t>> entries;
+    // Entries of the current include stack, indexed by include depth
+    indices_t stack;
+};
 
-enum CXChildVisitResult inclusion_cursor_visitor(
-    CXCursor cursor, CXCursor parent, CXClientData include_graph_ptr);
+void print_diagnostics(const CXTranslationUnit &tu);
 
 void inclusion_visitor(CXFile cx_file, CXSourceLocation *inclusion_stack,
-    unsigned include_len, CXClientData include_graph_ptr);
+    unsigned include_len, CXClientData inclusion_tree_ptr);
 
-void process_translation_unit(const config_t &config,
-    include_graph_t &include_graph, CXCompileCommand command,
-    const boost::filesystem::path &tu_path, std::string &include_path_str,
-    CXIndex &index)
+unsigned int translation_unit_flags(parse_mode_t parse_mode)
 {
-    LOG(info) << "Parsing translation unit: " << include_path_str << '\n';
-
     auto flags = static_cast<unsigned int>(
                      CXTranslationUnit_DetailedPreprocessingRecord) |
         static_cast<unsigned int>(
             CXTranslationUnit_IgnoreNonErrorsFromIncludedFiles) |
         static_cast<unsigned int>(CXTranslationUnit_KeepGoing);
 
-    std::vector<std::string> args;
-    args.reserve(clang_CompileCommand_getNumArgs(command));
+    if (parse_mode != parse_mode_t::full) {
+        // Inclusion directives are recorded by the preprocessor, so we can
+        // skip as much of the semantic analysis as libclang allows. The
+        // incomplete flag also disables template instantiation at the end
+        // of the translation unit.
+        flags |= static_cast<unsigned int>(
+                     CXTranslationUnit_SkipFunctionBodies) |
+            static_cast<unsigned int>(CXTranslationUnit_Incomplete);
+    }
 
-    std::vector<const char *> args_cstr;
-    args_cstr.reserve(clang_CompileCommand_getNumArgs(command));
+    return flags;
+}
 
-    for (auto i = 0U; i < clang_CompileCommand_getNumArgs(command); i++) {
-        std::string arg{
-            clang_getCString(clang_CompileCommand_getArg(command, i))};
-        args.emplace_back(std::move(arg));
-    }
+namespace {
+std::uint64_t elapsed_us(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count());
+}
 
-    if (!config.add_compile_flag().empty()) {
-        args.insert(
-            // Add flags after argv[0]
-            args.begin() + 1, config.add_compile_flag().begin(),
-            config.add_compile_flag().end());
+/**
+ * Get the memory limit in bytes for a `--max-memory` option in MB, which
+ * is also capped by the available memory.
+ */
+std::uint64_t resolve_memory_limit(unsigned max_memory)
+{
+    const auto cgroup_limit = cgroup_memory_limit();
+    auto available = physical_memory();
+    if (cgroup_limit && (available == 0 || *cgroup_limit < available))
+        available = *cgroup_limit;
+
+    std::uint64_t limit{0};
+    if (max_memory == 0) {
+        // Leave some headroom for the rest of the system, or the rest of
+        // the cgroup
+        limit = available / 10 * 9;
+    }
+    else {
+        limit = static_cast<std::uint64_t>(max_memory) * 1024U * 1024U;
+        if (available > 0 && limit > available) {
+            LOG(warning) << "Memory limit " << max_memory
+                         << " MB exceeds available memory of "
+                         << available / 1024 / 1024 << " MB";
+            limit = available;
+        }
     }
 
-    for (const auto &flag : config.remove_compile_flag()) {
-        args.erase(std::remove_if(args.begin(), args.end(),
-                       [&flag](const auto &arg) {
-                           return util::match_flag_glob(arg, flag);
-                       }),
-            args.end());
+    if (cgroup_limit) {
+        LOG(debug) << "Memory limit of cgroup is "
+                   << *cgroup_limit / 1024 / 1024 << " MB";
     }
 
+    LOG(info) << "Parsing translation units while their projected memory "
+              << "usage stays under " << limit / 1024 / 1024 << " MB";
+
+    return limit;
+}
+
+// Remote workers are usually started along with the coordinator, which
+// first has to load the compilation database
+constexpr std::chrono::seconds coordinator_connect_timeout{60};
+
+/**
+ * Arena for temporaries of the translation unit parsed by the current
+ * thread, it's reset when the thread starts parsing the next one.
+ */
+arena_t &translation_unit_arena()
+{
+    thread_local arena_t arena;
+    return arena;
+}
+} // namespace
+
+bool process_translation_unit(const config_t &config,
+    file_path_cache_t &file_paths, std::vector<std::string> args,
+    const boost::filesystem::path &tu_path,
+    std::string &include_path_str, CXIndex &index,
+    parse_statistics_t &statistics, std::vector<include_edge_t> &edges,
+    std::uint64_t &memory_usage, std::string &error)
+{
+    LOG(info) << "Parsing translation unit: " << include_path_str << '\n';
+
+    const auto parse_mode = config.parse_mode();
+    const auto flags = translation_unit_flags(parse_mode);
+
+    auto &arena = translation_unit_arena();
+    arena.reset();
+
+    std::vector<const char *, arena_allocator_t<const char *>> args_cstr{
+        arena_allocator_t<const char *>{arena}};
+    args_cstr.reserve(args.size() + 1);
+
 #ifdef _MSC_VER
     // This assumes that Windows source file is always the last argument
     // of a compile command
@@ -105,15 +201,27 @@ void process_translation_unit(const config_t &config,
     }
 #endif
 
+    const auto full_args_size = args_cstr.size();
+    if (parse_mode != parse_mode_t::full) {
+        // Suppress all warnings, we don't print them anyway
+        args_cstr.emplace_back("-w");
+    }
+
     LOG(trace) << "Parsing " << tu_path << " with the following compile flags: "
                << boost::algorithm::join(args, " ");
 
     CXTranslationUnit unit{nullptr};
 
+    const auto parse_start = std::chrono::steady_clock::now();
+
     const CXErrorCode err = clang_parseTranslationUnit2(index,
         include_path_str.c_str(), args_cstr.data(),
         static_cast<int>(args_cstr.size()), nullptr, 0, flags, &unit);
 
+    const auto parse_time_us = elapsed_us(parse_start);
+    statistics.parse_time_us += parse_time_us;
+    statistics.translation_units++;
+
     if (err != CXError_Success) {
         std::string error_str;
 
@@ -139,24 +247,82 @@ void process_translation_unit(const config_t &config,
         if (unit != nullptr)
             print_diagnostics(unit);
 
-        LOG(error) << "ERROR: Unable to parse translation unit '" << tu_path
-                   << "' due to " << error_str << " - aborting..." << '\n';
-        exit(-1);
+        error = "Unable to parse translation unit '" + tu_path.string() +
+            "' due to " + error_str;
+        return false;
     }
 
-    if (global_logger::get().open_record(
+    if (parse_mode == parse_mode_t::full &&
+        global_logger::get().open_record(
             // NOLINTNEXTLINE
             boost::log::keywords::severity = boost::log::trivial::debug)) {
         print_diagnostics(unit);
     }
 
-    visitor_context_t visitor_context{include_graph, tu_path.string()};
+    if (parse_mode == parse_mode_t::compare) {
+        // Parse the translation unit again in full mode, only to measure
+        // how much time the fast mode saved
+        CXTranslationUnit full_unit{nullptr};
+
+        const auto full_parse_start = std::chrono::steady_clock::now();
 
-    const CXCursor start_cursor = clang_getTranslationUnitCursor(unit);
-    clang_visitChildren(
-        start_cursor, inclusion_cursor_visitor, &visitor_context);
+        clang_parseTranslationUnit2(index, include_path_str.c_str(),
+            args_cstr.data(), static_cast<int>(full_args_size), nullptr, 0,
+            translation_unit_flags(parse_mode_t::full), &full_unit);
+
+        const auto full_parse_time_us = elapsed_us(full_parse_start);
+        statistics.full_parse_time_us += full_parse_time_us;
+
+        LOG(debug) << "Parsed " << tu_path << " in " << parse_time_us / 1000
+                   << " ms (full mode: " << full_parse_time_us / 1000
+                   << " ms)";
+
+        if (full_unit != nullptr)
+            clang_disposeTranslationUnit(full_unit);
+    }
+
+    collect_include_edges(config, file_paths, unit, tu_path, edges);
+
+    const auto resource_usage = clang_getCXTUResourceUsage(unit);
+    memory_usage = 0;
+    for (auto i = 0U; i < resource_usage.numEntries; i++)
+        memory_usage += resource_usage.entries[i].amount;
+    clang_disposeCXTUResourceUsage(resource_usage);
 
     clang_disposeTranslationUnit(unit);
+
+    return true;
+}
+
+bool scan_translation_unit(const config_t &config, include_scanner_t &scanner,
+    const std::vector<std::string> &args, const std::string &directory,
+    const boost::filesystem::path &tu_path, parse_statistics_t &statistics,
+    std::vector<include_edge_t> &edges)
+{
+    LOG(info) << "Scanning translation unit: " << tu_path.string() << '\n';
+
+    const auto scan_start = std::chrono::steady_clock::now();
+
+    if (!scanner.scan(tu_path, directory, args, edges)) {
+        edges.clear();
+        return false;
+    }
+
+    // Keep only the first of repeated edges, as the graph would ignore the
+    // others anyway
+    std::unordered_set<std::string> seen_edges;
+    edges.erase(std::remove_if(edges.begin(), edges.end(),
+                    [&config, &seen_edges](const include_edge_t &edge) {
+                        return is_excluded_include_edge(config, edge) ||
+                            !seen_edges.insert(edge.from + '\n' + edge.to)
+                                 .second;
+                    }),
+        edges.end());
+
+    statistics.scan_time_us += elapsed_us(scan_start);
+    statistics.scanned_translation_units++;
+
+    return true;
 }
 
 bool is_system_header(CXCursor cursor)
@@ -172,13 +338,12 @@ bool is_system_header(CXCursor cursor)
     bool is_system = false;
     for (unsigned i = 0; i < num_tokens; ++i) {
         const CXString spelling = clang_getTokenSpelling(tu, tokens[i]);
-        const std::string tok = clang_getCString(spelling);
+        const char *tok = clang_getCString(spelling);
+        is_system = tok != nullptr && std::strcmp(tok, "<") == 0;
         clang_disposeString(spelling);
 
-        if (tok == "<") {
-            is_system = true;
+        if (is_system)
             break;
-        }
     }
 
     clang_disposeTokens(tu, tokens, num_tokens);
@@ -189,35 +354,120 @@ std::string get_raw_include_text(CXCursor cursor)
 {
     const CXString cx_spelling = clang_getCursorSpelling(cursor);
     const char *cstr = clang_getCString(cx_spelling);
-    std::string spelling = (cstr != nullptr) ? cstr : "";
-    clang_disposeString(cx_spelling);
+    boost::string_view spelling{(cstr != nullptr) ? cstr : ""};
 
     if (spelling.size() >= 2) {
         const char first = spelling.front();
         const char last = spelling.back();
-        if ((first == '<' && last == '>') || (first == '"' && last == '"')) {
-            return spelling.substr(1, spelling.size() - 2);
-        }
+        if ((first == '<' && last == '>') || (first == '"' && last == '"'))
+            spelling = spelling.substr(1, spelling.size() - 2);
     }
 
-    return spelling;
+    // Copy the spelling once, without the delimiters
+    std::string result{spelling.data(), spelling.size()};
+    clang_disposeString(cx_spelling);
+
+    return result;
 }
 
 include_graph_parser_t::include_graph_parser_t(const config_t &config)
-    : index_{clang_createIndex(0, 0)}
-    , config_{config}
+    : config_{config}
+    , frontend_config_{config}
+    , file_paths_{config.relative_to()}
 {
+    if (config_.shared_index())
+        index_ = create_index();
+
+    if (config_.parse_mode() == parse_mode_t::scan)
+        scanner_ = std::make_unique<include_scanner_t>();
+
+    if (config_.cache_dir()) {
+        cache_ = std::make_unique<translation_unit_cache_t>(
+            *config_.cache_dir(),
+            static_cast<std::uint64_t>(config_.cache_size_limit()) * 1024U *
+                1024U);
+    }
+
+    if (config_.max_memory())
+        memory_limit_ = resolve_memory_limit(*config_.max_memory());
+
+    if (config_.timings_file()) {
+        timings_ = std::make_unique<parse_timings_t>(*config_.timings_file());
+        timings_->load();
+    }
+
+    // Listen before the compilation database is loaded, so that workers
+    // can connect in the meantime
+    if (config_.coordinator()) {
+        coordinator_ = std::make_unique<coordinator_t>(
+            parse_endpoint(*config_.coordinator()).value());
+    }
+
+    // Cache entries and edges kept by the watch mode are stored unfiltered,
+    // filters are applied only when edges are added to the graph. The watch
+    // mode needs all included files, including ones filtered out of the
+    // graph, to find translation units affected by modifications. Remote
+    // workers send unfiltered edges, which the coordinator may also cache.
+    if (cache_ || config_.watch() || config_.coordinator() ||
+        config_.worker()) {
+        filter_edges_ = true;
+        frontend_config_.exclude_system_headers(false);
+        frontend_config_.relative_only(false);
+    }
 }
 
 include_graph_parser_t::~include_graph_parser_t()
 {
-    clang_disposeIndex(index_);
+    if (index_ != nullptr)
+        clang_disposeIndex(index_);
+
+    for (auto &thread_index : indices_)
+        clang_disposeIndex(thread_index.second);
+}
+
+CXIndex include_graph_parser_t::create_index() const
+{
+    auto *index = clang_createIndex(0, 0);
+
+    if (config_.background_priority()) {
+        clang_CXIndex_setGlobalOptions(index,
+            static_cast<unsigned>(CXGlobalOpt_ThreadBackgroundPriorityForAll));
+    }
+
+    return index;
+}
+
+CXIndex &include_graph_parser_t::thread_index()
+{
+    if (config_.shared_index())
+        return index_;
+
+    const std::lock_guard<std::mutex> guard{indices_mutex_};
+
+    const auto thread_id = std::this_thread::get_id();
+    auto it = indices_.find(thread_id);
+    if (it == indices_.end())
+        it = indices_.emplace(thread_id, create_index()).first;
+
+    return it->second;
 }
 
 void include_graph_parser_t::parse(include_graph_t &include_graph)
 {
+    include_graph.clear();
     include_graph.init(config_);
 
+    // Reset the state of previous parse in watch mode
+    translation_units_.clear();
+    failed_translation_units_.clear();
+    jobs_.clear();
+    translation_unit_edges_.clear();
+    statistics_.reset();
+    if (scanner_)
+        scanner_->forget_files();
+    if (cache_)
+        cache_->forget_file_stamps();
+
     auto error = CXCompilationDatabase_NoError;
     const auto compilation_database_directory_str =
         config_.compilation_database_directory().value().string();
@@ -312,9 +562,20 @@ void include_graph_parser_t::parse(include_graph_t &include_graph)
     LOG(info) << "Found " << matching_compile_commands.size()
               << " matching translation units";
 
-    boost::asio::thread_pool thread_pool{config_.jobs()};
+    const auto parse_start = std::chrono::steady_clock::now();
+
+    // Translation units with preprocessor arguments of their selected
+    // compile commands, used to skip equivalent commands, e.g. the same
+    // file compiled for static and shared libraries or with sanitizers
+    std::set<std::pair<boost::filesystem::path, std::vector<std::string>>>
+        selected_commands;
+    std::size_t skipped_commands_count{0};
 
-    LOG(info) << "Starting thread pool with " << config_.jobs() << " threads\n";
+    // Shards are assigned by paths relative to the canonical database
+    // directory, as paths of translation units are canonical
+    const auto shard_directory = boost::filesystem::weakly_canonical(
+        config_.compilation_database_directory().value());
+    std::size_t other_shards_commands_count{0};
 
     for (auto *compile_commands : matching_compile_commands) {
         auto compile_commands_size =
@@ -356,23 +617,598 @@ void include_graph_parser_t::parse(include_graph_t &include_graph)
                 exit(-1);
             }
 
+            if (config_.shard() &&
+                !is_in_shard(tu_path, shard_directory, *config_.shard())) {
+                other_shards_commands_count++;
+                continue;
+            }
+
+            std::vector<std::string> preprocessor_args;
+            if (!config_.one_config_per_file()) {
+                preprocessor_args = get_preprocessor_arguments(
+                    get_compile_command_arguments(config_, command),
+                    clang_getCString(
+                        clang_CompileCommand_getDirectory(command)));
+            }
+
+            if (!selected_commands
+                     .emplace(tu_path, std::move(preprocessor_args))
+                     .second) {
+                LOG(debug) << "Skipping compile command of translation unit "
+                           << tu_path
+                           << " - equivalent to an already selected one";
+                skipped_commands_count++;
+                continue;
+            }
+
             auto include_path_str = tu_path.string();
             translation_units_.emplace(include_path_str);
 
-            auto &index = index_;
+            jobs_.push_back({tu_path, include_path_str, command, {}});
+        }
+    }
+
+    if (skipped_commands_count > 0) {
+        LOG(info) << "Skipped " << skipped_commands_count
+                  << " compile commands with the same translation unit and "
+                  << (config_.one_config_per_file() ? "" : "preprocessor ")
+                  << "flags as other compile commands";
+    }
+
+    if (config_.shard()) {
+        LOG(info) << "Selected " << jobs_.size()
+                  << " compile commands for shard " << config_.shard()->number
+                  << "/" << config_.shard()->count << ", skipped "
+                  << other_shards_commands_count
+                  << " compile commands of other shards";
+    }
+
+    auto jobs = cache_ ? load_cached_translation_units(include_graph, jobs_)
+                       : jobs_;
+
+    parse_jobs(include_graph, jobs);
+
+    if (cache_)
+        cache_->collect_garbage();
+
+    log_statistics(include_graph, elapsed_us(parse_start));
+}
+
+std::vector<translation_unit_job_t>
+include_graph_parser_t::load_cached_translation_units(
+    include_graph_t &include_graph, std::vector<translation_unit_job_t> &jobs)
+{
+    const auto options =
+        std::to_string(static_cast<int>(config_.parse_mode()));
+
+    std::vector<translation_unit_job_t> uncached_jobs;
+
+    for (auto &job : jobs) {
+        job.cache_key = translation_unit_cache_t::key(job.tu_path,
+            clang_getCString(clang_CompileCommand_getDirectory(job.command)),
+            get_compile_command_arguments(config_, job.command), options);
+
+        std::vector<include_edge_t> edges;
+        if (cache_->load(job.cache_key, edges)) {
+            LOG(debug) << "Loaded translation unit " << job.tu_path
+                       << " from cache";
+            add_edges(include_graph, job, edges);
+            continue;
+        }
+
+        uncached_jobs.emplace_back(job);
+    }
+
+    return uncached_jobs;
+}
+
+void include_graph_parser_t::add_edges(include_graph_t &include_graph,
+    const translation_unit_job_t &job, std::vector<include_edge_t> &edges)
+{
+    // Translation units compiled with several configurations keep edges of
+    // all of them, and are always parsed again together
+    if (config_.watch()) {
+        const std::lock_guard<std::mutex> guard{translation_unit_edges_mutex_};
+        auto &translation_unit_edges = translation_unit_edges_[job.tu_path];
+        translation_unit_edges.insert(
+            translation_unit_edges.end(), edges.begin(), edges.end());
+    }
+
+    filter_edges(edges);
+
+    include_graph.add_edges(edges);
+}
+
+void include_graph_parser_t::filter_edges(
+    std::vector<include_edge_t> &edges) const
+{
+    if (!filter_edges_)
+        return;
+
+    edges.erase(std::remove_if(edges.begin(), edges.end(),
+                    [this](const include_edge_t &edge) {
+                        return is_excluded_include_edge(config_, edge);
+                    }),
+        edges.end());
+}
 
-            boost::asio::post(thread_pool,
-                [&config = config_, &include_graph, &index, tu_path,
-                    include_path_str, command]() mutable {
-                    process_translation_unit(config, include_graph, command,
-                        tu_path, include_path_str, index);
+bool include_graph_parser_t::update(include_graph_t &include_graph,
+    const std::set<std::string> &modified_files)
+{
+    const auto depends_on_modified_file =
+        [this, &modified_files](const translation_unit_job_t &job) {
+            if (modified_files.count(job.tu_path.string()) > 0)
+                return true;
+
+            auto it = translation_unit_edges_.find(job.tu_path);
+            if (it == translation_unit_edges_.end())
+                return false;
+
+            return std::any_of(it->second.begin(), it->second.end(),
+                [&modified_files](const include_edge_t &edge) {
+                    return modified_files.count(edge.to) > 0 ||
+                        modified_files.count(edge.from) > 0;
                 });
+        };
+
+    std::vector<translation_unit_job_t> jobs;
+    std::copy_if(jobs_.begin(), jobs_.end(), std::back_inserter(jobs),
+        depends_on_modified_file);
+
+    if (jobs.empty()) {
+        LOG(info) << "Modified files are not included by any translation unit";
+        return false;
+    }
+
+    LOG(info) << "Parsing " << jobs.size() << " of " << jobs_.size()
+              << " translation units affected by " << modified_files.size()
+              << " modified files";
+
+    const auto update_start = std::chrono::steady_clock::now();
+
+    if (scanner_)
+        scanner_->forget_files();
+    if (cache_)
+        cache_->forget_file_stamps();
+
+    for (const auto &job : jobs) {
+        translation_unit_edges_.erase(job.tu_path);
+        failed_translation_units_.erase(job.tu_path);
+    }
+
+    // Edges of parsed translation units are kept by `add_edges`, the graph
+    // is then rebuilt from the edges of all translation units in the order
+    // of the compilation database, as if they were all parsed again
+    include_graph_t updated_graph;
+    updated_graph.init(config_);
+
+    parse_jobs(updated_graph, jobs);
+
+    include_graph.clear();
+
+    std::set<boost::filesystem::path> added_translation_units;
+    for (const auto &job : jobs_) {
+        auto it = translation_unit_edges_.find(job.tu_path);
+        if (it == translation_unit_edges_.end() ||
+            !added_translation_units.emplace(job.tu_path).second)
+            continue;
+
+        auto edges = it->second;
+        filter_edges(edges);
+        include_graph.add_edges(edges);
+    }
+
+    if (cache_)
+        cache_->collect_garbage();
+
+    for (const auto &job : jobs) {
+        auto it = failed_translation_units_.find(job.tu_path);
+        if (it != failed_translation_units_.end()) {
+            LOG(error) << "ERROR: Failed to parse " << it->first.string()
+                       << ": " << it->second;
+        }
+    }
+
+    LOG(info) << "Updated include graph in "
+              << elapsed_us(update_start) / 1000 << " ms";
+
+    return true;
+}
+
+std::set<std::string> include_graph_parser_t::dependencies() const
+{
+    std::set<std::string> result;
+
+    for (const auto &job : jobs_)
+        result.emplace(job.tu_path.string());
+
+    for (const auto &translation_unit : translation_unit_edges_) {
+        for (const auto &edge : translation_unit.second) {
+            result.emplace(edge.to);
+            result.emplace(edge.from);
         }
     }
 
+    return result;
+}
+
+void include_graph_parser_t::parse_jobs(
+    include_graph_t &include_graph, std::vector<translation_unit_job_t> &jobs)
+{
+    if (jobs.empty())
+        return;
+
+    if (config_.schedule() != schedule_t::database) {
+        std::vector<boost::filesystem::path> tu_paths;
+        tu_paths.reserve(jobs.size());
+        for (const auto &job : jobs)
+            tu_paths.emplace_back(job.tu_path);
+
+        std::vector<translation_unit_job_t> scheduled_jobs;
+        scheduled_jobs.reserve(jobs.size());
+        for (const auto index :
+            schedule_translation_units(tu_paths, config_.schedule(), *timings_))
+            scheduled_jobs.emplace_back(std::move(jobs[index]));
+
+        jobs = std::move(scheduled_jobs);
+    }
+
+    parse_times_us_.clear();
+
+    const auto parse_start = std::chrono::steady_clock::now();
+
+    if (coordinator_)
+        parse_in_coordinator(include_graph, jobs);
+    else if (config_.worker_processes() > 0)
+        parse_in_worker_processes(include_graph, jobs);
+    else
+        parse_in_thread_pool(include_graph, jobs);
+
+    const auto makespan_us = elapsed_us(parse_start);
+
+    if (timings_)
+        timings_->save();
+
+    auto workers = config_.jobs();
+    if (coordinator_)
+        workers = coordinator_->peak_workers();
+    else if (config_.worker_processes() > 0)
+        workers = config_.worker_processes();
+    const auto ideal_us = ideal_makespan_us(parse_times_us_, workers);
+
+    LOG(info) << "Makespan of parsing " << parse_times_us_.size()
+              << " translation units on " << workers << " workers was "
+              << makespan_us / 1000 << " ms, ideal schedule would take "
+              << ideal_us / 1000 << " ms ("
+              << (makespan_us == 0U ? 100U : 100U * ideal_us / makespan_us)
+              << "% efficiency)";
+}
+
+void include_graph_parser_t::record_parse_time(
+    const translation_unit_job_t &job, std::uint64_t duration_us)
+{
+    if (timings_)
+        timings_->record(job.tu_path, duration_us);
+
+    const std::lock_guard<std::mutex> guard{parse_times_mutex_};
+    parse_times_us_.emplace_back(duration_us);
+}
+
+bool include_graph_parser_t::process_job(translation_unit_job_t &job,
+    CXIndex &index, parse_statistics_t &statistics,
+    std::vector<include_edge_t> &edges, std::uint64_t &memory_usage,
+    std::string &error)
+{
+    auto args = get_compile_command_arguments(frontend_config_, job.command);
+
+    if (scanner_ &&
+        scan_translation_unit(frontend_config_, *scanner_, args,
+            clang_getCString(clang_CompileCommand_getDirectory(job.command)),
+            job.tu_path, statistics, edges))
+        return true;
+
+    return process_translation_unit(frontend_config_, file_paths_,
+        std::move(args), job.tu_path, job.include_path_str, index, statistics,
+        edges, memory_usage, error);
+}
+
+bool include_graph_parser_t::process_remote_job(const remote_job_t &job,
+    CXIndex &index, parse_statistics_t &statistics,
+    std::vector<include_edge_t> &edges, std::string &error)
+{
+    const boost::filesystem::path tu_path{job.tu_path};
+
+    if (scanner_ &&
+        scan_translation_unit(frontend_config_, *scanner_, job.args,
+            job.directory, tu_path, statistics, edges))
+        return true;
+
+    auto include_path_str = job.tu_path;
+    std::uint64_t memory_usage{0};
+    return process_translation_unit(frontend_config_, file_paths_, job.args,
+        tu_path, include_path_str, index, statistics, edges, memory_usage,
+        error);
+}
+
+void include_graph_parser_t::parse_in_thread_pool(
+    include_graph_t &include_graph, std::vector<translation_unit_job_t> &jobs)
+{
+    boost::asio::thread_pool thread_pool{config_.jobs()};
+
+    LOG(info) << "Starting thread pool with " << config_.jobs()
+              << " threads using "
+              << (config_.shared_index() ? "a shared libclang index"
+                                         : "one libclang index per thread")
+              << '\n';
+
+    std::unique_ptr<memory_budget_t> memory_budget;
+    if (memory_limit_ > 0) {
+        // Until the first translation unit is parsed, assume the memory
+        // is enough for all threads
+        const auto baseline = resident_memory();
+        const auto available =
+            memory_limit_ > baseline ? memory_limit_ - baseline : 0U;
+        memory_budget = std::make_unique<memory_budget_t>(
+            memory_limit_, baseline, available / config_.jobs());
+    }
+
+    for (auto &job : jobs) {
+        boost::asio::post(
+            thread_pool, [this, &include_graph, &job, &memory_budget]() {
+                std::vector<include_edge_t> edges;
+                std::uint64_t memory_usage{0};
+                std::string error;
+
+                const auto reserved =
+                    memory_budget ? memory_budget->acquire() : 0U;
+
+                const auto job_start = std::chrono::steady_clock::now();
+
+                if (!process_job(job, thread_index(), statistics_, edges,
+                        memory_usage, error)) {
+                    LOG(error)
+                        << "ERROR: " << error << " - aborting..." << '\n';
+                    exit(-1);
+                }
+
+                record_parse_time(job, elapsed_us(job_start));
+
+                if (memory_budget)
+                    memory_budget->release(reserved, memory_usage);
+
+                if (cache_)
+                    cache_->store(job.cache_key, job.tu_path, edges);
+
+                add_edges(include_graph, job, edges);
+            });
+    }
+
     thread_pool.join();
 
     thread_pool.stop();
+
+    if (memory_budget) {
+        LOG(info) << "At most " << memory_budget->peak_admitted()
+                  << " translation units were parsed at the same time, "
+                  << memory_budget->waits()
+                  << " of them waited for memory to be released";
+    }
+}
+
+void include_graph_parser_t::parse_in_worker_processes(
+    include_graph_t &include_graph, std::vector<translation_unit_job_t> &jobs)
+{
+#if defined(_WIN32)
+    (void)include_graph;
+    (void)jobs;
+#else
+    LOG(info) << "Starting " << config_.worker_processes()
+              << " worker processes" << '\n';
+
+    if (config_.tu_timeout() > 0) {
+        LOG(info) << "Translation units taking longer than "
+                  << config_.tu_timeout() << " s will be killed";
+    }
+
+    // Each worker process creates its own index on first use, the one
+    // shared by threads is never used after fork
+    CXIndex worker_index{nullptr};
+
+    worker_pool_t worker_pool{config_.worker_processes(),
+        std::chrono::seconds{config_.tu_timeout()},
+        [this, &jobs, &worker_index](std::size_t index,
+            std::vector<include_edge_t> &edges,
+            parse_statistics_t &statistics, std::string &error) {
+            if (worker_index == nullptr)
+                worker_index = create_index();
+
+            std::uint64_t memory_usage{0};
+            return process_job(jobs.at(index), worker_index, statistics,
+                edges, memory_usage, error);
+        }};
+
+    const auto failed_jobs = worker_pool.run(jobs.size(), statistics_,
+        [this, &include_graph, &jobs](std::size_t index,
+            std::vector<include_edge_t> &edges,
+            std::chrono::microseconds elapsed) {
+            const auto &job = jobs.at(index);
+
+            record_parse_time(
+                job, static_cast<std::uint64_t>(elapsed.count()));
+
+            if (cache_)
+                cache_->store(job.cache_key, job.tu_path, edges);
+
+            add_edges(include_graph, job, edges);
+        });
+
+    for (const auto &failed_job : failed_jobs) {
+        failed_translation_units_.emplace(
+            jobs.at(failed_job.index).tu_path, failed_job.reason);
+    }
+#endif
+}
+
+void include_graph_parser_t::parse_in_coordinator(
+    include_graph_t &include_graph, std::vector<translation_unit_job_t> &jobs)
+{
+#if defined(_WIN32)
+    (void)include_graph;
+    (void)jobs;
+#else
+    std::vector<remote_job_t> remote_jobs;
+    remote_jobs.reserve(jobs.size());
+    for (const auto &job : jobs) {
+        remote_jobs.push_back({job.include_path_str,
+            clang_getCString(clang_CompileCommand_getDirectory(job.command)),
+            get_compile_command_arguments(config_, job.command)});
+    }
+
+    const auto failed_jobs = coordinator_->run(remote_jobs, statistics_,
+        [this, &include_graph, &jobs](std::size_t index,
+            std::vector<include_edge_t> &edges,
+            std::chrono::microseconds elapsed) {
+            const auto &job = jobs.at(index);
+
+            record_parse_time(
+                job, static_cast<std::uint64_t>(elapsed.count()));
+
+            if (cache_)
+                cache_->store(job.cache_key, job.tu_path, edges);
+
+            add_edges(include_graph, job, edges);
+        });
+
+    for (const auto &failed_job : failed_jobs) {
+        failed_translation_units_.emplace(
+            jobs.at(failed_job.index).tu_path, failed_job.reason);
+    }
+#endif
+}
+
+bool include_graph_parser_t::parse_for_coordinator()
+{
+#if defined(_WIN32)
+    return false;
+#else
+    const auto endpoint = parse_endpoint(config_.worker().value()).value();
+
+    LOG(info) << "Parsing translation units of coordinator at "
+              << endpoint.to_string() << " using " << config_.jobs()
+              << " connections";
+
+    const auto parse_start = std::chrono::steady_clock::now();
+
+    std::atomic<bool> connected{true};
+    std::atomic<std::uint64_t> translation_units{0};
+
+    boost::asio::thread_pool thread_pool{config_.jobs()};
+
+    const auto handler = [this, &translation_units](const remote_job_t &job,
+                             std::vector<include_edge_t> &edges,
+                             parse_statistics_t &statistics,
+                             std::string &error) {
+        translation_units++;
+        return process_remote_job(
+            job, thread_index(), statistics, edges, error);
+    };
+
+    for (auto i = 0U; i < config_.jobs(); i++) {
+        boost::asio::post(thread_pool, [&endpoint, &connected, &handler]() {
+            if (!run_remote_worker(
+                    endpoint, coordinator_connect_timeout, handler))
+                connected = false;
+        });
+    }
+
+    thread_pool.join();
+
+    LOG(info) << "Parsed " << translation_units
+              << " translation units in " << elapsed_us(parse_start) / 1000
+              << " ms";
+
+    return connected;
+#endif
+}
+
+const parse_statistics_t &include_graph_parser_t::statistics() const
+{
+    return statistics_;
+}
+
+const std::map<boost::filesystem::path, std::string> &
+include_graph_parser_t::failed_translation_units() const
+{
+    return failed_translation_units_;
+}
+
+void include_graph_parser_t::log_statistics(
+    const include_graph_t &include_graph, std::uint64_t wall_time_us) const
+{
+    const auto parse_time_us = statistics_.parse_time_us.load();
+
+    LOG(info) << "Parsed " << statistics_.translation_units.load()
+              << " translation units in " << wall_time_us / 1000
+              << " ms (cumulative frontend time " << parse_time_us / 1000
+              << " ms)";
+
+    const auto lock_statistics = include_graph.lock_statistics();
+    LOG(info) << "Include graph lock acquired " << lock_statistics.acquisitions
+              << " times, " << lock_statistics.contentions
+              << " of which waited for another thread for "
+              << lock_statistics.wait_time_us / 1000 << " ms in total";
+
+    // Worker processes have their own caches
+    if (file_paths_.misses() > 0) {
+        LOG(debug) << "Resolved canonical paths of " << file_paths_.misses()
+                   << " files, " << file_paths_.hits()
+                   << " lookups served from cache";
+    }
+
+    if (cache_) {
+        const auto hits = cache_->hits();
+        const auto lookups = hits + cache_->misses();
+        LOG(info) << "Loaded " << hits << " of " << lookups
+                  << " translation units from cache ("
+                  << (lookups == 0U ? 0U : 100U * hits / lookups)
+                  << "% hit rate), evicted " << cache_->evictions()
+                  << " cache entries";
+    }
+
+    if (config_.parse_mode() == parse_mode_t::scan) {
+        LOG(info) << "Scanned " << statistics_.scanned_translation_units.load()
+                  << " translation units in "
+                  << statistics_.scan_time_us.load() / 1000
+                  << " ms of cumulative scan time, "
+                  << statistics_.translation_units.load()
+                  << " translation units fell back to libclang";
+    }
+
+    if (!failed_translation_units_.empty()) {
+        LOG(error) << "ERROR: Failed to parse "
+                   << failed_translation_units_.size()
+                   << " translation units, their includes are missing from "
+                      "the graph:";
+
+        for (const auto &failed : failed_translation_units_)
+            LOG(error) << "  " << failed.first.string() << ": "
+                       << failed.second;
+    }
+
+    if (config_.parse_mode() != parse_mode_t::compare)
+        return;
+
+    const auto full_parse_time_us = statistics_.full_parse_time_us.load();
+    const auto saved_us = full_parse_time_us > parse_time_us
+        ? full_parse_time_us - parse_time_us
+        : 0U;
+    const auto saved_percent =
+        full_parse_time_us == 0U ? 0U : 100U * saved_us / full_parse_time_us;
+
+    LOG(info) << "Fast parse mode took " << parse_time_us / 1000
+              << " ms compared to " << full_parse_time_us / 1000
+              << " ms in full parse mode - saved " << saved_us / 1000
+              << " ms (" << saved_percent << "%)";
 }
 
 const std::set<boost::filesystem::path> &
@@ -398,71 +1234,260 @@ void print_diagnostics(const CXTranslationUnit &tu)
     }
 }
 
-bool is_relative(const boost::filesystem::path &filepath,
-    const boost::filesystem::path &directory)
+bool is_excluded_include_edge(
+    const config_t &config, const include_edge_t &edge)
 {
-    return boost::starts_with(filepath, directory);
+    if (config.exclude_system_headers() && edge.is_system)
+        return true;
+
+    const auto &relative_to = config.relative_to();
+
+    return config.relative_only() &&
+        (!util::is_relative(edge.from, relative_to.value()) ||
+            !util::is_relative(edge.to, relative_to.value()));
 }
 
-enum CXChildVisitResult inclusion_cursor_visitor(
-    CXCursor cursor, CXCursor /*parent*/, CXClientData include_graph_ptr)
+
+void inclusion_visitor(CXFile cx_file, CXSourceLocation *inclusion_stack,
+    unsigned include_len, CXClientData inclusion_tree_ptr)
 {
-    auto &include_graph =
-        std::get<0>(*static_cast<visitor_context_t *>(include_graph_ptr));
+    auto &tree = *static_cast<inclusion_tree_t *>(inclusion_tree_ptr);
+
+    if (include_len > tree.stack.size()) {
+        // Parent of this file was not reported, e.g. it comes from a
+        // precompiled preamble
+        return;
+    }
+
+    unsigned offset{0};
+    if (include_len > 0) {
+        clang_getFileLocation(
+            inclusion_stack[0], nullptr, nullptr, nullptr, &offset);
+    }
 
-    auto tu_path =
-        std::get<1>(*static_cast<visitor_context_t *>(include_graph_ptr));
+    const auto index = tree.entries.size();
+    tree.entries.push_back({cx_file, offset,
+        inclusion_tree_t::indices_t{tree.stack.get_allocator()}});
 
-    auto relative_only = include_graph.relative_only();
-    auto relative_to = include_graph.relative_to();
+    tree.stack.resize(include_len);
+    if (include_len > 0)
+        tree.entries[tree.stack.back()].children.push_back(index);
+    tree.stack.push_back(index);
+}
 
-    if (clang_getCursorKind(cursor) == CXCursor_InclusionDirective) {
-        CXFile source_file{nullptr};
-        unsigned line{};
-        unsigned column{};
-        unsigned offset{};
-        clang_getFileLocation(clang_getCursorLocation(cursor), &source_file,
-            &line, &column, &offset);
+namespace {
+/**
+ * Walks the inclusion tree of a translation unit in preprocessing order,
+ * taking the include directives of each entered file directly from the
+ * preprocessing record instead of visiting the entire AST.
+ */
+class include_edges_collector_t {
+public:
+    include_edges_collector_t(const config_t &config,
+        file_path_cache_t &file_paths, CXTranslationUnit unit,
+        const inclusion_tree_t &tree, const boost::filesystem::path &tu_path,
+        std::vector<include_edge_t> &edges, arena_t &arena)
+        : config_{config}
+        , file_paths_{file_paths}
+        , unit_{unit}
+        , tree_{tree}
+        , tu_path_{tu_path}
+        , edges_{edges}
+        , arena_{arena}
+        , files_{files_allocator_t{arena}}
+        , emitted_edges_{emitted_edges_allocator_t{arena}}
+    {
+    }
 
-        const std::string source_file_str{
-            clang_getCString(clang_getFileName(source_file))};
+    void collect()
+    {
+        if (!tree_.entries.empty())
+            visit_entry(0);
+    }
+
+private:
+    struct include_directive_t {
+        // Offset of the directive's '#'
+        unsigned offset;
+        CXCursor cursor;
+    };
+
+    using include_directives_t = std::vector<include_directive_t,
+        arena_allocator_t<include_directive_t>>;
+
+    struct file_info_t {
+        explicit file_info_t(arena_t &arena)
+            : include_directives{arena_allocator_t<include_directive_t>{arena}}
+        {
+        }
+
+        const file_path_t *file_path{nullptr};
+        // Only looked up for files entered by the preprocessor, this
+        // includes directives skipped due to include guards or
+        // `#pragma once`, but not those in inactive preprocessor blocks
+        include_directives_t include_directives;
+        bool has_include_directives{false};
+        bool is_translation_unit{false};
+    };
+
+    static CXVisitorResult include_directive_visitor(
+        void *directives_ptr, CXCursor cursor, CXSourceRange range)
+    {
+        unsigned offset{0};
+        clang_getFileLocation(
+            clang_getRangeStart(range), nullptr, nullptr, nullptr, &offset);
+
+        static_cast<include_directives_t *>(directives_ptr)
+            ->push_back({offset, cursor});
+
+        return CXVisit_Continue;
+    }
+
+    file_info_t &file_info(CXFile file)
+    {
+        auto it = files_.find(file);
+        if (it != files_.end())
+            return it->second;
+
+        file_info_t info{arena_};
+        info.file_path = &file_paths_.get(file);
+        // Compared once per file, as comparing paths splits them into
+        // their components
+        info.is_translation_unit = tu_path_ == info.file_path->path;
+
+        return files_.emplace(file, std::move(info)).first->second;
+    }
+
+    const file_info_t &entered_file_info(CXFile file)
+    {
+        auto &info = file_info(file);
+        if (info.has_include_directives)
+            return info;
+
+        CXCursorAndRangeVisitor visitor{
+            &info.include_directives, include_directive_visitor};
+        clang_findIncludesInFile(unit_, file, visitor);
+
+        std::sort(info.include_directives.begin(),
+            info.include_directives.end(),
+            [](const auto &lhs, const auto &rhs) {
+                return lhs.offset < rhs.offset;
+            });
+        info.has_include_directives = true;
+
+        return info;
+    }
+
+    void visit_entry(std::size_t index)
+    {
+        const auto &entry = tree_.entries[index];
+        const auto &info = entered_file_info(entry.file);
+        const auto &directives = info.include_directives;
+
+        auto child = entry.children.begin();
+        for (auto it = directives.begin(); it != directives.end(); ++it) {
+            add_edge(it->cursor, info);
+
+            // Enter the included file, unless it was skipped by its include
+            // guard or `#pragma once`
+            const auto next_offset = std::next(it) == directives.end()
+                ? std::numeric_limits<unsigned>::max()
+                : std::next(it)->offset;
+            while (child != entry.children.end() &&
+                tree_.entries[*child].offset < next_offset) {
+                visit_entry(*child);
+                ++child;
+            }
+        }
+
+        // Files entered without a matching directive in the preprocessing
+        // record of the file's first inclusion
+        for (; child != entry.children.end(); ++child)
+            visit_entry(*child);
+    }
+
+    void add_edge(CXCursor cursor, const file_info_t &from_info)
+    {
+        const auto &from = *from_info.file_path;
 
         CXFile included_file = clang_getIncludedFile(cursor);
 
         if (included_file == nullptr) {
             LOG(debug)
-                << "WARNING: Cannot find header from include directive at "
-                << source_file_str << ":" << line << '\n';
-            return CXChildVisit_Continue;
+                << "WARNING: Cannot find header from include directive in "
+                << from.path << '\n';
+            return;
         }
 
-        const auto is_system = is_system_header(cursor);
+        const auto &to = *file_info(included_file).file_path;
 
-        if (include_graph.exclude_system_headers() && is_system)
-            return CXChildVisit_Continue;
+        // The graph ignores repeated edges anyway, so skip them before
+        // they're tokenized and copied
+        if (emitted_edges_.count({&from, &to}) > 0)
+            return;
 
-        const std::string included_file_str{
-            clang_getCString(clang_getFileName(included_file))};
+        include_edge_t edge;
+        edge.is_system = is_system_header(cursor);
 
-        const auto include_spelling = get_raw_include_text(cursor);
+        if (config_.exclude_system_headers() && edge.is_system)
+            return;
 
-        const boost::filesystem::path included_path =
-            boost::filesystem::weakly_canonical(
-                boost::filesystem::path(included_file_str));
+        if (config_.relative_only() && (!from.is_relative || !to.is_relative))
+            return;
 
-        const boost::filesystem::path from_path =
-            boost::filesystem::weakly_canonical(
-                boost::filesystem::path(source_file_str));
+        edge.include_spelling = get_raw_include_text(cursor);
+        edge.to = to.path;
+        edge.from = from.path;
+        edge.from_translation_unit = from_info.is_translation_unit;
 
-        if (!relative_only ||
-            (is_relative(from_path, relative_to.value()) &&
-                is_relative(included_path, relative_to.value()))) {
-            include_graph.add_edge(included_path.string(), from_path.string(),
-                include_spelling, tu_path == from_path, is_system);
-        }
+        emitted_edges_.emplace(&from, &to);
+        edges_.emplace_back(std::move(edge));
     }
 
-    return CXChildVisit_Continue;
+    using file_path_pair_t =
+        std::pair<const file_path_t *, const file_path_t *>;
+
+    struct file_path_pair_hash_t {
+        std::size_t operator()(const file_path_pair_t &pair) const noexcept
+        {
+            const std::hash<const file_path_t *> hash;
+            return hash(pair.first) ^ (hash(pair.second) << 1U);
+        }
+    };
+
+    const config_t &config_;
+    file_path_cache_t &file_paths_;
+    CXTranslationUnit unit_;
+    const inclusion_tree_t &tree_;
+    const boost::filesystem::path &tu_path_;
+    using files_allocator_t =
+        arena_allocator_t<std::pair<const CXFile, file_info_t>>;
+    using emitted_edges_allocator_t = arena_allocator_t<file_path_pair_t>;
+
+    std::vector<include_edge_t> &edges_;
+    arena_t &arena_;
+    std::unordered_map<CXFile, file_info_t, std::hash<CXFile>,
+        std::equal_to<CXFile>, files_allocator_t>
+        files_;
+    std::unordered_set<file_path_pair_t, file_path_pair_hash_t,
+        std::equal_to<file_path_pair_t>, emitted_edges_allocator_t>
+        emitted_edges_;
+};
+} // namespace
+
+void collect_include_edges(const config_t &config,
+    file_path_cache_t &file_paths, CXTranslationUnit unit,
+    const boost::filesystem::path &tu_path, std::vector<include_edge_t> &edges)
+{
+    // Temporaries are allocated in the arena of the translation unit
+    auto &arena = translation_unit_arena();
+
+    inclusion_tree_t tree{arena};
+    clang_getInclusions(unit, inclusion_visitor, &tree);
+
+    include_edges_collector_t{
+        config, file_paths, unit, tree, tu_path, edges, arena}
+        .collect();
 }
 
 } // namespace clang_include_graph
@@ -20,22 +20,96 @@
 #define CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_PARSER_H
 
 #include "config.h"
+#include "coordinator.h"
+#include "file_path_cache.h"
 #include "include_graph.h"
+#include "include_scanner.h"
+#include "memory_budget.h"
+#include "translation_unit_cache.h"
+#include "translation_unit_schedule.h"
 
 #include <boost/asio/thread_pool.hpp>
 #include <clang-c/CXCompilationDatabase.h>
 #include <clang-c/Index.h>
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace clang_include_graph {
 
-void process_translation_unit(include_graph_t &include_graph,
-    CXCompileCommand command, const boost::filesystem::path &tu_path,
-    std::string &include_path_str, CXIndex &index);
+/**
+ * Cumulative parsing statistics, updated concurrently by the thread pool
+ * workers.
+ */
+struct parse_statistics_t {
+    std::atomic<std::uint64_t> translation_units{0};
+    std::atomic<std::uint64_t> parse_time_us{0};
+    // Only collected in `compare` parse mode
+    std::atomic<std::uint64_t> full_parse_time_us{0};
+    // Only collected in `scan` parse mode
+    std::atomic<std::uint64_t> scanned_translation_units{0};
+    std::atomic<std::uint64_t> scan_time_us{0};
+
+    void reset() noexcept
+    {
+        translation_units = 0;
+        parse_time_us = 0;
+        full_parse_time_us = 0;
+        scanned_translation_units = 0;
+        scan_time_us = 0;
+    }
+};
+
+/**
+ * Translation unit selected from the compilation database for parsing.
+ */
+struct translation_unit_job_t {
+    boost::filesystem::path tu_path;
+    std::string include_path_str;
+    CXCompileCommand command;
+    // Only set with `--cache-dir`
+    std::string cache_key;
+};
+
+unsigned int translation_unit_flags(parse_mode_t parse_mode);
+
+/**
+ * Parse translation unit with libclang and append its include edges to
+ * `edges`. The memory used by the parsed translation unit, as reported by
+ * libclang, is returned in `memory_usage`.
+ *
+ * @return False and an error message if libclang failed to parse it
+ */
+bool process_translation_unit(const config_t &config,
+    file_path_cache_t &file_paths, std::vector<std::string> args,
+    const boost::filesystem::path &tu_path,
+    std::string &include_path_str, CXIndex &index,
+    parse_statistics_t &statistics, std::vector<include_edge_t> &edges,
+    std::uint64_t &memory_usage, std::string &error);
+
+void collect_include_edges(const config_t &config,
+    file_path_cache_t &file_paths, CXTranslationUnit unit,
+    const boost::filesystem::path &tu_path, std::vector<include_edge_t> &edges);
+
+bool scan_translation_unit(const config_t &config, include_scanner_t &scanner,
+    const std::vector<std::string> &args, const std::string &directory,
+    const boost::filesystem::path &tu_path, parse_statistics_t &statistics,
+    std::vector<include_edge_t> &edges);
+
+/**
+ * Check whether edge is filtered out by `--exclude-system-headers` or
+ * `--relative-only` options.
+ */
+bool is_excluded_include_edge(
+    const config_t &config, const include_edge_t &edge);
 
 bool is_system_header(CXTranslationUnit tu, CXCursor cursor);
 
@@ -51,12 +125,128 @@ public:
 
     void parse(include_graph_t &include_graph);
 
+    /**
+     * Parse again only the translation units which include any of the
+     * modified files and rebuild the graph from the edges of all
+     * translation units. Requires `--watch`.
+     *
+     * @return False if none of the translation units is affected
+     */
+    bool update(include_graph_t &include_graph,
+        const std::set<std::string> &modified_files);
+
+    /**
+     * Parse translation units served by the coordinator at the `--worker`
+     * endpoint, over `--jobs` connections, until it has no more.
+     *
+     * @return False if connecting to the coordinator failed
+     */
+    bool parse_for_coordinator();
+
+    /**
+     * Translation units and all files included by them, which have to be
+     * watched for modifications. Requires `--watch`.
+     */
+    std::set<std::string> dependencies() const;
+
     const std::set<boost::filesystem::path> &translation_units() const;
 
+    const parse_statistics_t &statistics() const;
+
+    /**
+     * Translation units which failed in worker processes, with the reason
+     * of each failure.
+     */
+    const std::map<boost::filesystem::path, std::string> &
+    failed_translation_units() const;
+
 private:
-    CXIndex index_;
+    bool process_job(translation_unit_job_t &job, CXIndex &index,
+        parse_statistics_t &statistics, std::vector<include_edge_t> &edges,
+        std::uint64_t &memory_usage, std::string &error);
+
+    bool process_remote_job(const remote_job_t &job, CXIndex &index,
+        parse_statistics_t &statistics, std::vector<include_edge_t> &edges,
+        std::string &error);
+
+    /**
+     * Add edges of cached translation units to the graph.
+     *
+     * @return Jobs of translation units which are not cached
+     */
+    std::vector<translation_unit_job_t> load_cached_translation_units(
+        include_graph_t &include_graph,
+        std::vector<translation_unit_job_t> &jobs);
+
+    /**
+     * Add edges of a translation unit to the graph, applying edge filters
+     * skipped by the frontends when the cache or watch mode is enabled.
+     */
+    void add_edges(include_graph_t &include_graph,
+        const translation_unit_job_t &job, std::vector<include_edge_t> &edges);
+
+    void filter_edges(std::vector<include_edge_t> &edges) const;
+
+    /**
+     * Parse translation units in the order selected by `--schedule`, then
+     * report how close the time it took was to the ideal schedule.
+     */
+    void parse_jobs(include_graph_t &include_graph,
+        std::vector<translation_unit_job_t> &jobs);
+
+    void record_parse_time(
+        const translation_unit_job_t &job, std::uint64_t duration_us);
+
+    void parse_in_thread_pool(include_graph_t &include_graph,
+        std::vector<translation_unit_job_t> &jobs);
+
+    void parse_in_worker_processes(include_graph_t &include_graph,
+        std::vector<translation_unit_job_t> &jobs);
+
+    void parse_in_coordinator(include_graph_t &include_graph,
+        std::vector<translation_unit_job_t> &jobs);
+
+    void log_statistics(
+        const include_graph_t &include_graph, std::uint64_t wall_time_us) const;
+
+    CXIndex create_index() const;
+
+    /**
+     * Get the index used by the calling thread, which is created on first
+     * use unless a single index is shared by all threads.
+     */
+    CXIndex &thread_index();
+
     const config_t &config_;
+    // Configuration of the frontends, which is `config_` without edge
+    // filters if the cache, watch or distributed mode is enabled
+    config_t frontend_config_;
+    bool filter_edges_{false};
+    // Only used with `--shared-index`
+    CXIndex index_{nullptr};
+
+    std::mutex indices_mutex_;
+    std::map<std::thread::id, CXIndex> indices_;
+
     std::set<boost::filesystem::path> translation_units_;
+    std::vector<translation_unit_job_t> jobs_;
+    // Unfiltered edges of each translation unit, only kept with `--watch`
+    std::mutex translation_unit_edges_mutex_;
+    std::map<boost::filesystem::path, std::vector<include_edge_t>>
+        translation_unit_edges_;
+    std::map<boost::filesystem::path, std::string> failed_translation_units_;
+    parse_statistics_t statistics_;
+    std::unique_ptr<include_scanner_t> scanner_;
+    std::unique_ptr<translation_unit_cache_t> cache_;
+    std::unique_ptr<parse_timings_t> timings_;
+    // Only used with `--coordinator`
+    std::unique_ptr<coordinator_t> coordinator_;
+    // Only used with `--max-memory`, in bytes
+    std::uint64_t memory_limit_{0};
+    // Parse times of translation units parsed by the current `parse_jobs()`
+    std::mutex parse_times_mutex_;
+    std::vector<std::uint64_t> parse_times_us_;
+    file_path_cache_t file_paths_;
 };
 
 } // namespace clang_include_graph
@@ -40,9 +40,8 @@ void include_graph_plantuml_printer_t::operator()(std::ostream &os) const
 
     std::for_each(vertex_begin, vertex_end,
         [&](const include_graph_t::graph_t::vertex_descriptor &v) {
-            const auto &vertex = include_graph().graph().graph()[v];
-            os << "file \"" << path_printer().print(vertex) << "\" as F_" << v
-               << '\n';
+            os << "file \"" << path_printer().print(include_graph().file(v))
+               << "\" as F_" << v << '\n';
         });
 
     // Now generate include relationships based on edge list
@@ -0,0 +1,168 @@
+/**
+ * src/include_graph_shard.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_graph_shard.h"
+#include "include_graph_parser.h"
+#include "translation_unit_cache.h"
+
+#include <boost/range/iterator_range.hpp>
+
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang_include_graph {
+
+namespace {
+// Increment whenever the format of partial graphs changes
+constexpr auto partial_graph_format = "clang-include-graph-partial-graph 1";
+
+constexpr unsigned translation_unit_flag{1U};
+constexpr unsigned is_system_flag{1U};
+
+struct partial_vertex_t {
+    std::string file;
+    std::string include_spelling;
+    bool is_translation_unit{false};
+};
+
+std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> result;
+    std::string::size_type start{0};
+    for (;;) {
+        const auto end = line.find('\t', start);
+        result.emplace_back(line.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return result;
+}
+} // namespace
+
+bool is_in_shard(const boost::filesystem::path &tu_path,
+    const boost::filesystem::path &compilation_database_directory,
+    const shard_t &shard)
+{
+    auto relative_path = tu_path.lexically_relative(
+        compilation_database_directory.lexically_normal());
+    if (relative_path.empty())
+        relative_path = tu_path;
+
+    const auto key = relative_path.generic_string();
+
+    return fnv1a_hash(key.data(), key.size()) % shard.count ==
+        shard.number - 1;
+}
+
+void write_partial_include_graph(
+    std::ostream &os, const include_graph_t &include_graph)
+{
+    const auto &graph = include_graph.graph().graph();
+    const auto is_reversed =
+        include_graph.printer() == printer_t::reverse_tree ||
+        include_graph.printer() == printer_t::dependants;
+
+    os << partial_graph_format << '\n';
+
+    // Vertices are stored in a vector, so their descriptors are the indices
+    // of vertex lines
+    const auto &properties = include_graph.vertex_properties();
+    for (auto v : boost::make_iterator_range(boost::vertices(graph))) {
+        os << "V\t"
+           << (properties.is_translation_unit(v) ? translation_unit_flag : 0U)
+           << '\t' << include_graph.file(v) << '\t'
+           << include_graph.include_spelling(v) << '\n';
+    }
+
+    for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+        auto from = boost::source(e, graph);
+        auto to = boost::target(e, graph);
+        if (is_reversed)
+            std::swap(from, to);
+
+        os << "E\t" << (graph[e].is_system ? is_system_flag : 0U) << '\t'
+           << from << '\t' << to << '\n';
+    }
+}
+
+bool read_partial_include_graph(
+    std::istream &is, const config_t &config, include_graph_t &include_graph)
+{
+    std::string line;
+    if (!std::getline(is, line) || line != partial_graph_format)
+        return false;
+
+    std::vector<partial_vertex_t> vertices;
+    std::vector<include_edge_t> edges;
+
+    while (std::getline(is, line)) {
+        const auto fields = split(line);
+        if (fields.size() != 4 || (fields[0] != "V" && fields[0] != "E"))
+            return false;
+
+        unsigned long flags{0};
+        try {
+            flags = std::stoul(fields[1]);
+        }
+        catch (const std::exception & /*e*/) {
+            return false;
+        }
+
+        if (fields[0] == "V") {
+            partial_vertex_t vertex;
+            vertex.file =
+                boost::filesystem::path{fields[2]}.lexically_normal().string();
+            vertex.include_spelling = fields[3];
+            vertex.is_translation_unit = (flags & translation_unit_flag) != 0U;
+            vertices.emplace_back(std::move(vertex));
+            continue;
+        }
+
+        std::size_t from{0};
+        std::size_t to{0};
+        try {
+            from = std::stoull(fields[2]);
+            to = std::stoull(fields[3]);
+        }
+        catch (const std::exception & /*e*/) {
+            return false;
+        }
+
+        if (from >= vertices.size() || to >= vertices.size())
+            return false;
+
+        include_edge_t edge;
+        edge.from = vertices[from].file;
+        edge.to = vertices[to].file;
+        edge.include_spelling = vertices[to].include_spelling;
+        edge.from_translation_unit = vertices[from].is_translation_unit;
+        edge.is_system = (flags & is_system_flag) != 0U;
+
+        if (!is_excluded_include_edge(config, edge))
+            edges.emplace_back(std::move(edge));
+    }
+
+    include_graph.add_edges(edges);
+
+    return true;
+}
+
+} // namespace clang_include_graph
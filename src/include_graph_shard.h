@@ -0,0 +1,70 @@
+/**
+ * src/include_graph_shard.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SHARD_H
+#define CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SHARD_H
+
+#include "config.h"
+#include "include_graph.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <istream>
+#include <ostream>
+
+namespace clang_include_graph {
+
+/**
+ * Check whether a translation unit belongs to a shard.
+ *
+ * Translation units are assigned by a hash of their path relative to the
+ * compilation database directory, so that all shards agree on the
+ * assignment regardless of the order of the compilation database and of
+ * where the sources are checked out.
+ */
+bool is_in_shard(const boost::filesystem::path &tu_path,
+    const boost::filesystem::path &compilation_database_directory,
+    const shard_t &shard);
+
+/**
+ * Write include graph in a format which can be merged with other partial
+ * graphs by `read_partial_include_graph()`.
+ *
+ * The format is text with a `V\t<flags>\t<path>\t<include spelling>` line
+ * per vertex, followed by an `E\t<flags>\t<from>\t<to>` line per edge,
+ * where `<from>` and `<to>` are indices of vertex lines. Edges are always
+ * written from the including file to the included one, regardless of the
+ * direction used by the printer of the graph.
+ */
+void write_partial_include_graph(
+    std::ostream &os, const include_graph_t &include_graph);
+
+/**
+ * Add vertices and edges of a partial include graph to the graph, except
+ * edges filtered out by the `--exclude-system-headers` or `--relative-only`
+ * options. Vertices of different partial graphs are identified by their
+ * normalized paths.
+ *
+ * @return False if the input is not a valid partial include graph
+ */
+bool read_partial_include_graph(
+    std::istream &is, const config_t &config, include_graph_t &include_graph);
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SHARD_H
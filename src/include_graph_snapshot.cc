@@ -0,0 +1,452 @@
+/**
+ * src/include_graph_snapshot.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_graph_snapshot.h"
+#include "include_graph_parser.h"
+
+#include <boost/range/iterator_range.hpp>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace clang_include_graph {
+
+namespace {
+constexpr std::array<char, 8> snapshot_magic{
+    {'C', 'I', 'G', 'R', 'A', 'P', 'H', '\0'}};
+
+// Increment whenever the layout of snapshots changes
+constexpr std::uint32_t snapshot_version{1U};
+
+// Reads differently on hosts with another byte order
+constexpr std::uint32_t byte_order_mark{0x01020304U};
+
+constexpr std::uint32_t system_header_flag{1U};
+constexpr std::uint32_t is_system_flag{1U};
+
+struct snapshot_header_t {
+    std::array<char, 8> magic;
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t vertex_count;
+    std::uint64_t edge_count;
+    std::uint64_t translation_unit_count;
+    std::uint64_t strings_size;
+};
+
+struct snapshot_vertex_t {
+    std::uint64_t path_offset;
+    std::uint64_t include_spelling_offset;
+    std::uint32_t path_size;
+    std::uint32_t include_spelling_size;
+    std::uint32_t flags;
+    std::uint32_t reserved;
+};
+
+// Edges are grouped by the including file, so only the included file is
+// stored
+struct snapshot_edge_t {
+    std::uint32_t target;
+    std::uint32_t flags;
+};
+
+// Vertex read from a snapshot, before it's added to the graph
+struct loaded_vertex_t {
+    std::string file;
+    std::string include_spelling;
+    bool is_system_header{false};
+    bool is_translation_unit{false};
+};
+
+static_assert(sizeof(snapshot_header_t) == 48, "Unexpected header size");
+static_assert(sizeof(snapshot_vertex_t) == 32, "Unexpected vertex size");
+static_assert(sizeof(snapshot_edge_t) == 8, "Unexpected edge size");
+
+std::uint64_t align8(std::uint64_t size) { return (size + 7U) & ~7ULL; }
+
+/**
+ * Offsets of sections in a snapshot.
+ */
+struct snapshot_layout_t {
+    std::uint64_t vertices;
+    // `vertex_count` + 1 offsets into edges
+    std::uint64_t edge_offsets;
+    std::uint64_t edges;
+    // Indices into edges in the order they were added to the graph
+    std::uint64_t edge_order;
+    std::uint64_t translation_units;
+    std::uint64_t strings;
+    std::uint64_t size;
+};
+
+snapshot_layout_t get_layout(const snapshot_header_t &header)
+{
+    snapshot_layout_t layout{};
+    layout.vertices = sizeof(snapshot_header_t);
+    layout.edge_offsets =
+        layout.vertices + header.vertex_count * sizeof(snapshot_vertex_t);
+    layout.edges = layout.edge_offsets +
+        (header.vertex_count + 1) * sizeof(std::uint64_t);
+    layout.edge_order =
+        layout.edges + header.edge_count * sizeof(snapshot_edge_t);
+    layout.translation_units =
+        layout.edge_order + header.edge_count * sizeof(std::uint64_t);
+    layout.strings = layout.translation_units +
+        align8(header.translation_unit_count * sizeof(std::uint32_t));
+    layout.size = layout.strings + header.strings_size;
+    return layout;
+}
+
+template <typename T>
+void write_section(std::ofstream &ofs, const std::vector<T> &section)
+{
+    ofs.write(reinterpret_cast<const char *>(section.data()),
+        static_cast<std::streamsize>(section.size() * sizeof(T)));
+}
+
+template <typename T>
+const T *section(const mapped_file_t &file, std::uint64_t offset)
+{
+    return reinterpret_cast<const T *>(file.data() + offset);
+}
+} // namespace
+
+mapped_file_t::mapped_file_t(const boost::filesystem::path &path)
+{
+#if !defined(_WIN32)
+    const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat file_stat {};
+    if (fstat(fd, &file_stat) == 0) {
+        size_ = static_cast<std::size_t>(file_stat.st_size);
+        if (size_ == 0) {
+            data_ = buffer_.data();
+        }
+        else {
+            auto *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                data_ = static_cast<const char *>(data);
+                is_mapped_ = true;
+            }
+        }
+    }
+
+    ::close(fd);
+#else
+    std::ifstream ifs{path.string(), std::ios::binary};
+    if (!ifs)
+        return;
+
+    buffer_.assign(std::istreambuf_iterator<char>{ifs},
+        std::istreambuf_iterator<char>{});
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+}
+
+mapped_file_t::~mapped_file_t()
+{
+#if !defined(_WIN32)
+    if (is_mapped_)
+        munmap(const_cast<char *>(data_), size_);
+#endif
+}
+
+bool mapped_file_t::is_open() const noexcept { return data_ != nullptr; }
+
+const char *mapped_file_t::data() const noexcept { return data_; }
+
+std::size_t mapped_file_t::size() const noexcept { return size_; }
+
+bool save_include_graph(
+    const include_graph_t &include_graph, const boost::filesystem::path &path)
+{
+    const auto &graph = include_graph.graph().graph();
+    const auto is_reversed =
+        include_graph.printer() == printer_t::reverse_tree ||
+        include_graph.printer() == printer_t::dependants;
+
+    if (boost::num_vertices(graph) > std::numeric_limits<std::uint32_t>::max())
+        return false;
+
+    // Each distinct path and include spelling is stored only once
+    std::string strings;
+    std::unordered_map<std::string, std::uint64_t> string_offsets;
+    const auto intern = [&strings, &string_offsets](const std::string &value) {
+        const auto it = string_offsets.emplace(value, strings.size());
+        if (it.second)
+            strings.append(value);
+        return it.first->second;
+    };
+
+    std::vector<snapshot_vertex_t> vertices;
+    std::vector<std::uint32_t> translation_units;
+
+    // Vertices are stored in a vector, so their descriptors are indices
+    const auto &properties = include_graph.vertex_properties();
+    for (auto v : boost::make_iterator_range(boost::vertices(graph))) {
+        const auto file = include_graph.file(v);
+        const auto include_spelling = include_graph.include_spelling(v);
+
+        snapshot_vertex_t snapshot_vertex{};
+        snapshot_vertex.path_offset = intern(file);
+        snapshot_vertex.path_size = static_cast<std::uint32_t>(file.size());
+        snapshot_vertex.include_spelling_offset = intern(include_spelling);
+        snapshot_vertex.include_spelling_size =
+            static_cast<std::uint32_t>(include_spelling.size());
+        if (properties.is_system_header(v))
+            snapshot_vertex.flags |= system_header_flag;
+        vertices.emplace_back(snapshot_vertex);
+
+        if (properties.is_translation_unit(v))
+            translation_units.emplace_back(static_cast<std::uint32_t>(v));
+    }
+
+    // Edges are always stored from the including file
+    const auto including_file = [&graph, is_reversed](auto e) {
+        return static_cast<std::uint32_t>(
+            is_reversed ? boost::target(e, graph) : boost::source(e, graph));
+    };
+    const auto included_file = [&graph, is_reversed](auto e) {
+        return static_cast<std::uint32_t>(
+            is_reversed ? boost::source(e, graph) : boost::target(e, graph));
+    };
+
+    std::vector<std::uint64_t> edge_offsets(vertices.size() + 1, 0);
+    for (auto e : boost::make_iterator_range(boost::edges(graph)))
+        edge_offsets[including_file(e) + 1]++;
+    for (std::size_t v = 0; v < vertices.size(); v++)
+        edge_offsets[v + 1] += edge_offsets[v];
+
+    // Printers iterating over all edges see them in the order they were
+    // added, which is kept in a separate section
+    std::vector<snapshot_edge_t> edges(edge_offsets.back());
+    std::vector<std::uint64_t> edge_order;
+    edge_order.reserve(edges.size());
+    {
+        auto next_edge = edge_offsets;
+        for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+            const auto index = next_edge[including_file(e)]++;
+            edges[index] = {
+                included_file(e), graph[e].is_system ? is_system_flag : 0U};
+            edge_order.emplace_back(index);
+        }
+    }
+
+    snapshot_header_t header{};
+    header.magic = snapshot_magic;
+    header.version = snapshot_version;
+    header.byte_order = byte_order_mark;
+    header.vertex_count = vertices.size();
+    header.edge_count = edges.size();
+    header.translation_unit_count = translation_units.size();
+    header.strings_size = strings.size();
+
+    translation_units.resize(
+        align8(translation_units.size() * sizeof(std::uint32_t)) /
+        sizeof(std::uint32_t));
+
+    std::ofstream ofs{path.string(), std::ios::binary};
+    ofs.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    write_section(ofs, vertices);
+    write_section(ofs, edge_offsets);
+    write_section(ofs, edges);
+    write_section(ofs, edge_order);
+    write_section(ofs, translation_units);
+    ofs.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+    return static_cast<bool>(ofs);
+}
+
+bool load_include_graph(const boost::filesystem::path &path,
+    const config_t &config, include_graph_t &include_graph, std::string &error)
+{
+    const mapped_file_t file{path};
+    if (!file.is_open()) {
+        error = "cannot open file";
+        return false;
+    }
+
+    snapshot_header_t header{};
+    if (file.size() < sizeof(header)) {
+        error = "not an include graph snapshot";
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    if (header.magic != snapshot_magic) {
+        error = "not an include graph snapshot";
+        return false;
+    }
+
+    if (header.byte_order != byte_order_mark) {
+        error = "snapshot was saved on a host with a different byte order";
+        return false;
+    }
+
+    if (header.version != snapshot_version) {
+        error =
+            "unsupported snapshot version " + std::to_string(header.version);
+        return false;
+    }
+
+    // Counts are checked against the file size first, so that computing the
+    // layout can't overflow
+    if (header.vertex_count > file.size() / sizeof(snapshot_vertex_t) ||
+        header.edge_count > file.size() / sizeof(snapshot_edge_t) ||
+        header.translation_unit_count > file.size() / sizeof(std::uint32_t) ||
+        header.strings_size > file.size() ||
+        get_layout(header).size != file.size()) {
+        error = "snapshot is truncated or corrupted";
+        return false;
+    }
+
+    const auto layout = get_layout(header);
+    const auto vertex_count = static_cast<std::size_t>(header.vertex_count);
+    const auto *vertices = section<snapshot_vertex_t>(file, layout.vertices);
+    const auto *edge_offsets =
+        section<std::uint64_t>(file, layout.edge_offsets);
+    const auto *edges = section<snapshot_edge_t>(file, layout.edges);
+    const auto *edge_order = section<std::uint64_t>(file, layout.edge_order);
+    const auto *translation_units =
+        section<std::uint32_t>(file, layout.translation_units);
+    const auto *strings = file.data() + layout.strings;
+
+    const auto is_valid_string = [&header](
+                                     std::uint64_t offset, std::uint64_t size) {
+        return offset <= header.strings_size &&
+            size <= header.strings_size - offset;
+    };
+
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        if (!is_valid_string(vertices[v].path_offset, vertices[v].path_size) ||
+            !is_valid_string(vertices[v].include_spelling_offset,
+                vertices[v].include_spelling_size) ||
+            edge_offsets[v] > edge_offsets[v + 1]) {
+            error = "snapshot is truncated or corrupted";
+            return false;
+        }
+    }
+
+    if (edge_offsets[0] != 0 ||
+        edge_offsets[vertex_count] != header.edge_count) {
+        error = "snapshot is truncated or corrupted";
+        return false;
+    }
+
+    std::vector<bool> is_ordered_edge(header.edge_count, false);
+    for (std::uint64_t e = 0; e < header.edge_count; e++) {
+        if (edges[e].target >= vertex_count ||
+            edge_order[e] >= header.edge_count ||
+            is_ordered_edge[edge_order[e]]) {
+            error = "snapshot is truncated or corrupted";
+            return false;
+        }
+        is_ordered_edge[edge_order[e]] = true;
+    }
+
+    std::vector<loaded_vertex_t> graph_vertices(vertex_count);
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        auto &vertex = graph_vertices[v];
+        vertex.file.assign(
+            strings + vertices[v].path_offset, vertices[v].path_size);
+        vertex.include_spelling.assign(
+            strings + vertices[v].include_spelling_offset,
+            vertices[v].include_spelling_size);
+        vertex.is_system_header =
+            (vertices[v].flags & system_header_flag) != 0U;
+    }
+
+    for (std::uint64_t i = 0; i < header.translation_unit_count; i++) {
+        if (translation_units[i] >= vertex_count) {
+            error = "snapshot is truncated or corrupted";
+            return false;
+        }
+        graph_vertices[translation_units[i]].is_translation_unit = true;
+    }
+
+    // Without filters all vertices are kept, so that they get the same
+    // descriptors as in the saved graph
+    const auto is_filtered =
+        config.exclude_system_headers() || config.relative_only();
+
+    std::vector<std::uint32_t> edge_sources(header.edge_count);
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        for (auto e = edge_offsets[v]; e < edge_offsets[v + 1]; e++)
+            edge_sources[e] = static_cast<std::uint32_t>(v);
+    }
+
+    std::vector<bool> is_kept_edge(header.edge_count, true);
+    std::vector<bool> is_kept_vertex(vertex_count, !is_filtered);
+
+    if (is_filtered) {
+        for (std::uint64_t e = 0; e < header.edge_count; e++) {
+            include_edge_t edge;
+            edge.from = graph_vertices[edge_sources[e]].file;
+            edge.to = graph_vertices[edges[e].target].file;
+            edge.is_system = (edges[e].flags & is_system_flag) != 0U;
+
+            is_kept_edge[e] = !is_excluded_include_edge(config, edge);
+            if (is_kept_edge[e]) {
+                is_kept_vertex[edge_sources[e]] = true;
+                is_kept_vertex[edges[e].target] = true;
+            }
+        }
+    }
+
+    std::vector<include_graph_t::graph_t::vertex_descriptor> descriptors(
+        vertex_count);
+    for (std::size_t v = 0; v < vertex_count; v++) {
+        if (!is_kept_vertex[v])
+            continue;
+
+        const auto &vertex = graph_vertices[v];
+        descriptors[v] = include_graph.add_vertex(vertex.file,
+            vertex.include_spelling, vertex.is_system_header,
+            vertex.is_translation_unit);
+    }
+
+    for (std::uint64_t i = 0; i < header.edge_count; i++) {
+        const auto e = edge_order[i];
+        if (!is_kept_edge[e])
+            continue;
+
+        include_graph.add_edge_between(descriptors[edge_sources[e]],
+            descriptors[edges[e].target],
+            (edges[e].flags & is_system_flag) != 0U);
+    }
+
+    return true;
+}
+
+} // namespace clang_include_graph
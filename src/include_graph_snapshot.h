@@ -0,0 +1,89 @@
+/**
+ * src/include_graph_snapshot.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SNAPSHOT_H
+#define CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SNAPSHOT_H
+
+#include "config.h"
+#include "include_graph.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace clang_include_graph {
+
+/**
+ * Read-only memory mapping of a whole file, or a copy of it in memory on
+ * systems without `mmap`.
+ */
+class mapped_file_t {
+public:
+    explicit mapped_file_t(const boost::filesystem::path &path);
+
+    ~mapped_file_t();
+    mapped_file_t(const mapped_file_t &) = delete;
+    mapped_file_t(mapped_file_t &&) = delete;
+    mapped_file_t &operator=(const mapped_file_t &) = delete;
+    mapped_file_t &operator=(mapped_file_t &&) = delete;
+
+    bool is_open() const noexcept;
+
+    const char *data() const noexcept;
+
+    std::size_t size() const noexcept;
+
+private:
+    const char *data_{nullptr};
+    std::size_t size_{0};
+    bool is_mapped_{false};
+    std::string buffer_;
+};
+
+/**
+ * Save include graph in a binary snapshot, which `load_include_graph()`
+ * reads without parsing.
+ *
+ * The snapshot consists of a header, a table of vertices referring to
+ * a table of distinct paths and include spellings, the edges of each
+ * vertex in the compressed sparse row layout, the order in which edges
+ * were added and a list of translation units. All sections are aligned
+ * and use native byte order, so they can be used directly from a memory
+ * mapping of the file.
+ *
+ * @return False if the file couldn't be written
+ */
+bool save_include_graph(
+    const include_graph_t &include_graph, const boost::filesystem::path &path);
+
+/**
+ * Add vertices and edges of a snapshot to an empty graph, except edges
+ * filtered out by the `--exclude-system-headers` or `--relative-only`
+ * options and vertices left without edges by them.
+ *
+ * @return False and an error message if the snapshot is invalid, or was
+ *         written on a host with a different byte order
+ */
+bool load_include_graph(const boost::filesystem::path &path,
+    const config_t &config, include_graph_t &include_graph,
+    std::string &error);
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_INCLUDE_GRAPH_SNAPSHOT_H
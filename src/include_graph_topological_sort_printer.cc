@@ -18,12 +18,8 @@
 
 #include "include_graph_topological_sort_printer.h"
 
-#include <boost/graph/topological_sort.hpp>
-
 #include <cassert>
 #include <iostream>
-#include <iterator>
-#include <vector>
 
 namespace clang_include_graph {
 
@@ -32,12 +28,8 @@ void include_graph_topological_sort_printer_t::operator()(
 {
     assert(include_graph().dag());
 
-    std::vector<include_graph_t::graph_t::vertex_descriptor> include_order;
-    boost::topological_sort(
-        include_graph().dag().value(), std::back_inserter(include_order));
-
-    for (const auto id : include_order) {
-        os << path_printer().print(include_graph().graph().graph()[id]) << '\n';
+    for (const auto id : include_graph().dag()->finish_order()) {
+        os << path_printer().print(include_graph().file(id)) << '\n';
     }
 }
 
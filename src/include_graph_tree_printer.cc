@@ -18,11 +18,6 @@
 
 #include "include_graph_tree_printer.h"
 
-#include <boost/graph/detail/adjacency_list.hpp>
-#include <boost/graph/graph_traits.hpp>
-#include <boost/graph/labeled_graph.hpp>
-#include <boost/tuple/tuple.hpp>
-
 #include <algorithm>
 #include <cassert>
 #include <iterator>
@@ -41,44 +36,39 @@ void include_graph_tree_printer_t::operator()(std::ostream &os) const
 {
     assert(include_graph().dag());
 
-    auto begin = boost::vertices(include_graph().dag().value().graph()).first;
-    auto end = boost::vertices(include_graph().dag().value().graph()).second;
-
-    std::for_each(
-        begin, end, [&](const include_graph_t::graph_t::vertex_descriptor &v) {
-            const auto &graph = include_graph().graph().graph();
-            const auto &vertex = graph[v];
+    const auto &frozen_graph = include_graph().frozen_graph().value();
+    const auto vertex_count = include_graph().dag()->vertex_count();
 
-            bool is_tree_root{false};
+    std::vector<vertex_properties_t::vertex_index_t> roots;
 
-            if (include_graph().printer() == printer_t::reverse_tree) {
-                is_tree_root =
-                    (boost::in_degree(v, include_graph().graph()) == 0);
-            }
-            else {
-                is_tree_root = vertex.is_translation_unit;
-            }
+    if (include_graph().printer() == printer_t::reverse_tree) {
+        for (frozen_graph_t::vertex_id_t v = 0; v < vertex_count; v++) {
+            if (frozen_graph.in_degree(v) == 0)
+                roots.emplace_back(v);
+        }
+    }
+    else {
+        roots = include_graph().vertex_properties().translation_units(
+            vertex_count);
+    }
 
-            if (is_tree_root) {
-                os << path_printer().print(vertex) << '\n';
-                print_tu_subtree(os, v, 0, include_graph(), {});
-            }
-        });
+    for (const auto root : roots) {
+        const auto v = static_cast<frozen_graph_t::vertex_id_t>(root);
+        os << path_printer().print(include_graph().file(v)) << '\n';
+        print_tu_subtree(os, v, 0, include_graph(), {});
+    }
 }
 
 void include_graph_tree_printer_t::print_tu_subtree(std::ostream &os,
-    const include_graph_t::graph_t::vertex_descriptor tu_id,
+    const frozen_graph_t::vertex_id_t tu_id,
     const unsigned int level, const include_graph_t &include_graph,
     std::vector<bool> continuation_line) const
 {
     const auto kIndentWidth = 4U;
 
-    boost::graph_traits<include_graph_t::graph_t>::adjacency_iterator it;
-    boost::graph_traits<include_graph_t::graph_t>::adjacency_iterator it_end;
-
-    boost::tie(it, it_end) =
-        boost::adjacent_vertices(tu_id, include_graph.dag().value().graph());
-    for (; it != it_end; ++it) {
+    const auto includes = include_graph.dag()->out(tu_id);
+    const auto it_end = includes.end();
+    for (auto it = includes.begin(); it != it_end; ++it) {
         auto continuation_line_tmp = continuation_line;
         if (level > 0) {
             for (auto i = 0U; i < level; i++) {
@@ -113,7 +103,7 @@ void include_graph_tree_printer_t::print_tu_subtree(std::ostream &os,
             continuation_line_tmp.push_back(true);
         }
 
-        os << path_printer().print(include_graph.graph().graph()[*it]) << '\n';
+        os << path_printer().print(include_graph.file(*it)) << '\n';
         print_tu_subtree(os, *it, level + kIndentWidth, include_graph,
             continuation_line_tmp);
     }
@@ -44,7 +44,7 @@ public:
 
 private:
     void print_tu_subtree(std::ostream &os,
-        include_graph_t::graph_t::vertex_descriptor tu_id, unsigned int level,
+        frozen_graph_t::vertex_id_t tu_id, unsigned int level,
         const include_graph_t &include_graph,
         std::vector<bool> continuation_line) const;
 };
@@ -0,0 +1,2015 @@
+/**
+ * src/include_scanner.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "include_scanner.h"
+#include "util.h"
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <set>
+#include <sstream>
+#include <utility>
+
+namespace clang_include_graph {
+
+/**
+ * Predefined macros and builtin header search directories of a single
+ * compiler configuration.
+ */
+struct compiler_info_t {
+    // Driver and flags, used to evaluate compiler specific feature checks
+    std::string command;
+    file_directives_t predefined_macros;
+    std::vector<std::string> quote_dirs;
+    std::vector<std::string> system_dirs;
+
+    std::mutex checks_mutex;
+    std::map<std::string, bool> checks;
+};
+
+namespace {
+
+constexpr auto kMaxIncludeDepth = 200U;
+constexpr auto kMaxMacroExpansions = 100000U;
+
+bool is_identifier_start(char c)
+{
+    return (std::isalpha(static_cast<unsigned char>(c)) != 0) || c == '_' ||
+        c == '$' || static_cast<unsigned char>(c) >= 0x80;
+}
+
+bool is_identifier_char(char c)
+{
+    return is_identifier_start(c) ||
+        (std::isdigit(static_cast<unsigned char>(c)) != 0);
+}
+
+bool is_digit(char c)
+{
+    return std::isdigit(static_cast<unsigned char>(c)) != 0;
+}
+
+bool is_horizontal_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+directive_kind_t classify_directive(
+    const std::string &name, const std::vector<pp_token_t> &tokens)
+{
+    static const std::unordered_map<std::string, directive_kind_t> kinds{
+        {"include", directive_kind_t::include},
+        {"include_next", directive_kind_t::include_next},
+        {"import", directive_kind_t::import},
+        {"define", directive_kind_t::define},
+        {"undef", directive_kind_t::undef},
+        {"if", directive_kind_t::if_},
+        {"ifdef", directive_kind_t::ifdef},
+        {"ifndef", directive_kind_t::ifndef},
+        {"elif", directive_kind_t::elif},
+        {"elifdef", directive_kind_t::elifdef},
+        {"elifndef", directive_kind_t::elifndef},
+        {"else", directive_kind_t::else_},
+        {"endif", directive_kind_t::endif}};
+
+    if (name == "pragma") {
+        if (!tokens.empty() && tokens.front().text == "once")
+            return directive_kind_t::pragma_once;
+        return directive_kind_t::other;
+    }
+
+    auto it = kinds.find(name);
+    if (it == kinds.end())
+        return directive_kind_t::other;
+
+    return it->second;
+}
+
+/**
+ * Lexer working on a copy of the source with line splices removed. Offsets
+ * are mapped back to the original buffer using the recorded splice
+ * positions.
+ */
+class directive_lexer_t {
+public:
+    directive_lexer_t(const char *data, std::size_t size)
+    {
+        text_.reserve(size);
+        for (std::size_t i = 0; i < size; i++) {
+            if (data[i] == '\\') {
+                auto j = i + 1;
+                while (j < size && (data[j] == ' ' || data[j] == '\t'))
+                    j++;
+                if (j < size && data[j] == '\r' && j + 1 < size &&
+                    data[j + 1] == '\n')
+                    j++;
+                if (j < size && data[j] == '\n') {
+                    splices_.emplace_back(text_.size(), j - i + 1);
+                    i = j;
+                    continue;
+                }
+            }
+            text_.push_back(data[i]);
+        }
+    }
+
+    file_directives_t lex()
+    {
+        file_directives_t result;
+
+        bool at_line_start{true};
+        while (pos_ < text_.size()) {
+            const auto c = text_[pos_];
+
+            if (c == '\n') {
+                at_line_start = true;
+                pos_++;
+            }
+            else if (is_horizontal_space(c)) {
+                pos_++;
+            }
+            else if (skip_comment()) {
+                // Comments don't change the line start state
+            }
+            else if (at_line_start && c == '#') {
+                lex_directive(result);
+            }
+            else {
+                at_line_start = false;
+                skip_token();
+            }
+        }
+
+        detect_include_guard(result);
+
+        return result;
+    }
+
+private:
+    char peek(std::size_t ahead = 0) const
+    {
+        return pos_ + ahead < text_.size() ? text_[pos_ + ahead] : '\0';
+    }
+
+    std::size_t original_offset(std::size_t offset) const
+    {
+        std::size_t result = offset;
+        for (const auto &splice : splices_) {
+            if (splice.first > offset)
+                break;
+            result += splice.second;
+        }
+        return result;
+    }
+
+    bool skip_comment()
+    {
+        if (peek() != '/')
+            return false;
+
+        if (peek(1) == '/') {
+            while (pos_ < text_.size() && text_[pos_] != '\n')
+                pos_++;
+            return true;
+        }
+
+        if (peek(1) == '*') {
+            const auto end = text_.find("*/", pos_ + 2);
+            pos_ = end == std::string::npos ? text_.size() : end + 2;
+            return true;
+        }
+
+        return false;
+    }
+
+    void skip_quoted(char quote)
+    {
+        pos_++;
+        while (pos_ < text_.size() && text_[pos_] != '\n') {
+            if (text_[pos_] == '\\') {
+                pos_ += 2;
+                continue;
+            }
+            if (text_[pos_++] == quote)
+                return;
+        }
+    }
+
+    void skip_raw_string()
+    {
+        // pos_ points at the opening '"'
+        const auto delimiter_start = pos_ + 1;
+        const auto paren = text_.find('(', delimiter_start);
+        if (paren == std::string::npos || paren - delimiter_start > 16) {
+            skip_quoted('"');
+            return;
+        }
+
+        const auto terminator =
+            ")" + text_.substr(delimiter_start, paren - delimiter_start) + "\"";
+        const auto end = text_.find(terminator, paren + 1);
+        pos_ = end == std::string::npos ? text_.size()
+                                        : end + terminator.size();
+    }
+
+    void skip_number()
+    {
+        pos_++;
+        while (pos_ < text_.size()) {
+            const auto c = text_[pos_];
+            if ((c == '+' || c == '-') &&
+                std::string{"eEpP"}.find(text_[pos_ - 1]) !=
+                    std::string::npos) {
+                pos_++;
+            }
+            else if (c == '\'' && pos_ + 1 < text_.size() &&
+                is_identifier_char(text_[pos_ + 1])) {
+                pos_ += 2;
+            }
+            else if (is_identifier_char(c) || c == '.') {
+                pos_++;
+            }
+            else {
+                break;
+            }
+        }
+    }
+
+    std::string read_identifier()
+    {
+        const auto start = pos_;
+        while (pos_ < text_.size() && is_identifier_char(text_[pos_]))
+            pos_++;
+        return text_.substr(start, pos_ - start);
+    }
+
+    static bool is_raw_string_prefix(const std::string &identifier)
+    {
+        return identifier == "R" || identifier == "u8R" ||
+            identifier == "uR" || identifier == "UR" || identifier == "LR";
+    }
+
+    static bool is_string_prefix(const std::string &identifier)
+    {
+        return identifier == "L" || identifier == "u8" || identifier == "u" ||
+            identifier == "U";
+    }
+
+    void skip_token()
+    {
+        const auto c = peek();
+        if (c == '"' || c == '\'') {
+            skip_quoted(c);
+        }
+        else if (is_identifier_start(c)) {
+            const auto identifier = read_identifier();
+            if (peek() == '"' && is_raw_string_prefix(identifier))
+                skip_raw_string();
+        }
+        else if (is_digit(c) || (c == '.' && is_digit(peek(1)))) {
+            skip_number();
+        }
+        else {
+            pos_++;
+        }
+    }
+
+    void lex_directive(file_directives_t &result)
+    {
+        directive_t directive;
+        directive.offset = original_offset(pos_);
+        pos_++;
+
+        while (pos_ < text_.size() && text_[pos_] != '\n') {
+            if (is_horizontal_space(text_[pos_]))
+                pos_++;
+            else if (!skip_comment())
+                break;
+        }
+
+        std::string name;
+        if (is_identifier_start(peek()))
+            name = read_identifier();
+
+        const bool header_name_allowed = name == "include" ||
+            name == "include_next" || name == "import";
+
+        lex_line_tokens(directive.tokens, header_name_allowed);
+
+        directive.kind = classify_directive(name, directive.tokens);
+        if (directive.kind == directive_kind_t::other)
+            return;
+
+        result.directives.emplace_back(std::move(directive));
+    }
+
+    void lex_line_tokens(
+        std::vector<pp_token_t> &tokens, bool header_name_allowed)
+    {
+        bool leading_space{true};
+        while (pos_ < text_.size() && text_[pos_] != '\n') {
+            const auto c = text_[pos_];
+
+            if (is_horizontal_space(c)) {
+                leading_space = true;
+                pos_++;
+                continue;
+            }
+
+            if (c == '/' && peek(1) == '/') {
+                skip_comment();
+                break;
+            }
+
+            if (skip_comment()) {
+                leading_space = true;
+                continue;
+            }
+
+            pp_token_t token;
+            token.has_leading_space = leading_space;
+            leading_space = false;
+
+            const auto start = pos_;
+
+            if (c == '<' &&
+                ((header_name_allowed && tokens.empty()) ||
+                    follows_has_include(tokens))) {
+                const auto end = text_.find_first_of(">\n", pos_ + 1);
+                if (end != std::string::npos && text_[end] == '>') {
+                    pos_ = end + 1;
+                    token.kind = pp_token_t::kind_t::header_name;
+                }
+                else {
+                    pos_++;
+                    token.kind = pp_token_t::kind_t::punctuator;
+                }
+            }
+            else if (c == '"' || c == '\'') {
+                skip_quoted(c);
+                token.kind = c == '"' ? pp_token_t::kind_t::string_literal
+                                      : pp_token_t::kind_t::char_literal;
+            }
+            else if (is_identifier_start(c)) {
+                const auto identifier = read_identifier();
+                token.kind = pp_token_t::kind_t::identifier;
+                if ((peek() == '"' || peek() == '\'') &&
+                    is_string_prefix(identifier)) {
+                    const auto quote = peek();
+                    skip_quoted(quote);
+                    token.kind = quote == '"'
+                        ? pp_token_t::kind_t::string_literal
+                        : pp_token_t::kind_t::char_literal;
+                }
+            }
+            else if (is_digit(c) || (c == '.' && is_digit(peek(1)))) {
+                skip_number();
+                token.kind = pp_token_t::kind_t::number;
+            }
+            else {
+                static const std::vector<std::string> punctuators{"...",
+                    "<<=", ">>=", "&&", "||", "==", "!=", "<=", ">=", "<<",
+                    ">>", "##", "->", "++", "--", "::"};
+                token.kind = pp_token_t::kind_t::punctuator;
+                auto length = 1U;
+                for (const auto &p : punctuators) {
+                    if (text_.compare(pos_, p.size(), p) == 0) {
+                        length = static_cast<unsigned>(p.size());
+                        break;
+                    }
+                }
+                pos_ += length;
+            }
+
+            token.text = text_.substr(start, pos_ - start);
+            tokens.emplace_back(std::move(token));
+        }
+    }
+
+    static bool follows_has_include(const std::vector<pp_token_t> &tokens)
+    {
+        return tokens.size() >= 2 && tokens.back().is_punctuator("(") &&
+            (tokens[tokens.size() - 2].text == "__has_include" ||
+                tokens[tokens.size() - 2].text == "__has_include_next");
+    }
+
+    static void detect_include_guard(file_directives_t &result)
+    {
+        const auto &directives = result.directives;
+        if (directives.size() < 3)
+            return;
+
+        const auto &first = directives.front();
+        std::string guard;
+        if (first.kind == directive_kind_t::ifndef &&
+            first.tokens.size() == 1) {
+            guard = first.tokens[0].text;
+        }
+        else if (first.kind == directive_kind_t::if_ &&
+            first.tokens.size() >= 3 && first.tokens[0].is_punctuator("!") &&
+            first.tokens[1].text == "defined") {
+            if (first.tokens.size() == 3)
+                guard = first.tokens[2].text;
+            else if (first.tokens.size() == 5 &&
+                first.tokens[2].is_punctuator("(") &&
+                first.tokens[4].is_punctuator(")"))
+                guard = first.tokens[3].text;
+        }
+
+        if (guard.empty())
+            return;
+
+        // The guard's #endif must be the last directive in the file
+        auto depth = 0;
+        for (auto i = 0U; i < directives.size(); i++) {
+            switch (directives[i].kind) {
+            case directive_kind_t::if_:
+            case directive_kind_t::ifdef:
+            case directive_kind_t::ifndef:
+                depth++;
+                break;
+            case directive_kind_t::endif:
+                depth--;
+                if (depth == 0 && i + 1 != directives.size())
+                    return;
+                break;
+            case directive_kind_t::elif:
+            case directive_kind_t::elifdef:
+            case directive_kind_t::elifndef:
+            case directive_kind_t::else_:
+                if (depth == 1)
+                    return;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (depth == 0)
+            result.include_guard = guard;
+    }
+
+    std::string text_;
+    // Pairs of (offset in text_, number of removed characters)
+    std::vector<std::pair<std::size_t, std::size_t>> splices_;
+    std::size_t pos_{0};
+};
+
+/**
+ * Value of a preprocessor constant expression.
+ */
+struct pp_value_t {
+    std::int64_t value{0};
+    bool is_unsigned{false};
+};
+
+/**
+ * Recursive descent evaluator of fully macro-expanded `#if` expressions.
+ */
+class expression_evaluator_t {
+public:
+    explicit expression_evaluator_t(const std::vector<pp_token_t> &tokens)
+        : tokens_{tokens}
+    {
+    }
+
+    bool evaluate()
+    {
+        const auto result = conditional();
+        if (pos_ != tokens_.size())
+            throw scanner_error_t{
+                "unexpected token '" + tokens_[pos_].text + "' in #if"};
+        return result.value != 0;
+    }
+
+private:
+    bool accept(const char *punctuator)
+    {
+        if (pos_ < tokens_.size() && tokens_[pos_].is_punctuator(punctuator)) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    void expect(const char *punctuator)
+    {
+        if (!accept(punctuator))
+            throw scanner_error_t{
+                std::string{"expected '"} + punctuator + "' in #if"};
+    }
+
+    static pp_value_t binary(const pp_value_t &lhs, const pp_value_t &rhs,
+        std::int64_t value, bool is_boolean = false)
+    {
+        pp_value_t result;
+        result.value = value;
+        result.is_unsigned =
+            !is_boolean && (lhs.is_unsigned || rhs.is_unsigned);
+        return result;
+    }
+
+    static bool is_unsigned(const pp_value_t &lhs, const pp_value_t &rhs)
+    {
+        return lhs.is_unsigned || rhs.is_unsigned;
+    }
+
+    static std::uint64_t u(const pp_value_t &v)
+    {
+        return static_cast<std::uint64_t>(v.value);
+    }
+
+    pp_value_t conditional()
+    {
+        const auto condition = logical_or();
+        if (!accept("?"))
+            return condition;
+
+        const auto previous = evaluated_;
+        evaluated_ = previous && condition.value != 0;
+        const auto lhs = conditional();
+        expect(":");
+        evaluated_ = previous && condition.value == 0;
+        const auto rhs = conditional();
+        evaluated_ = previous;
+
+        auto result = condition.value != 0 ? lhs : rhs;
+        result.is_unsigned = is_unsigned(lhs, rhs);
+        return result;
+    }
+
+    pp_value_t logical_or()
+    {
+        auto lhs = logical_and();
+        while (accept("||")) {
+            const auto previous = evaluated_;
+            evaluated_ = previous && lhs.value == 0;
+            const auto rhs = logical_and();
+            evaluated_ = previous;
+            lhs = binary(lhs, rhs, (lhs.value != 0 || rhs.value != 0) ? 1 : 0,
+                true);
+        }
+        return lhs;
+    }
+
+    pp_value_t logical_and()
+    {
+        auto lhs = bitwise_or();
+        while (accept("&&")) {
+            const auto previous = evaluated_;
+            evaluated_ = previous && lhs.value != 0;
+            const auto rhs = bitwise_or();
+            evaluated_ = previous;
+            lhs = binary(lhs, rhs, (lhs.value != 0 && rhs.value != 0) ? 1 : 0,
+                true);
+        }
+        return lhs;
+    }
+
+    pp_value_t bitwise_or()
+    {
+        auto lhs = bitwise_xor();
+        while (accept("|")) {
+            const auto rhs = bitwise_xor();
+            lhs = binary(lhs, rhs, lhs.value | rhs.value);
+        }
+        return lhs;
+    }
+
+    pp_value_t bitwise_xor()
+    {
+        auto lhs = bitwise_and();
+        while (accept("^")) {
+            const auto rhs = bitwise_and();
+            lhs = binary(lhs, rhs, lhs.value ^ rhs.value);
+        }
+        return lhs;
+    }
+
+    pp_value_t bitwise_and()
+    {
+        auto lhs = equality();
+        while (accept("&")) {
+            const auto rhs = equality();
+            lhs = binary(lhs, rhs, lhs.value & rhs.value);
+        }
+        return lhs;
+    }
+
+    pp_value_t equality()
+    {
+        auto lhs = relational();
+        while (true) {
+            if (accept("==")) {
+                const auto rhs = relational();
+                lhs = binary(lhs, rhs, lhs.value == rhs.value ? 1 : 0, true);
+            }
+            else if (accept("!=")) {
+                const auto rhs = relational();
+                lhs = binary(lhs, rhs, lhs.value != rhs.value ? 1 : 0, true);
+            }
+            else {
+                return lhs;
+            }
+        }
+    }
+
+    pp_value_t relational()
+    {
+        auto lhs = shift();
+        while (true) {
+            std::string op;
+            for (const auto *candidate : {"<=", ">=", "<", ">"}) {
+                if (accept(candidate)) {
+                    op = candidate;
+                    break;
+                }
+            }
+            if (op.empty())
+                return lhs;
+
+            const auto rhs = shift();
+            bool result{false};
+            if (is_unsigned(lhs, rhs)) {
+                result = op == "<" ? u(lhs) < u(rhs)
+                    : op == ">"    ? u(lhs) > u(rhs)
+                    : op == "<="   ? u(lhs) <= u(rhs)
+                                   : u(lhs) >= u(rhs);
+            }
+            else {
+                result = op == "<" ? lhs.value < rhs.value
+                    : op == ">"    ? lhs.value > rhs.value
+                    : op == "<="   ? lhs.value <= rhs.value
+                                   : lhs.value >= rhs.value;
+            }
+            lhs = binary(lhs, rhs, result ? 1 : 0, true);
+        }
+    }
+
+    pp_value_t shift()
+    {
+        auto lhs = additive();
+        while (true) {
+            if (accept("<<")) {
+                const auto rhs = additive();
+                lhs = binary(lhs, rhs,
+                    static_cast<std::int64_t>(u(lhs) << (u(rhs) & 63U)));
+                lhs.is_unsigned = lhs.is_unsigned || rhs.is_unsigned;
+            }
+            else if (accept(">>")) {
+                const auto rhs = additive();
+                const auto amount = u(rhs) & 63U;
+                lhs = binary(lhs, rhs,
+                    lhs.is_unsigned
+                        ? static_cast<std::int64_t>(u(lhs) >> amount)
+                        : lhs.value >> amount);
+            }
+            else {
+                return lhs;
+            }
+        }
+    }
+
+    pp_value_t additive()
+    {
+        auto lhs = multiplicative();
+        while (true) {
+            if (accept("+")) {
+                const auto rhs = multiplicative();
+                lhs = binary(
+                    lhs, rhs, static_cast<std::int64_t>(u(lhs) + u(rhs)));
+            }
+            else if (accept("-")) {
+                const auto rhs = multiplicative();
+                lhs = binary(
+                    lhs, rhs, static_cast<std::int64_t>(u(lhs) - u(rhs)));
+            }
+            else {
+                return lhs;
+            }
+        }
+    }
+
+    pp_value_t multiplicative()
+    {
+        auto lhs = unary();
+        while (true) {
+            if (accept("*")) {
+                const auto rhs = unary();
+                lhs = binary(
+                    lhs, rhs, static_cast<std::int64_t>(u(lhs) * u(rhs)));
+                continue;
+            }
+
+            const bool is_division = accept("/");
+            if (!is_division && !accept("%"))
+                return lhs;
+
+            const auto rhs = unary();
+            if (rhs.value == 0) {
+                if (evaluated_)
+                    throw scanner_error_t{"division by zero in #if"};
+                lhs = binary(lhs, rhs, 0);
+                continue;
+            }
+
+            if (is_unsigned(lhs, rhs)) {
+                lhs = binary(lhs, rhs,
+                    static_cast<std::int64_t>(
+                        is_division ? u(lhs) / u(rhs) : u(lhs) % u(rhs)));
+            }
+            else {
+                lhs = binary(lhs, rhs,
+                    is_division ? lhs.value / rhs.value
+                                : lhs.value % rhs.value);
+            }
+        }
+    }
+
+    pp_value_t unary()
+    {
+        if (accept("+"))
+            return unary();
+
+        if (accept("-")) {
+            auto v = unary();
+            v.value = static_cast<std::int64_t>(0U - u(v));
+            return v;
+        }
+
+        if (accept("~")) {
+            auto v = unary();
+            v.value = ~v.value;
+            return v;
+        }
+
+        if (accept("!")) {
+            auto v = unary();
+            v.value = v.value == 0 ? 1 : 0;
+            v.is_unsigned = false;
+            return v;
+        }
+
+        return primary();
+    }
+
+    pp_value_t primary()
+    {
+        if (accept("(")) {
+            const auto v = conditional();
+            expect(")");
+            return v;
+        }
+
+        if (pos_ >= tokens_.size())
+            throw scanner_error_t{"unexpected end of #if expression"};
+
+        const auto &token = tokens_[pos_++];
+
+        if (token.kind == pp_token_t::kind_t::number)
+            return parse_number(token.text);
+
+        if (token.kind == pp_token_t::kind_t::char_literal)
+            return parse_char(token.text);
+
+        throw scanner_error_t{"unexpected token '" + token.text + "' in #if"};
+    }
+
+    static pp_value_t parse_number(std::string text)
+    {
+        text.erase(std::remove(text.begin(), text.end(), '\''), text.end());
+
+        pp_value_t result;
+
+        auto end = text.size();
+        while (end > 0 && std::string{"uUlLzZ"}.find(text[end - 1]) !=
+                std::string::npos) {
+            if (text[end - 1] == 'u' || text[end - 1] == 'U')
+                result.is_unsigned = true;
+            end--;
+        }
+
+        auto base = 10U;
+        std::size_t start = 0;
+        if (end > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+            base = 16U;
+            start = 2;
+        }
+        else if (end > 2 && text[0] == '0' &&
+            (text[1] == 'b' || text[1] == 'B')) {
+            base = 2U;
+            start = 2;
+        }
+        else if (end > 1 && text[0] == '0') {
+            base = 8U;
+            start = 1;
+        }
+
+        std::uint64_t value{0};
+        for (auto i = start; i < end; i++) {
+            const auto c = static_cast<char>(
+                std::tolower(static_cast<unsigned char>(text[i])));
+            unsigned digit{0};
+            if (c >= '0' && c <= '9')
+                digit = static_cast<unsigned>(c - '0');
+            else if (c >= 'a' && c <= 'f')
+                digit = static_cast<unsigned>(c - 'a' + 10);
+            else
+                throw scanner_error_t{
+                    "invalid integer literal '" + text + "' in #if"};
+
+            if (digit >= base)
+                throw scanner_error_t{
+                    "invalid integer literal '" + text + "' in #if"};
+
+            value = value * base + digit;
+        }
+
+        if (value > static_cast<std::uint64_t>(INT64_MAX))
+            result.is_unsigned = true;
+
+        result.value = static_cast<std::int64_t>(value);
+        return result;
+    }
+
+    static pp_value_t parse_char(const std::string &text)
+    {
+        const auto quote = text.find('\'');
+        if (quote == std::string::npos || text.size() < quote + 3 ||
+            text.back() != '\'')
+            throw scanner_error_t{"invalid character literal in #if"};
+
+        const auto body = text.substr(quote + 1, text.size() - quote - 2);
+
+        pp_value_t result;
+        if (body.size() == 1) {
+            result.value = static_cast<signed char>(body[0]);
+            return result;
+        }
+
+        if (body.size() == 2 && body[0] == '\\') {
+            static const std::string escapes{"ntvbrfa\\'\"?0"};
+            static const std::string values{"\n\t\v\b\r\f\a\\'\"?"};
+            const auto idx = escapes.find(body[1]);
+            if (idx != std::string::npos) {
+                result.value = idx < values.size() ? values[idx] : 0;
+                return result;
+            }
+        }
+
+        throw scanner_error_t{"unsupported character literal " + text};
+    }
+
+    const std::vector<pp_token_t> &tokens_;
+    std::size_t pos_{0};
+    // False inside the unevaluated operands of &&, || and ?:
+    bool evaluated_{true};
+};
+
+struct search_dir_t {
+    std::string path;
+    bool quote_only{false};
+};
+
+/**
+ * Preprocessor options of a single compile command relevant to the scanner.
+ */
+struct scan_options_t {
+    std::string driver;
+    std::string language;
+    std::vector<std::string> probe_flags;
+    std::vector<search_dir_t> search_dirs;
+    // -D and -U in command line order, as `#define`/`#undef` directive text
+    std::string command_line_macros;
+    std::vector<std::string> forced_includes;
+};
+
+std::string make_absolute(const std::string &path, const std::string &directory)
+{
+    boost::filesystem::path p{path};
+    if (!p.is_absolute())
+        p = boost::filesystem::path{directory} / p;
+    return p.lexically_normal().string();
+}
+
+scan_options_t parse_scan_options(const boost::filesystem::path &tu_path,
+    const std::string &directory, const std::vector<std::string> &args)
+{
+    scan_options_t options;
+
+    if (args.empty())
+        throw scanner_error_t{"empty compile command"};
+
+    std::size_t i = 0;
+    const auto driver_name = boost::filesystem::path{args[0]}.stem().string();
+    if (driver_name == "ccache" || driver_name == "sccache" ||
+        driver_name == "distcc" || driver_name == "icecc") {
+        i++;
+    }
+
+    if (i >= args.size())
+        throw scanner_error_t{"missing compiler in compile command"};
+
+    options.driver = args[i++];
+
+    const auto driver_stem =
+        boost::filesystem::path{options.driver}.stem().string();
+    if (driver_stem == "cl" || driver_stem == "clang-cl")
+        throw scanner_error_t{"MSVC style compile commands are not supported"};
+
+    std::vector<std::string> quote_dirs;
+    std::vector<std::string> user_dirs;
+    std::vector<std::string> system_dirs;
+    std::vector<std::string> after_dirs;
+
+    // Returns the value of a flag given either as `-Xvalue` or `-X value`
+    auto flag_value = [&](const std::string &flag) -> std::string {
+        const auto &arg = args[i];
+        if (arg.size() > flag.size()) {
+            const auto offset = arg[flag.size()] == '=' ? 1 : 0;
+            return arg.substr(flag.size() + offset);
+        }
+        if (i + 1 >= args.size())
+            throw scanner_error_t{"missing value for " + flag};
+        return args[++i];
+    };
+
+    auto starts_with = [](const std::string &s, const char *prefix) {
+        return boost::starts_with(s, prefix);
+    };
+
+    for (; i < args.size(); i++) {
+        const auto &arg = args[i];
+
+        if (arg.empty() || arg[0] != '-') {
+            // Input files and other positional arguments
+            continue;
+        }
+
+        if (arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ") {
+            i++;
+        }
+        else if (starts_with(arg, "-iquote")) {
+            quote_dirs.emplace_back(flag_value("-iquote"));
+        }
+        else if (starts_with(arg, "-isystem")) {
+            system_dirs.emplace_back(flag_value("-isystem"));
+        }
+        else if (starts_with(arg, "-idirafter")) {
+            after_dirs.emplace_back(flag_value("-idirafter"));
+        }
+        else if (starts_with(arg, "--include-directory")) {
+            user_dirs.emplace_back(flag_value("--include-directory"));
+        }
+        else if (arg == "-I-" || starts_with(arg, "-iframework") ||
+            starts_with(arg, "-iprefix") || starts_with(arg, "-iwithprefix") ||
+            starts_with(arg, "-include-pch") || starts_with(arg, "-F") ||
+            arg == "-Xclang" || starts_with(arg, "-Xpreprocessor") ||
+            starts_with(arg, "-imacros") || starts_with(arg, "-cxx-isystem")) {
+            throw scanner_error_t{"unsupported compile flag " + arg};
+        }
+        else if (starts_with(arg, "-I")) {
+            user_dirs.emplace_back(flag_value("-I"));
+        }
+        else if (arg == "-include" || arg == "--include") {
+            options.forced_includes.emplace_back(flag_value(arg));
+        }
+        else if (starts_with(arg, "-D")) {
+            auto value = flag_value("-D");
+            const auto eq = value.find('=');
+            if (eq == std::string::npos)
+                value += " 1";
+            else
+                value[eq] = ' ';
+            options.command_line_macros += "#define " + value + "\n";
+        }
+        else if (starts_with(arg, "-U")) {
+            options.command_line_macros += "#undef " + flag_value("-U") + "\n";
+        }
+        else if (starts_with(arg, "-x")) {
+            options.language = flag_value("-x");
+        }
+        else if (arg == "-target" || arg == "-isysroot" ||
+            arg == "-gcc-toolchain" || arg == "-arch" ||
+            arg == "-resource-dir" || arg == "--sysroot") {
+            options.probe_flags.emplace_back(arg);
+            options.probe_flags.emplace_back(flag_value(arg));
+        }
+        else if (starts_with(arg, "-std") || starts_with(arg, "--std") ||
+            starts_with(arg, "-m") || starts_with(arg, "-f") ||
+            starts_with(arg, "-O") || starts_with(arg, "--target") ||
+            starts_with(arg, "--sysroot") || starts_with(arg, "-isysroot") ||
+            starts_with(arg, "-nostdinc") ||
+            starts_with(arg, "-nobuiltininc") ||
+            starts_with(arg, "-stdlib") ||
+            starts_with(arg, "--gcc-toolchain") ||
+            starts_with(arg, "-resource-dir") || arg == "-pthread" ||
+            arg == "-ansi" || arg == "-undef") {
+            options.probe_flags.emplace_back(arg);
+        }
+    }
+
+    if (options.language.empty()) {
+        const auto extension = tu_path.extension().string();
+        if (extension == ".c")
+            options.language = "c";
+        else if (extension == ".m" || extension == ".mm" ||
+            extension == ".cu")
+            throw scanner_error_t{"unsupported language of " +
+                tu_path.string()};
+        else
+            options.language = "c++";
+    }
+
+    if (options.language != "c" && options.language != "c++")
+        throw scanner_error_t{"unsupported language " + options.language};
+
+    for (const auto &dir : quote_dirs)
+        options.search_dirs.push_back({make_absolute(dir, directory), true});
+    for (const auto *dirs : {&user_dirs, &system_dirs})
+        for (const auto &dir : *dirs)
+            options.search_dirs.push_back(
+                {make_absolute(dir, directory), false});
+
+    for (auto &forced_include : options.forced_includes)
+        forced_include = make_absolute(forced_include, directory);
+
+    // Builtin directories are appended by the caller, followed by these
+    for (const auto &dir : after_dirs)
+        options.probe_flags.emplace_back("-idirafter" +
+            make_absolute(dir, directory));
+
+    return options;
+}
+
+std::string quote_shell_argument(const std::string &arg)
+{
+    std::string result{"'"};
+    for (const auto c : arg) {
+        if (c == '\'')
+            result += "'\\''";
+        else
+            result += c;
+    }
+    result += "'";
+    return result;
+}
+
+bool run_command(const std::string &command, std::string &output)
+{
+#if defined(_WIN32)
+    (void)command;
+    (void)output;
+    return false;
+#else
+    LOG(debug) << "Running: " << command;
+
+    auto *pipe = popen(command.c_str(), "r"); // NOLINT
+    if (pipe == nullptr)
+        return false;
+
+    std::array<char, 4096> buffer{};
+    std::size_t n{0};
+    while ((n = fread(buffer.data(), 1, buffer.size(), pipe)) > 0)
+        output.append(buffer.data(), n);
+
+    return pclose(pipe) == 0;
+#endif
+}
+
+/**
+ * Per translation unit preprocessor state.
+ */
+class scan_context_t {
+public:
+    scan_context_t(include_scanner_t &scanner, compiler_info_t &compiler,
+        std::vector<search_dir_t> search_dirs, std::string tu_path,
+        std::vector<include_edge_t> &edges)
+        : scanner_{scanner}
+        , compiler_{compiler}
+        , search_dirs_{std::move(search_dirs)}
+        , tu_path_{std::move(tu_path)}
+        , edges_{edges}
+    {
+    }
+
+    void apply_macros(const file_directives_t &definitions)
+    {
+        for (const auto &directive : definitions.directives) {
+            if (directive.kind == directive_kind_t::define)
+                define(directive);
+            else if (directive.kind == directive_kind_t::undef &&
+                !directive.tokens.empty())
+                macros_.erase(directive.tokens.front().text);
+        }
+    }
+
+    void process_file(const std::string &path, int dir_index, unsigned depth,
+        bool record_edges = true)
+    {
+        if (depth > kMaxIncludeDepth)
+            throw scanner_error_t{"include depth limit exceeded"};
+
+        const auto &canonical_path = scanner_.canonical(path);
+        if (pragma_once_.count(canonical_path) > 0)
+            return;
+
+        const auto file = scanner_.directives(path);
+        if (!file)
+            throw scanner_error_t{"cannot read " + path};
+
+        if (!file->include_guard.empty() &&
+            macros_.count(file->include_guard) > 0)
+            return;
+
+        const auto current_dir =
+            boost::filesystem::path{path}.parent_path().string();
+
+        struct conditional_t {
+            bool parent_active;
+            bool taken;
+            bool active;
+        };
+        std::vector<conditional_t> conditionals;
+
+        auto is_active = [&conditionals]() {
+            return conditionals.empty() || conditionals.back().active;
+        };
+
+        for (const auto &directive : file->directives) {
+            switch (directive.kind) {
+            case directive_kind_t::if_:
+            case directive_kind_t::ifdef:
+            case directive_kind_t::ifndef: {
+                if (!is_active()) {
+                    conditionals.push_back({false, true, false});
+                    break;
+                }
+                const auto value =
+                    evaluate_condition(directive, path, current_dir);
+                conditionals.push_back({true, value, value});
+                break;
+            }
+            case directive_kind_t::elif:
+            case directive_kind_t::elifdef:
+            case directive_kind_t::elifndef: {
+                if (conditionals.empty())
+                    throw scanner_error_t{"#elif without #if in " + path};
+                auto &c = conditionals.back();
+                if (!c.parent_active)
+                    break;
+                if (c.taken) {
+                    c.active = false;
+                    break;
+                }
+                c.active = evaluate_condition(directive, path, current_dir);
+                c.taken = c.active;
+                break;
+            }
+            case directive_kind_t::else_: {
+                if (conditionals.empty())
+                    throw scanner_error_t{"#else without #if in " + path};
+                auto &c = conditionals.back();
+                if (c.parent_active) {
+                    c.active = !c.taken;
+                    c.taken = true;
+                }
+                break;
+            }
+            case directive_kind_t::endif:
+                if (conditionals.empty())
+                    throw scanner_error_t{"#endif without #if in " + path};
+                conditionals.pop_back();
+                break;
+            case directive_kind_t::define:
+                if (is_active())
+                    define(directive);
+                break;
+            case directive_kind_t::undef:
+                if (is_active() && !directive.tokens.empty())
+                    macros_.erase(directive.tokens.front().text);
+                break;
+            case directive_kind_t::pragma_once:
+                if (is_active())
+                    pragma_once_.insert(canonical_path);
+                break;
+            case directive_kind_t::include:
+            case directive_kind_t::include_next:
+            case directive_kind_t::import:
+                if (is_active())
+                    process_include(directive, path, canonical_path,
+                        current_dir, dir_index, depth, record_edges);
+                break;
+            case directive_kind_t::other:
+                break;
+            }
+        }
+
+        if (!conditionals.empty())
+            throw scanner_error_t{"unterminated conditional in " + path};
+    }
+
+private:
+    struct found_header_t {
+        std::string path;
+        int dir_index;
+    };
+
+    void define(const directive_t &directive)
+    {
+        if (directive.tokens.empty() ||
+            directive.tokens.front().kind != pp_token_t::kind_t::identifier)
+            return;
+
+        macros_[directive.tokens.front().text] = &directive;
+    }
+
+    bool resolve_header(const std::string &spelling, bool angled,
+        const std::string &current_dir, int start_index,
+        bool relative_to_current, found_header_t &result)
+    {
+        if (boost::filesystem::path{spelling}.is_absolute()) {
+            result = {spelling, -1};
+            return scanner_.file_exists(spelling);
+        }
+
+        if (!angled && relative_to_current) {
+            auto candidate = current_dir;
+            candidate += '/';
+            candidate += spelling;
+            if (scanner_.file_exists(candidate)) {
+                result = {std::move(candidate), -1};
+                return true;
+            }
+        }
+
+        for (auto i = std::max(start_index, 0);
+             i < static_cast<int>(search_dirs_.size()); i++) {
+            const auto &dir = search_dirs_[static_cast<std::size_t>(i)];
+            if (angled && dir.quote_only)
+                continue;
+
+            auto candidate = dir.path;
+            candidate += '/';
+            candidate += spelling;
+            if (scanner_.file_exists(candidate)) {
+                result = {std::move(candidate), i};
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void process_include(const directive_t &directive, const std::string &path,
+        const std::string &canonical_path, const std::string &current_dir,
+        int dir_index, unsigned depth, bool record_edges)
+    {
+        std::vector<pp_token_t> tokens = directive.tokens;
+        if (tokens.empty())
+            throw scanner_error_t{"empty #include in " + path};
+
+        if (tokens.front().kind == pp_token_t::kind_t::identifier)
+            tokens = expand(tokens, false);
+
+        bool angled{false};
+        std::string spelling;
+        if (header_name_spelling(tokens, angled, spelling) != tokens.size())
+            throw scanner_error_t{"cannot evaluate #include in " + path};
+
+        const bool is_next =
+            directive.kind == directive_kind_t::include_next;
+
+        found_header_t header;
+        if (!resolve_header(spelling, angled, current_dir,
+                is_next ? dir_index + 1 : 0, !is_next, header))
+            throw scanner_error_t{
+                "cannot find header '" + spelling + "' included from " + path};
+
+        if (record_edges) {
+            include_edge_t edge;
+            edge.from = canonical_path;
+            edge.to = scanner_.canonical(header.path);
+            edge.include_spelling = spelling;
+            edge.from_translation_unit = canonical_path == tu_path_;
+            edge.is_system = angled;
+            edges_.emplace_back(std::move(edge));
+        }
+
+        if (directive.kind == directive_kind_t::import)
+            pragma_once_.insert(scanner_.canonical(header.path));
+
+        process_file(header.path, header.dir_index, depth + 1, record_edges);
+    }
+
+    /**
+     * Extracts header name from the tokens of an include directive,
+     * returns the number of consumed tokens.
+     */
+    static std::size_t header_name_spelling(
+        const std::vector<pp_token_t> &tokens, bool &angled,
+        std::string &spelling, std::size_t start = 0)
+    {
+        if (start >= tokens.size())
+            return 0;
+
+        const auto &first = tokens[start];
+        if (first.kind == pp_token_t::kind_t::header_name ||
+            (first.kind == pp_token_t::kind_t::string_literal &&
+                first.text.front() == '"')) {
+            angled = first.kind == pp_token_t::kind_t::header_name;
+            spelling = first.text.substr(1, first.text.size() - 2);
+            return start + 1;
+        }
+
+        if (first.is_punctuator("<")) {
+            // Header name assembled from macro expansion
+            angled = true;
+            spelling.clear();
+            for (auto i = start + 1; i < tokens.size(); i++) {
+                if (tokens[i].is_punctuator(">"))
+                    return i + 1;
+                if (tokens[i].has_leading_space && !spelling.empty())
+                    spelling += ' ';
+                spelling += tokens[i].text;
+            }
+        }
+
+        return 0;
+    }
+
+    bool evaluate_condition(const directive_t &directive,
+        const std::string &path, const std::string &current_dir)
+    {
+        if (directive.kind == directive_kind_t::ifdef ||
+            directive.kind == directive_kind_t::ifndef ||
+            directive.kind == directive_kind_t::elifdef ||
+            directive.kind == directive_kind_t::elifndef) {
+            if (directive.tokens.empty())
+                throw scanner_error_t{"missing macro name in #ifdef"};
+
+            const auto defined = is_defined(directive.tokens.front().text);
+            return (directive.kind == directive_kind_t::ifdef ||
+                       directive.kind == directive_kind_t::elifdef)
+                ? defined
+                : !defined;
+        }
+
+        current_dir_ = &current_dir;
+
+        try {
+            auto tokens = expand(directive.tokens, true);
+
+            for (auto &token : tokens) {
+                if (token.kind == pp_token_t::kind_t::identifier) {
+                    // Remaining identifiers evaluate to 0, except for C++
+                    // bool literals
+                    token.kind = pp_token_t::kind_t::number;
+                    token.text = token.text == "true" ? "1" : "0";
+                }
+            }
+
+            return expression_evaluator_t{tokens}.evaluate();
+        }
+        catch (const scanner_error_t &e) {
+            throw scanner_error_t{std::string{e.what()} + " (" + path +
+                ": #if " + join_tokens(directive.tokens) + ")"};
+        }
+    }
+
+    bool is_defined(const std::string &name)
+    {
+        if (macros_.count(name) > 0 || name == "__has_include" ||
+            name == "__has_include_next")
+            return true;
+
+        // Feature check builtins depend on the compiler and its version
+        return is_compiler_check(name) &&
+            compiler_check("defined(" + name + ")");
+    }
+
+    static bool is_compiler_check(const std::string &name)
+    {
+        return boost::starts_with(name, "__has_") ||
+            boost::starts_with(name, "__is_") ||
+            name == "__building_module";
+    }
+
+    static pp_token_t number_token(bool value)
+    {
+        pp_token_t token;
+        token.kind = pp_token_t::kind_t::number;
+        token.text = value ? "1" : "0";
+        return token;
+    }
+
+    struct expansion_token_t {
+        pp_token_t token;
+        std::vector<std::string> hide_set;
+    };
+
+    static std::vector<std::vector<pp_token_t>> collect_arguments(
+        std::deque<expansion_token_t> &work)
+    {
+        std::vector<std::vector<pp_token_t>> arguments(1);
+        auto depth = 0;
+        while (!work.empty()) {
+            auto token = std::move(work.front().token);
+            work.pop_front();
+
+            if (token.is_punctuator("(")) {
+                depth++;
+            }
+            else if (token.is_punctuator(")")) {
+                if (depth == 0)
+                    return arguments;
+                depth--;
+            }
+            else if (token.is_punctuator(",") && depth == 0) {
+                arguments.emplace_back();
+                continue;
+            }
+
+            arguments.back().emplace_back(std::move(token));
+        }
+
+        throw scanner_error_t{"unterminated macro invocation"};
+    }
+
+    static std::string join_tokens(const std::vector<pp_token_t> &tokens)
+    {
+        std::string result;
+        for (const auto &token : tokens) {
+            if (token.has_leading_space && !result.empty())
+                result += ' ';
+            result += token.text;
+        }
+        return result;
+    }
+
+    static pp_token_t paste(const pp_token_t &lhs, const pp_token_t &rhs)
+    {
+        pp_token_t result = lhs;
+        result.text += rhs.text;
+        if (is_identifier_start(result.text.front()))
+            result.kind = pp_token_t::kind_t::identifier;
+        else if (is_digit(result.text.front()))
+            result.kind = pp_token_t::kind_t::number;
+        else
+            result.kind = pp_token_t::kind_t::punctuator;
+        return result;
+    }
+
+    std::vector<pp_token_t> substitute(const directive_t &definition,
+        const std::vector<std::string> &parameters,
+        const std::vector<std::vector<pp_token_t>> &arguments,
+        bool if_expression)
+    {
+        const auto &body = definition.tokens;
+
+        auto parameter_index = [&](const pp_token_t &token) -> int {
+            if (token.kind != pp_token_t::kind_t::identifier)
+                return -1;
+            for (auto i = 0U; i < parameters.size(); i++)
+                if (parameters[i] == token.text)
+                    return static_cast<int>(i);
+            return -1;
+        };
+
+        std::vector<pp_token_t> result;
+        const auto body_start = body_offset(definition);
+        for (auto i = body_start; i < body.size(); i++) {
+            const auto &token = body[i];
+
+            if (token.text == "__VA_OPT__")
+                throw scanner_error_t{"__VA_OPT__ is not supported"};
+
+            if (token.is_punctuator("#") && i + 1 < body.size() &&
+                parameter_index(body[i + 1]) >= 0) {
+                pp_token_t str;
+                str.kind = pp_token_t::kind_t::string_literal;
+                str.has_leading_space = token.has_leading_space;
+                str.text = "\"" +
+                    join_tokens(arguments[static_cast<std::size_t>(
+                        parameter_index(body[i + 1]))]) +
+                    "\"";
+                result.emplace_back(std::move(str));
+                i++;
+                continue;
+            }
+
+            if (token.is_punctuator("##") && i + 1 < body.size()) {
+                const auto &next = body[++i];
+                const auto next_index = parameter_index(next);
+                std::vector<pp_token_t> rhs;
+                if (next_index >= 0)
+                    rhs = arguments[static_cast<std::size_t>(next_index)];
+                else
+                    rhs.push_back(next);
+
+                if (rhs.empty())
+                    continue;
+
+                if (result.empty()) {
+                    result.insert(result.end(), rhs.begin(), rhs.end());
+                    continue;
+                }
+
+                result.back() = paste(result.back(), rhs.front());
+                result.insert(result.end(), rhs.begin() + 1, rhs.end());
+                continue;
+            }
+
+            const auto index = parameter_index(token);
+            if (index < 0) {
+                result.push_back(token);
+                continue;
+            }
+
+            const auto &argument = arguments[static_cast<std::size_t>(index)];
+            const bool before_paste =
+                i + 1 < body.size() && body[i + 1].is_punctuator("##");
+            if (before_paste) {
+                result.insert(result.end(), argument.begin(), argument.end());
+            }
+            else {
+                auto expanded = expand(argument, if_expression);
+                if (!expanded.empty())
+                    expanded.front().has_leading_space =
+                        token.has_leading_space;
+                result.insert(result.end(), expanded.begin(), expanded.end());
+            }
+        }
+
+        return result;
+    }
+
+    static bool is_function_like(const directive_t &definition)
+    {
+        return definition.tokens.size() > 1 &&
+            definition.tokens[1].is_punctuator("(") &&
+            !definition.tokens[1].has_leading_space;
+    }
+
+    static std::size_t body_offset(const directive_t &definition)
+    {
+        if (!is_function_like(definition))
+            return 1;
+
+        for (auto i = 2U; i < definition.tokens.size(); i++)
+            if (definition.tokens[i].is_punctuator(")"))
+                return i + 1;
+
+        throw scanner_error_t{"invalid macro definition"};
+    }
+
+    static std::vector<std::string> macro_parameters(
+        const directive_t &definition, bool &variadic)
+    {
+        std::vector<std::string> parameters;
+        variadic = false;
+        const auto end = body_offset(definition) - 1;
+        for (auto i = 2U; i < end; i++) {
+            const auto &token = definition.tokens[i];
+            if (token.is_punctuator("...")) {
+                variadic = true;
+                if (i > 2 && !definition.tokens[i - 1].is_punctuator(","))
+                    continue; // GNU named variadic parameter
+                parameters.emplace_back("__VA_ARGS__");
+            }
+            else if (token.kind == pp_token_t::kind_t::identifier) {
+                parameters.emplace_back(token.text);
+            }
+        }
+        return parameters;
+    }
+
+    std::vector<pp_token_t> expand(
+        const std::vector<pp_token_t> &tokens, bool if_expression)
+    {
+        std::deque<expansion_token_t> work;
+        for (const auto &token : tokens)
+            work.push_back({token, {}});
+
+        std::vector<pp_token_t> result;
+        while (!work.empty()) {
+            if (++expansions_ > kMaxMacroExpansions)
+                throw scanner_error_t{"macro expansion limit exceeded"};
+
+            auto current = std::move(work.front());
+            work.pop_front();
+            auto &token = current.token;
+
+            if (token.kind != pp_token_t::kind_t::identifier) {
+                result.emplace_back(std::move(token));
+                continue;
+            }
+
+            if (if_expression && token.text == "defined") {
+                const bool parenthesized =
+                    !work.empty() && work.front().token.is_punctuator("(");
+                if (parenthesized)
+                    work.pop_front();
+                if (work.empty() ||
+                    work.front().token.kind !=
+                        pp_token_t::kind_t::identifier)
+                    throw scanner_error_t{"invalid 'defined' in #if"};
+                const auto name = work.front().token.text;
+                work.pop_front();
+                if (parenthesized) {
+                    if (work.empty() || !work.front().token.is_punctuator(")"))
+                        throw scanner_error_t{"invalid 'defined' in #if"};
+                    work.pop_front();
+                }
+                result.push_back(number_token(is_defined(name)));
+                continue;
+            }
+
+            // Feature check names without arguments can appear as arguments
+            // of other checks, e.g. `__has_builtin(__is_identifier)`
+            if (if_expression && macros_.count(token.text) == 0 &&
+                is_compiler_check(token.text) && !work.empty() &&
+                work.front().token.is_punctuator("(")) {
+                result.push_back(
+                    evaluate_compiler_check(token.text, work));
+                continue;
+            }
+
+            auto it = macros_.find(token.text);
+            if (it == macros_.end() ||
+                std::find(current.hide_set.begin(), current.hide_set.end(),
+                    token.text) != current.hide_set.end()) {
+                result.emplace_back(std::move(token));
+                continue;
+            }
+
+            const auto &definition = *it->second;
+            auto hide_set = current.hide_set;
+            hide_set.push_back(token.text);
+
+            std::vector<pp_token_t> replacement;
+            if (!is_function_like(definition)) {
+                replacement.assign(
+                    definition.tokens.begin() + 1, definition.tokens.end());
+                // Paste operators in object-like macros
+                for (auto i = 1U; i + 1 < replacement.size(); i++) {
+                    if (replacement[i].is_punctuator("##")) {
+                        replacement[i - 1] =
+                            paste(replacement[i - 1], replacement[i + 1]);
+                        replacement.erase(replacement.begin() + i,
+                            replacement.begin() + i + 2);
+                        i--;
+                    }
+                }
+            }
+            else {
+                if (work.empty() || !work.front().token.is_punctuator("(")) {
+                    result.emplace_back(std::move(token));
+                    continue;
+                }
+                work.pop_front();
+
+                auto arguments = collect_arguments(work);
+
+                bool variadic{false};
+                const auto parameters =
+                    macro_parameters(definition, variadic);
+
+                if (variadic && arguments.size() > parameters.size()) {
+                    // Merge all variadic arguments into the last one
+                    auto &last = arguments[parameters.size() - 1];
+                    for (auto i = parameters.size(); i < arguments.size();
+                         i++) {
+                        pp_token_t comma;
+                        comma.text = ",";
+                        last.push_back(comma);
+                        last.insert(last.end(), arguments[i].begin(),
+                            arguments[i].end());
+                    }
+                    arguments.resize(parameters.size());
+                }
+                if (parameters.empty() && arguments.size() == 1 &&
+                    arguments.front().empty())
+                    arguments.clear();
+                if (variadic && arguments.size() + 1 == parameters.size())
+                    arguments.emplace_back();
+
+                if (arguments.size() != parameters.size())
+                    throw scanner_error_t{
+                        "invalid number of arguments to " + token.text};
+
+                replacement = substitute(
+                    definition, parameters, arguments, if_expression);
+            }
+
+            if (!replacement.empty())
+                replacement.front().has_leading_space =
+                    token.has_leading_space;
+
+            for (auto rit = replacement.rbegin(); rit != replacement.rend();
+                 ++rit)
+                work.push_front({std::move(*rit), hide_set});
+        }
+
+        return result;
+    }
+
+    pp_token_t evaluate_compiler_check(
+        const std::string &name, std::deque<expansion_token_t> &work)
+    {
+        work.pop_front();
+
+        const auto arguments = collect_arguments(work);
+        if (name == "__has_include" || name == "__has_include_next") {
+            if (arguments.size() != 1)
+                throw scanner_error_t{"invalid " + name};
+
+            auto argument = arguments.front();
+            if (!argument.empty() &&
+                argument.front().kind == pp_token_t::kind_t::identifier)
+                argument = expand(argument, false);
+
+            bool angled{false};
+            std::string spelling;
+            if (header_name_spelling(argument, angled, spelling) !=
+                argument.size())
+                throw scanner_error_t{"cannot evaluate " + name};
+
+            found_header_t header;
+            return number_token(resolve_header(spelling, angled,
+                *current_dir_, 0, name == "__has_include", header));
+        }
+
+        std::vector<std::string> texts;
+        for (const auto &argument : arguments)
+            texts.emplace_back(join_tokens(argument));
+
+        std::string expression = name + "(";
+        for (auto i = 0U; i < texts.size(); i++) {
+            if (i > 0)
+                expression += ',';
+            expression += texts[i];
+        }
+        expression += ")";
+
+        return number_token(compiler_check(expression));
+    }
+
+    bool compiler_check(const std::string &expression)
+    {
+        return scanner_.compiler_check(compiler_, expression);
+    }
+
+    include_scanner_t &scanner_;
+    compiler_info_t &compiler_;
+    const std::vector<search_dir_t> search_dirs_;
+    const std::string tu_path_;
+    std::vector<include_edge_t> &edges_;
+
+    std::unordered_map<std::string, const directive_t *> macros_;
+    std::set<std::string> pragma_once_;
+    const std::string *current_dir_{nullptr};
+    unsigned expansions_{0};
+};
+
+} // namespace
+
+file_directives_t lex_directives(const char *data, std::size_t size)
+{
+    return directive_lexer_t{data, size}.lex();
+}
+
+include_scanner_t::include_scanner_t() = default;
+
+include_scanner_t::~include_scanner_t() = default;
+
+bool include_scanner_t::scan(const boost::filesystem::path &tu_path,
+    const std::string &directory, const std::vector<std::string> &args,
+    std::vector<include_edge_t> &edges)
+{
+    try {
+        auto options = parse_scan_options(tu_path, directory, args);
+
+        auto probe_flags = options.probe_flags;
+        probe_flags.emplace_back("-x");
+        probe_flags.emplace_back(options.language);
+
+        auto compiler = compiler_info(options.driver, probe_flags);
+        if (!compiler)
+            throw scanner_error_t{
+                "cannot query compiler " + options.driver};
+
+        for (const auto &dir : compiler->system_dirs)
+            options.search_dirs.push_back({dir, false});
+
+        const auto command_line_macros =
+            lex_directives(options.command_line_macros.data(),
+                options.command_line_macros.size());
+
+        std::vector<include_edge_t> tu_edges;
+        scan_context_t context{*this, *compiler,
+            std::move(options.search_dirs), canonical(tu_path.string()),
+            tu_edges};
+
+        context.apply_macros(compiler->predefined_macros);
+        context.apply_macros(command_line_macros);
+
+        for (const auto &forced_include : options.forced_includes)
+            context.process_file(forced_include, -1, 1, false);
+
+        context.process_file(tu_path.string(), -1, 0);
+
+        edges.insert(edges.end(), std::make_move_iterator(tu_edges.begin()),
+            std::make_move_iterator(tu_edges.end()));
+    }
+    catch (const scanner_error_t &e) {
+        LOG(debug) << "Falling back to libclang for " << tu_path << ": "
+                   << e.what();
+        return false;
+    }
+
+    return true;
+}
+
+std::shared_ptr<const file_directives_t> include_scanner_t::directives(
+    const std::string &path)
+{
+    {
+        const std::lock_guard<std::mutex> guard{directives_mutex_};
+        auto it = directives_.find(path);
+        if (it != directives_.end())
+            return it->second;
+    }
+
+    std::shared_ptr<const file_directives_t> result;
+
+    std::ifstream ifs{path, std::ios::binary};
+    if (ifs) {
+        const std::string content{std::istreambuf_iterator<char>{ifs},
+            std::istreambuf_iterator<char>{}};
+        result = std::make_shared<const file_directives_t>(
+            lex_directives(content.data(), content.size()));
+    }
+
+    const std::lock_guard<std::mutex> guard{directives_mutex_};
+    return directives_.emplace(path, std::move(result)).first->second;
+}
+
+bool include_scanner_t::file_exists(const std::string &path)
+{
+    {
+        const std::lock_guard<std::mutex> guard{file_exists_mutex_};
+        auto it = file_exists_.find(path);
+        if (it != file_exists_.end())
+            return it->second;
+    }
+
+    boost::system::error_code ec;
+    const auto exists = boost::filesystem::is_regular_file(path, ec);
+
+    const std::lock_guard<std::mutex> guard{file_exists_mutex_};
+    file_exists_.emplace(path, exists);
+
+    return exists;
+}
+
+void include_scanner_t::forget_files()
+{
+    {
+        const std::lock_guard<std::mutex> guard{directives_mutex_};
+        directives_.clear();
+    }
+
+    const std::lock_guard<std::mutex> guard{file_exists_mutex_};
+    file_exists_.clear();
+}
+
+const std::string &include_scanner_t::canonical(const std::string &path)
+{
+    {
+        const std::lock_guard<std::mutex> guard{canonical_mutex_};
+        auto it = canonical_.find(path);
+        if (it != canonical_.end())
+            return it->second;
+    }
+
+    auto result = boost::filesystem::weakly_canonical(path).string();
+
+    const std::lock_guard<std::mutex> guard{canonical_mutex_};
+    return canonical_.emplace(path, std::move(result)).first->second;
+}
+
+std::shared_ptr<compiler_info_t> include_scanner_t::compiler_info(
+    const std::string &driver, const std::vector<std::string> &flags)
+{
+    std::string command = quote_shell_argument(driver);
+    for (const auto &flag : flags) {
+        command += ' ';
+        command += quote_shell_argument(flag);
+    }
+
+    // Compiler queries are rare, so they are simply serialized
+    const std::lock_guard<std::mutex> guard{compilers_mutex_};
+
+    auto it = compilers_.find(command);
+    if (it != compilers_.end())
+        return it->second;
+
+    std::shared_ptr<compiler_info_t> result;
+
+    std::string output;
+    if (run_command(command + " -E -dM -v /dev/null 2>&1", output)) {
+        result = std::make_shared<compiler_info_t>();
+        result->command = command;
+
+        std::string defines;
+        std::istringstream iss{output};
+        std::string line;
+        std::vector<std::string> *dirs{nullptr};
+        while (std::getline(iss, line)) {
+            if (boost::starts_with(line, "#define ")) {
+                defines += line;
+                defines += '\n';
+            }
+            else if (boost::starts_with(line, "#include \"...\"")) {
+                dirs = &result->quote_dirs;
+            }
+            else if (boost::starts_with(line, "#include <...>")) {
+                dirs = &result->system_dirs;
+            }
+            else if (boost::starts_with(line, "End of search list")) {
+                dirs = nullptr;
+            }
+            else if (dirs != nullptr && boost::starts_with(line, " ")) {
+                if (line.find("(framework directory)") != std::string::npos)
+                    continue;
+                dirs->emplace_back(
+                    boost::filesystem::path{line.substr(1)}
+                        .lexically_normal()
+                        .string());
+            }
+        }
+
+        result->predefined_macros =
+            lex_directives(defines.data(), defines.size());
+
+        LOG(info) << "Found " << result->predefined_macros.directives.size()
+                  << " predefined macros and "
+                  << result->system_dirs.size()
+                  << " builtin include directories for " << command;
+    }
+    else {
+        LOG(warning) << "Failed to query compiler: " << command;
+    }
+
+    compilers_.emplace(command, result);
+
+    return result;
+}
+
+bool include_scanner_t::compiler_check(
+    compiler_info_t &compiler, const std::string &expression)
+{
+    const std::lock_guard<std::mutex> guard{compiler.checks_mutex};
+
+    auto it = compiler.checks.find(expression);
+    if (it != compiler.checks.end())
+        return it->second;
+
+    std::string output;
+    const auto source = "#if " + expression + "\nyes\n#else\nno\n#endif";
+    if (!run_command("printf '%s\\n' " + quote_shell_argument(source) +
+                " | " + compiler.command + " -E -P - 2>/dev/null",
+            output))
+        throw scanner_error_t{"cannot evaluate " + expression};
+
+    const auto result = output.find("yes") != std::string::npos;
+    compiler.checks.emplace(expression, result);
+
+    return result;
+}
+
+} // namespace clang_include_graph
@@ -0,0 +1,178 @@
+/**
+ * src/include_scanner.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_INCLUDE_SCANNER_H
+#define CLANG_INCLUDE_GRAPH_INCLUDE_SCANNER_H
+
+#include "include_graph.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace clang_include_graph {
+
+struct pp_token_t {
+    enum class kind_t : std::uint8_t {
+        identifier,
+        number,
+        string_literal,
+        char_literal,
+        header_name,
+        punctuator
+    };
+
+    kind_t kind{kind_t::punctuator};
+    std::string text;
+    // Needed to tell function-like macro definitions from object-like ones
+    bool has_leading_space{false};
+
+    bool is_punctuator(const char *p) const
+    {
+        return kind == kind_t::punctuator && text == p;
+    }
+};
+
+enum class directive_kind_t : std::uint8_t {
+    include,
+    include_next,
+    import,
+    define,
+    undef,
+    if_,
+    ifdef,
+    ifndef,
+    elif,
+    elifdef,
+    elifndef,
+    else_,
+    endif,
+    pragma_once,
+    other
+};
+
+struct directive_t {
+    directive_kind_t kind{directive_kind_t::other};
+    // Offset of the directive's '#' character in the original file buffer
+    std::size_t offset{0};
+    std::vector<pp_token_t> tokens;
+};
+
+/**
+ * Preprocessor directives of a single file, all other tokens are dropped.
+ */
+struct file_directives_t {
+    std::vector<directive_t> directives;
+    // Name of the include guard macro, if the entire file is wrapped in
+    // `#ifndef X` ... `#endif`
+    std::string include_guard;
+};
+
+/**
+ * Lexes only the preprocessor directives from a source buffer, skipping
+ * comments, string literals and raw string literals in between.
+ */
+file_directives_t lex_directives(const char *data, std::size_t size);
+
+/**
+ * Thrown when the scanner encounters a construct it cannot evaluate, in
+ * which case the translation unit has to be parsed by libclang.
+ */
+class scanner_error_t : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+struct compiler_info_t;
+
+/**
+ * Dependency directive scanner, which computes the includes of translation
+ * units by evaluating only the preprocessor directives, similar to
+ * clang-scan-deps.
+ *
+ * Directive lists of all files are memoized for the entire run, so each
+ * header is lexed only once regardless of how many translation units
+ * include it. Predefined macros and builtin header search directories are
+ * queried once from each distinct compiler found in the compilation
+ * database.
+ */
+class include_scanner_t {
+public:
+    include_scanner_t();
+
+    ~include_scanner_t();
+    include_scanner_t(const include_scanner_t &) = delete;
+    include_scanner_t(include_scanner_t &&) = delete;
+    include_scanner_t &operator=(const include_scanner_t &) = delete;
+    include_scanner_t &operator=(include_scanner_t &&) = delete;
+
+    /**
+     * Scan translation unit and append all its include edges to `edges`.
+     *
+     * @return False if the translation unit must be parsed with libclang
+     */
+    bool scan(const boost::filesystem::path &tu_path,
+        const std::string &directory, const std::vector<std::string> &args,
+        std::vector<include_edge_t> &edges);
+
+    std::shared_ptr<const file_directives_t> directives(
+        const std::string &path);
+
+    bool file_exists(const std::string &path);
+
+    /**
+     * Forget memoized directives and existence of files, so that files
+     * modified since they were scanned are read again. Must not be called
+     * while translation units are being scanned.
+     */
+    void forget_files();
+
+    const std::string &canonical(const std::string &path);
+
+    std::shared_ptr<compiler_info_t> compiler_info(
+        const std::string &driver, const std::vector<std::string> &flags);
+
+    bool compiler_check(
+        compiler_info_t &compiler, const std::string &expression);
+
+private:
+    std::mutex directives_mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const file_directives_t>>
+        directives_;
+
+    std::mutex file_exists_mutex_;
+    std::unordered_map<std::string, bool> file_exists_;
+
+    std::mutex canonical_mutex_;
+    std::unordered_map<std::string, std::string> canonical_;
+
+    std::mutex compilers_mutex_;
+    std::map<std::string, std::shared_ptr<compiler_info_t>> compilers_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_INCLUDE_SCANNER_H
@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "file_watcher.h"
 #include "include_graph.h"
 #include "include_graph_cycles_printer.h"
 #include "include_graph_dependants_printer.h"
@@ -27,6 +28,8 @@
 #endif
 #include "include_graph_parser.h"
 #include "include_graph_plantuml_printer.h"
+#include "include_graph_shard.h"
+#include "include_graph_snapshot.h"
 #include "include_graph_topological_sort_printer.h"
 #include "include_graph_tree_printer.h"
 #include "util.h"
@@ -34,12 +37,16 @@
 #include <boost/program_options/detail/parsers.hpp>
 #include <boost/program_options/errors.hpp>
 #include <boost/program_options/options_description.hpp>
+#include <boost/program_options/positional_options.hpp>
 #include <boost/program_options/value_semantic.hpp>
 #include <boost/program_options/variables_map.hpp>
 
+#include <chrono>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <memory>
+#include <string>
 
 namespace po = boost::program_options;
 
@@ -59,30 +66,71 @@ void process_command_line_options(int argc, char **argv, po::variables_map &vm,
 std::ostream &get_output_stream(
     const boost::optional<boost::filesystem::path> &output_path);
 
+void print_include_graph(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph);
+
+/**
+ * Combine partial include graphs written by `--shard` runs into a single
+ * include graph.
+ */
+void merge_include_graphs(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph);
+
+void write_shard_include_graph(const clang_include_graph::config_t &config,
+    const clang_include_graph::include_graph_t &include_graph);
+
+void load_include_graph(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph);
+
+void save_include_graph(const clang_include_graph::config_t &config,
+    const clang_include_graph::include_graph_t &include_graph);
+
+#if defined(__linux__)
+/**
+ * Print the include graph, then keep parsing translation units affected by
+ * modified files and printing the updated graph until the process is
+ * interrupted.
+ */
+[[noreturn]] void watch_include_graph(
+    const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_parser_t &include_graph_parser,
+    clang_include_graph::include_graph_t &include_graph);
+#endif
+
 int main(int argc, char **argv)
 {
     using clang_include_graph::config_t;
-    using clang_include_graph::include_graph_cycles_printer_t;
-    using clang_include_graph::include_graph_dependants_printer_t;
-    using clang_include_graph::include_graph_graphml_printer_t;
-    using clang_include_graph::include_graph_graphviz_printer_t;
-#if defined(WITH_JSON_OUTPUT)
-    using clang_include_graph::include_graph_json_printer_t;
-#endif
     using clang_include_graph::include_graph_parser_t;
-    using clang_include_graph::include_graph_plantuml_printer_t;
     using clang_include_graph::include_graph_t;
-    using clang_include_graph::include_graph_topological_sort_printer_t;
-    using clang_include_graph::include_graph_tree_printer_t;
-    using clang_include_graph::path_printer_t;
-    using clang_include_graph::printer_t;
 
-    include_graph_t include_graph;
+    // The graph is never destroyed, as the OS reclaims its memory at exit
+    // much faster than freeing each of its vertices, edges and paths
+    static auto *const include_graph_ptr = new include_graph_t;
+    auto &include_graph = *include_graph_ptr;
     config_t config;
     po::variables_map vm;
 
     process_command_line_options(argc, argv, vm, config);
 
+    if (config.worker()) {
+        include_graph_parser_t include_graph_parser{config};
+        return include_graph_parser.parse_for_coordinator() ? 0 : -1;
+    }
+
+    if (config.load_graph()) {
+        load_include_graph(config, include_graph);
+        print_include_graph(config, include_graph);
+        return 0;
+    }
+
+    if (!config.partial_graphs().empty()) {
+        merge_include_graphs(config, include_graph);
+        if (config.save_graph())
+            save_include_graph(config, include_graph);
+        print_include_graph(config, include_graph);
+        return 0;
+    }
+
     LOG(info) << "Loading compilation database from "
               << config.compilation_database_directory().value() << '\n';
 
@@ -90,6 +138,118 @@ int main(int argc, char **argv)
     include_graph_parser_t include_graph_parser{config};
     include_graph_parser.parse(include_graph);
 
+#if defined(__linux__)
+    if (config.watch())
+        watch_include_graph(config, include_graph_parser, include_graph);
+#endif
+
+    if (config.shard()) {
+        write_shard_include_graph(config, include_graph);
+        return 0;
+    }
+
+    if (config.save_graph())
+        save_include_graph(config, include_graph);
+
+    print_include_graph(config, include_graph);
+}
+
+void merge_include_graphs(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph)
+{
+    include_graph.init(config);
+
+    for (const auto &partial_graph : config.partial_graphs()) {
+        LOG(info) << "Merging partial include graph from " << partial_graph
+                  << '\n';
+
+        std::ifstream ifs{partial_graph.string()};
+        if (!ifs ||
+            !clang_include_graph::read_partial_include_graph(
+                ifs, config, include_graph)) {
+            LOG(error) << "ERROR: Cannot read partial include graph from "
+                       << partial_graph << " - aborting..." << '\n';
+            exit(-1);
+        }
+    }
+}
+
+void write_shard_include_graph(const clang_include_graph::config_t &config,
+    const clang_include_graph::include_graph_t &include_graph)
+{
+    LOG(info) << "Writing partial include graph of shard "
+              << config.shard()->number << "/" << config.shard()->count
+              << '\n';
+
+    auto &output = get_output_stream(config.output_file());
+
+    clang_include_graph::write_partial_include_graph(output, include_graph);
+
+    output.flush();
+
+    if (config.output_file()) {
+        LOG(info) << "Output written to file: "
+                  << config.output_file()->string() << '\n';
+    }
+}
+
+void load_include_graph(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    include_graph.init(config);
+
+    std::string error;
+    if (!clang_include_graph::load_include_graph(
+            *config.load_graph(), config, include_graph, error)) {
+        LOG(error) << "ERROR: Cannot load include graph from "
+                   << *config.load_graph() << ": " << error
+                   << " - aborting..." << '\n';
+        exit(-1);
+    }
+
+    LOG(info) << "Loaded include graph with "
+              << boost::num_vertices(include_graph.graph().graph())
+              << " vertices and "
+              << boost::num_edges(include_graph.graph().graph())
+              << " edges from " << *config.load_graph() << " in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count()
+              << " ms" << '\n';
+}
+
+void save_include_graph(const clang_include_graph::config_t &config,
+    const clang_include_graph::include_graph_t &include_graph)
+{
+    if (!clang_include_graph::save_include_graph(
+            include_graph, *config.save_graph())) {
+        LOG(error) << "ERROR: Cannot save include graph to "
+                   << *config.save_graph() << " - aborting..." << '\n';
+        exit(-1);
+    }
+
+    LOG(info) << "Include graph saved to file: "
+              << config.save_graph()->string() << '\n';
+}
+
+void print_include_graph(const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_t &include_graph)
+{
+    using clang_include_graph::include_graph_cycles_printer_t;
+    using clang_include_graph::include_graph_dependants_printer_t;
+    using clang_include_graph::include_graph_graphml_printer_t;
+    using clang_include_graph::include_graph_graphviz_printer_t;
+#if defined(WITH_JSON_OUTPUT)
+    using clang_include_graph::include_graph_json_printer_t;
+#endif
+    using clang_include_graph::include_graph_plantuml_printer_t;
+    using clang_include_graph::include_graph_topological_sort_printer_t;
+    using clang_include_graph::include_graph_tree_printer_t;
+    using clang_include_graph::path_printer_t;
+    using clang_include_graph::printer_t;
+
     // Select file path printer based on config
     std::unique_ptr<path_printer_t> const path_printer =
         path_printer_t::from_config(config);
@@ -180,12 +340,61 @@ int main(int argc, char **argv)
         exit(-1);
     }
 
+    output.flush();
+
     if (config.output_file()) {
         LOG(info) << "Output written to file: "
                   << config.output_file()->string() << '\n';
     }
 }
 
+#if defined(__linux__)
+[[noreturn]] void watch_include_graph(
+    const clang_include_graph::config_t &config,
+    clang_include_graph::include_graph_parser_t &include_graph_parser,
+    clang_include_graph::include_graph_t &include_graph)
+{
+    using clang_include_graph::file_watcher_t;
+
+    const auto compilation_database_directory = boost::filesystem::
+        weakly_canonical(config.compilation_database_directory().value());
+    const auto compile_commands =
+        (compilation_database_directory / "compile_commands.json").string();
+    const auto compile_flags =
+        (compilation_database_directory / "compile_flags.txt").string();
+
+    file_watcher_t file_watcher;
+    bool is_updated{true};
+
+    for (;;) {
+        // Start watching files before printing, so that files modified
+        // while the graph is being printed trigger another update
+        auto files = include_graph_parser.dependencies();
+        files.emplace(compile_commands);
+        files.emplace(compile_flags);
+        file_watcher.add(files);
+
+        if (is_updated)
+            print_include_graph(config, include_graph);
+
+        const auto modified_files =
+            file_watcher.wait(std::chrono::milliseconds{200});
+
+        if (modified_files.count(compile_commands) > 0 ||
+            modified_files.count(compile_flags) > 0) {
+            LOG(info) << "Compilation database modified, parsing all "
+                         "translation units again";
+            include_graph_parser.parse(include_graph);
+            is_updated = true;
+        }
+        else {
+            is_updated =
+                include_graph_parser.update(include_graph, modified_files);
+        }
+    }
+}
+#endif
+
 void process_command_line_options(int argc, char **argv, po::variables_map &vm,
     clang_include_graph::config_t &config)
 {
@@ -201,6 +410,72 @@ void process_command_line_options(int argc, char **argv, po::variables_map &vm,
             "Log to specified file instead of console")
         ("jobs,J", po::value<unsigned>(),
             "Number of threads used to parse translation units")
+        ("parse-mode", po::value<std::string>(),
+            "Translation unit parse mode: 'full' (default), 'fast' skips "
+            "function bodies, template instantiation and diagnostics, "
+            "'compare' uses 'fast' and reports time saved versus 'full', "
+            "'scan' evaluates only preprocessor directives without libclang")
+        ("schedule", po::value<std::string>(),
+            "Order in which translation units are parsed: 'database' "
+            "(default) keeps the compilation database order, 'lpt' starts "
+            "with the longest expected parse times, 'locality' groups "
+            "translation units by directory")
+        ("timings-file", po::value<std::string>(),
+            "File with parse times of translation units from previous runs, "
+            "used and updated by --schedule (default: "
+            ".clang-include-graph-timings in compilation database "
+            "directory)")
+        ("max-memory", po::value<std::string>(),
+            "Start parsing translation units only while their memory usage, "
+            "estimated from translation units parsed so far, stays under a "
+            "limit in MB, 'auto' uses 90% of the cgroup memory limit or of "
+            "physical memory")
+        ("shared-index",
+            "Use a single libclang index for all threads instead of one "
+            "index per thread")
+        ("background-priority",
+            "Run libclang parsing threads with background priority")
+        ("worker-processes", po::value<unsigned>(),
+            "Parse translation units in a number of isolated worker "
+            "processes instead of threads, translation units which crash "
+            "are reported instead of aborting")
+        ("tu-timeout", po::value<unsigned>(),
+            "Kill worker processes which parse a single translation unit "
+            "for longer than specified number of seconds")
+        ("cache-dir", po::value<std::string>(),
+            "Cache include edges of translation units in a directory, and "
+            "reuse them in subsequent runs for translation units whose "
+            "sources, compile flags and included files didn't change")
+        ("cache-size-limit", po::value<unsigned>(),
+            "Maximum size of the cache directory in MB, least recently used "
+            "entries are removed when it's exceeded (default: 1024)")
+        ("watch",
+            "Keep running after printing the include graph, parse again "
+            "translation units affected by modified files and print the "
+            "updated graph (Linux only)")
+        ("shard", po::value<std::string>(),
+            "Parse only translation units of shard <number>/<count> and "
+            "write their partial include graph, partial graphs of all "
+            "shards are combined with 'clang-include-graph merge [options] "
+            "<partial graph>...'")
+        ("coordinator", po::value<std::string>(),
+            "Serve translation units to workers connecting to an endpoint, "
+            "'<host>:<port>' or 'unix:<path>', and print the include graph "
+            "merged from their results")
+        ("worker", po::value<std::string>(),
+            "Parse translation units served by a coordinator at an endpoint "
+            "using --jobs threads, instead of reading the compilation "
+            "database")
+        ("save-graph", po::value<std::string>(),
+            "Save the include graph in a binary snapshot file, which can be "
+            "printed later with --load-graph")
+        ("load-graph", po::value<std::string>(),
+            "Print the include graph from a snapshot file written by "
+            "--save-graph, instead of parsing translation units")
+        ("one-config-per-file",
+            "Parse each translation unit only once, using its first compile "
+            "command, instead of once per distinct set of preprocessor "
+            "flags")
         ("compilation-database-dir,d", po::value<std::string>(),
             "Path to compilation database directory (default: $PWD)")
         ("add-compile-flag", po::value<std::vector<std::string>>(),
@@ -241,8 +516,30 @@ void process_command_line_options(int argc, char **argv, po::variables_map &vm,
         ("plantuml,p", "Print include graph in PlantUML format");
     // clang-format on
 
+    // `clang-include-graph merge [options] <partial graph>...` prints the
+    // combined partial graphs of `--shard` runs instead of parsing
+    const auto is_merge = argc > 1 && std::string{argv[1]} == "merge";
+
+    po::options_description merge_options;
+    po::positional_options_description positional_options;
+    if (is_merge) {
+        merge_options.add_options()("partial-graph",
+            po::value<std::vector<std::string>>(),
+            "Partial include graph written by --shard");
+        positional_options.add("partial-graph", -1);
+    }
+
+    po::options_description all_options;
+    all_options.add(options).add(merge_options);
+
     try {
-        po::store(po::parse_command_line(argc, argv, options), vm);
+        // The `merge` command takes the place of the program name
+        po::store(po::command_line_parser(
+                      is_merge ? argc - 1 : argc, is_merge ? argv + 1 : argv)
+                      .options(all_options)
+                      .positional(positional_options)
+                      .run(),
+            vm);
         po::notify(vm);
     }
     catch (const po::error &e) {
@@ -251,6 +548,10 @@ void process_command_line_options(int argc, char **argv, po::variables_map &vm,
     }
 
     if (vm.count("help") > 0U) {
+        if (is_merge) {
+            std::cout << "Usage: clang-include-graph merge [options] "
+                         "<partial graph>...\n\n";
+        }
         std::cout << options << "\n";
         exit(0);
     }
@@ -260,6 +561,21 @@ void process_command_line_options(int argc, char **argv, po::variables_map &vm,
         exit(0);
     }
 
+    if (is_merge) {
+        if (vm.count("partial-graph") == 0U) {
+            std::cerr << "ERROR: No partial include graphs to merge"
+                      << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        if (vm.count("shard") > 0U || vm.count("watch") > 0U) {
+            std::cerr << "ERROR: --shard and --watch cannot be used with "
+                         "merge - aborting..."
+                      << '\n';
+            exit(-1);
+        }
+    }
+
     config.init(vm, clang_include_graph::util::join_cli_args(argc, argv));
 
     clang_include_graph::util::setup_logging(
@@ -0,0 +1,212 @@
+/**
+ * src/memory_budget.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "memory_budget.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <string>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace clang_include_graph {
+
+namespace {
+// Limits at least this large mean there is no limit
+constexpr std::uint64_t unlimited{1ULL << 60U};
+
+boost::optional<std::uint64_t> read_memory_limit(
+    const boost::filesystem::path &path)
+{
+    std::ifstream ifs{path.string()};
+    std::string value;
+    if (!(ifs >> value) || value == "max")
+        return {};
+
+    try {
+        const auto limit = std::stoull(value);
+        if (limit >= unlimited)
+            return {};
+        return limit;
+    }
+    catch (const std::exception & /*e*/) {
+        return {};
+    }
+}
+
+/**
+ * Get the lowest limit set in the cgroup hierarchy from `cgroup` up to
+ * the root, in which each cgroup directory contains a `file`.
+ */
+boost::optional<std::uint64_t> hierarchy_memory_limit(
+    const boost::filesystem::path &root, const std::string &cgroup,
+    const char *file)
+{
+    boost::optional<std::uint64_t> result;
+
+    auto path = boost::filesystem::path{cgroup}.relative_path();
+    for (;;) {
+        const auto limit = read_memory_limit(root / path / file);
+        if (limit && (!result || *limit < *result))
+            result = limit;
+
+        if (path.empty())
+            break;
+        path = path.parent_path();
+    }
+
+    return result;
+}
+} // namespace
+
+boost::optional<std::uint64_t> cgroup_memory_limit()
+{
+    // Each line has the form `<id>:<controllers>:<path>`, cgroup v2 has a
+    // single line with id 0 and no controllers
+    std::ifstream ifs{"/proc/self/cgroup"};
+    std::string line;
+
+    while (std::getline(ifs, line)) {
+        const auto first = line.find(':');
+        const auto second = line.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos)
+            continue;
+
+        const auto controllers = line.substr(first + 1, second - first - 1);
+        const auto cgroup = line.substr(second + 1);
+
+        if (controllers.empty()) {
+            const auto limit = hierarchy_memory_limit(
+                "/sys/fs/cgroup", cgroup, "memory.max");
+            if (limit)
+                return limit;
+        }
+        else if (controllers == "memory" ||
+            controllers.find("memory,") == 0 ||
+            controllers.find(",memory") != std::string::npos) {
+            return hierarchy_memory_limit(
+                "/sys/fs/cgroup/memory", cgroup, "memory.limit_in_bytes");
+        }
+    }
+
+    return {};
+}
+
+std::uint64_t physical_memory()
+{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    const auto pages = sysconf(_SC_PHYS_PAGES);
+    const auto page_size = sysconf(_SC_PAGESIZE);
+    if (pages > 0 && page_size > 0)
+        return static_cast<std::uint64_t>(pages) *
+            static_cast<std::uint64_t>(page_size);
+#endif
+    return 0;
+}
+
+std::uint64_t resident_memory()
+{
+#if defined(_SC_PAGESIZE)
+    // The second field is the number of resident pages
+    std::ifstream ifs{"/proc/self/statm"};
+    std::uint64_t size{0};
+    std::uint64_t resident{0};
+    if (ifs >> size >> resident)
+        return resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+    return 0;
+}
+
+memory_budget_t::memory_budget_t(std::uint64_t limit, std::uint64_t baseline,
+    std::uint64_t initial_estimate)
+    : limit_{limit}
+    , baseline_{baseline}
+    , initial_estimate_{initial_estimate}
+{
+}
+
+std::uint64_t memory_budget_t::estimate() const
+{
+    if (measured_count_ == 0)
+        return initial_estimate_;
+
+    // Leave a margin for translation units larger than the average, and
+    // for the allocator overhead not included in libclang's resource usage
+    return measured_total_ / measured_count_ * 3 / 2;
+}
+
+std::uint64_t memory_budget_t::acquire()
+{
+    std::unique_lock<std::mutex> lock{mutex_};
+
+    bool waited{false};
+    for (;;) {
+        const auto reservation = estimate();
+        if (admitted_ == 0 || baseline_ + reserved_ + reservation <= limit_) {
+            admitted_++;
+            reserved_ += reservation;
+            peak_admitted_ = std::max(peak_admitted_, admitted_);
+            return reservation;
+        }
+
+        if (!waited) {
+            waited = true;
+            waits_++;
+        }
+
+        released_.wait(lock);
+    }
+}
+
+void memory_budget_t::release(std::uint64_t reserved, std::uint64_t footprint)
+{
+    {
+        const std::lock_guard<std::mutex> guard{mutex_};
+
+        admitted_--;
+        reserved_ -= reserved;
+
+        if (footprint > 0) {
+            measured_count_++;
+            measured_total_ += footprint;
+        }
+    }
+
+    released_.notify_all();
+}
+
+std::uint64_t memory_budget_t::limit() const noexcept { return limit_; }
+
+unsigned memory_budget_t::peak_admitted() const
+{
+    const std::lock_guard<std::mutex> guard{mutex_};
+    return peak_admitted_;
+}
+
+std::uint64_t memory_budget_t::waits() const
+{
+    const std::lock_guard<std::mutex> guard{mutex_};
+    return waits_;
+}
+
+} // namespace clang_include_graph
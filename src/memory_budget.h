@@ -0,0 +1,115 @@
+/**
+ * src/memory_budget.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_MEMORY_BUDGET_H
+#define CLANG_INCLUDE_GRAPH_MEMORY_BUDGET_H
+
+#include <boost/optional.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace clang_include_graph {
+
+/**
+ * Get the memory limit of the cgroup (v1 or v2) of the current process,
+ * if it has one.
+ */
+boost::optional<std::uint64_t> cgroup_memory_limit();
+
+/**
+ * Get the total physical memory of the host.
+ */
+std::uint64_t physical_memory();
+
+/**
+ * Get the resident set size of the current process.
+ */
+std::uint64_t resident_memory();
+
+/**
+ * Admission control for translation units parsed concurrently, which only
+ * lets a translation unit start if the projected memory usage of the
+ * process stays under the limit.
+ *
+ * The projected usage is the memory used before parsing started plus the
+ * estimated footprints of the translation units being parsed. The current
+ * resident set size isn't used, as translation units which just started
+ * haven't allocated their memory yet, and memory freed by finished ones
+ * is often kept by the allocator. Footprints are estimated from the
+ * footprints of translation units parsed so far, so the number of
+ * translation units parsed concurrently adapts during the run. A single
+ * translation unit is always admitted, even if it exceeds the limit.
+ */
+class memory_budget_t {
+public:
+    /**
+     * @param limit Maximum memory usage of the process in bytes
+     * @param baseline Memory usage of the process before parsing
+     * @param initial_estimate Footprint assumed until the first translation
+     *                         unit is parsed
+     */
+    memory_budget_t(std::uint64_t limit, std::uint64_t baseline,
+        std::uint64_t initial_estimate);
+
+    /**
+     * Block until a translation unit fits in the budget.
+     *
+     * @return Memory reserved for the translation unit
+     */
+    std::uint64_t acquire();
+
+    /**
+     * Release reservation of a parsed translation unit and update the
+     * estimate with its measured footprint, 0 if it's unknown.
+     */
+    void release(std::uint64_t reserved, std::uint64_t footprint);
+
+    std::uint64_t limit() const noexcept;
+
+    /**
+     * Largest number of translation units admitted at the same time.
+     */
+    unsigned peak_admitted() const;
+
+    /**
+     * Number of times a translation unit had to wait for admission.
+     */
+    std::uint64_t waits() const;
+
+private:
+    std::uint64_t estimate() const;
+
+    std::uint64_t limit_;
+    std::uint64_t baseline_;
+    std::uint64_t initial_estimate_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    unsigned admitted_{0};
+    std::uint64_t reserved_{0};
+    std::uint64_t measured_count_{0};
+    std::uint64_t measured_total_{0};
+    unsigned peak_admitted_{0};
+    std::uint64_t waits_{0};
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_MEMORY_BUDGET_H
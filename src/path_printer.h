@@ -42,10 +42,10 @@ public:
     path_printer_t &operator=(const path_printer_t &) = default;
     path_printer_t &operator=(path_printer_t &&) = default;
 
-    virtual std::string print(const include_graph_t::vertex_t &v) const
-    {
-        return v.file;
-    }
+    /**
+     * Format path of a file decoded with `include_graph_t::file()`.
+     */
+    virtual std::string print(const std::string &file) const { return file; }
 
     static std::unique_ptr<path_printer_t> from_config(const config_t &config);
 
@@ -63,14 +63,14 @@ public:
     {
     }
 
-    std::string print(const include_graph_t::vertex_t &v) const override
+    std::string print(const std::string &file) const override
     {
         // Only return relative path, if path is in relative_to_ directory
-        if (boost::starts_with(v.file, relative_to_.string())) {
-            return boost::filesystem::relative(v.file, relative_to_).string();
+        if (boost::starts_with(file, relative_to_.string())) {
+            return boost::filesystem::relative(file, relative_to_).string();
         }
 
-        return v.file;
+        return file;
     }
 
 private:
@@ -81,9 +81,9 @@ class path_name_printer_t final : public path_printer_t {
 public:
     using path_printer_t::path_printer_t;
 
-    std::string print(const include_graph_t::vertex_t &v) const override
+    std::string print(const std::string &file) const override
     {
-        return boost::filesystem::path(v.file).filename().string();
+        return boost::filesystem::path(file).filename().string();
     }
 };
 
@@ -0,0 +1,132 @@
+/**
+ * src/path_table.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "path_table.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+
+namespace clang_include_graph {
+
+constexpr path_id_t path_table_t::empty_path;
+constexpr path_id_t path_table_t::no_parent;
+
+path_table_t::path_table_t() { intern({}); }
+
+std::size_t path_table_t::name_hash_t::operator()(
+    boost::string_view name) const noexcept
+{
+    return boost::hash_range(name.begin(), name.end());
+}
+
+std::uint64_t path_table_t::child_key(
+    path_id_t parent, std::uint32_t name) noexcept
+{
+    return (static_cast<std::uint64_t>(parent) << 32U) | name;
+}
+
+std::uint32_t path_table_t::intern_name(boost::string_view name)
+{
+    auto it = name_ids_.find(name);
+    if (it != name_ids_.end())
+        return it->second;
+
+    const auto id = static_cast<std::uint32_t>(names_.size());
+    names_.emplace_back(names_arena_.store(name));
+    name_ids_.emplace(names_.back(), id);
+    return id;
+}
+
+path_id_t path_table_t::intern(boost::string_view path)
+{
+    auto parent = no_parent;
+    std::size_t first = 0;
+    for (;;) {
+        const auto last = std::min(path.find('/', first), path.size());
+        const auto name = intern_name(path.substr(first, last - first));
+
+        const auto id = static_cast<path_id_t>(entries_.size());
+        const auto it = children_.emplace(child_key(parent, name), id);
+        if (it.second)
+            entries_.push_back({parent, name});
+        parent = it.first->second;
+
+        if (last == path.size())
+            return parent;
+        first = last + 1;
+    }
+}
+
+boost::optional<path_id_t> path_table_t::find(boost::string_view path) const
+{
+    auto parent = no_parent;
+    std::size_t first = 0;
+    for (;;) {
+        const auto last = std::min(path.find('/', first), path.size());
+
+        const auto name = name_ids_.find(path.substr(first, last - first));
+        if (name == name_ids_.end())
+            return {};
+
+        const auto it = children_.find(child_key(parent, name->second));
+        if (it == children_.end())
+            return {};
+        parent = it->second;
+
+        if (last == path.size())
+            return parent;
+        first = last + 1;
+    }
+}
+
+std::string path_table_t::path(path_id_t id) const
+{
+    // Collect components from the last one, then join them in order
+    std::vector<std::uint32_t> names;
+    std::size_t size{0};
+    for (auto it = id; it != no_parent; it = entries_[it].parent) {
+        names.emplace_back(entries_[it].name);
+        size += names_[entries_[it].name].size() + 1;
+    }
+
+    std::string result;
+    result.reserve(size);
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        if (it != names.rbegin())
+            result += '/';
+        result.append(names_[*it].data(), names_[*it].size());
+    }
+
+    return result;
+}
+
+std::size_t path_table_t::size() const noexcept { return entries_.size(); }
+
+void path_table_t::clear()
+{
+    entries_.clear();
+    children_.clear();
+    name_ids_.clear();
+    names_.clear();
+    names_arena_.reset();
+
+    intern({});
+}
+
+} // namespace clang_include_graph
@@ -0,0 +1,109 @@
+/**
+ * src/path_table.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_PATH_TABLE_H
+#define CLANG_INCLUDE_GRAPH_PATH_TABLE_H
+
+#include "arena.h"
+
+#include <boost/optional.hpp>
+#include <boost/utility/string_view.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace clang_include_graph {
+
+using path_id_t = std::uint32_t;
+
+/**
+ * Table of interned paths, in which each path is stored as the ID of its
+ * parent directory and the ID of its last component.
+ *
+ * Paths of files in the same directory share their directory entry, and
+ * each distinct component is stored only once, so the table takes a
+ * fraction of the memory of full path strings when there are many files
+ * under the same roots. Paths are split on every '/', so any string is
+ * decoded back exactly as it was interned. IDs are assigned consecutively
+ * and stay valid until the table is cleared, `empty_path` is the ID of an
+ * empty path.
+ */
+class path_table_t {
+public:
+    static constexpr path_id_t empty_path{0};
+
+    path_table_t();
+
+    /**
+     * Get the ID of a path, adding the path and its parent directories to
+     * the table if needed.
+     */
+    path_id_t intern(boost::string_view path);
+
+    /**
+     * Get the ID of a path, if it's in the table.
+     */
+    boost::optional<path_id_t> find(boost::string_view path) const;
+
+    /**
+     * Decode the full path of an ID.
+     */
+    std::string path(path_id_t id) const;
+
+    /**
+     * Number of paths in the table, including parent directories.
+     */
+    std::size_t size() const noexcept;
+
+    void clear();
+
+private:
+    static constexpr path_id_t no_parent{
+        std::numeric_limits<path_id_t>::max()};
+
+    struct entry_t {
+        path_id_t parent;
+        std::uint32_t name;
+    };
+
+    struct name_hash_t {
+        std::size_t operator()(boost::string_view name) const noexcept;
+    };
+
+    static std::uint64_t child_key(
+        path_id_t parent, std::uint32_t name) noexcept;
+
+    std::uint32_t intern_name(boost::string_view name);
+
+    std::vector<entry_t> entries_;
+    std::unordered_map<std::uint64_t, path_id_t> children_;
+    // Names are stored in an arena, which keeps them in place for
+    // `name_ids_` and frees them all at once
+    arena_t names_arena_;
+    std::vector<boost::string_view> names_;
+    std::unordered_map<boost::string_view, std::uint32_t, name_hash_t>
+        name_ids_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_PATH_TABLE_H
@@ -0,0 +1,390 @@
+/**
+ * src/translation_unit_cache.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "translation_unit_cache.h"
+#include "util.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <array>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <utility>
+
+namespace clang_include_graph {
+
+namespace {
+// Increment whenever the format of entries changes
+constexpr auto cache_format = "clang-include-graph-cache 1";
+
+constexpr auto entry_extension = ".tu";
+
+constexpr std::uint64_t from_translation_unit_flag{1U};
+constexpr std::uint64_t is_system_flag{2U};
+
+bool hash_file(const std::string &path, std::uint64_t &hash)
+{
+    std::ifstream ifs{path, std::ios::binary};
+    if (!ifs)
+        return false;
+
+    hash = fnv1a_hash(nullptr, 0);
+
+    std::array<char, 65536> buffer{};
+    while (ifs) {
+        ifs.read(buffer.data(), buffer.size());
+        hash = fnv1a_hash(
+            buffer.data(), static_cast<std::size_t>(ifs.gcount()), hash);
+    }
+
+    return ifs.eof();
+}
+
+std::vector<std::string> split(const std::string &line)
+{
+    std::vector<std::string> result;
+    std::string::size_type start{0};
+    for (;;) {
+        const auto end = line.find('\t', start);
+        result.emplace_back(line.substr(start, end - start));
+        if (end == std::string::npos)
+            break;
+        start = end + 1;
+    }
+    return result;
+}
+
+// Arguments which name output files, and don't affect includes
+bool is_output_argument(const std::string &arg)
+{
+    return arg == "-o" || arg == "-MF" || arg == "-MT" || arg == "-MQ";
+}
+} // namespace
+
+std::uint64_t fnv1a_hash(const char *data, std::size_t size, std::uint64_t hash)
+{
+    for (std::size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+translation_unit_cache_t::translation_unit_cache_t(
+    boost::filesystem::path directory, std::uint64_t size_limit)
+    : directory_{std::move(directory)}
+    , size_limit_{size_limit}
+{
+    boost::filesystem::create_directories(directory_);
+}
+
+std::string translation_unit_cache_t::key(
+    const boost::filesystem::path &tu_path, const std::string &directory,
+    const std::vector<std::string> &args, const std::string &options)
+{
+    std::string material{cache_format};
+    const auto append = [&material](const std::string &value) {
+        material.push_back('\0');
+        material.append(value);
+    };
+
+    append(tu_path.string());
+    append(directory);
+    append(options);
+
+    for (auto i = 0U; i < args.size(); i++) {
+        if (is_output_argument(args[i])) {
+            i++;
+            continue;
+        }
+        if (args[i].size() > 2 && args[i].compare(0, 2, "-o") == 0)
+            continue;
+
+        append(args[i]);
+    }
+
+    std::ostringstream result;
+    result << std::hex << std::setw(16) << std::setfill('0')
+           << fnv1a_hash(material.data(), material.size());
+    return result.str();
+}
+
+boost::filesystem::path translation_unit_cache_t::entry_path(
+    const std::string &key) const
+{
+    return directory_ / (key + entry_extension);
+}
+
+translation_unit_cache_t::file_stamp_t translation_unit_cache_t::current_stamp(
+    const std::string &path, bool with_hash)
+{
+    file_stamp_t stamp;
+    {
+        const std::lock_guard<std::mutex> guard{stamps_mutex_};
+        auto it = stamps_.find(path);
+        if (it != stamps_.end()) {
+            if (!with_hash || it->second.has_hash || !it->second.exists)
+                return it->second;
+            stamp = it->second;
+        }
+    }
+
+    if (!stamp.exists) {
+        boost::system::error_code ec;
+        stamp.size = boost::filesystem::file_size(path, ec);
+        if (!ec)
+            stamp.mtime = boost::filesystem::last_write_time(path, ec);
+        stamp.exists = !ec;
+    }
+
+    if (with_hash && stamp.exists)
+        stamp.has_hash = hash_file(path, stamp.hash);
+
+    const std::lock_guard<std::mutex> guard{stamps_mutex_};
+    stamps_[path] = stamp;
+
+    return stamp;
+}
+
+bool translation_unit_cache_t::is_up_to_date(
+    const std::string &path, const file_stamp_t &stored)
+{
+    auto stamp = current_stamp(path, false);
+    if (!stamp.exists || stamp.size != stored.size)
+        return false;
+
+    if (stamp.mtime == stored.mtime)
+        return true;
+
+    stamp = current_stamp(path, true);
+    return stamp.has_hash && stamp.hash == stored.hash;
+}
+
+bool translation_unit_cache_t::load(
+    const std::string &key, std::vector<include_edge_t> &edges)
+{
+    const auto path = entry_path(key);
+
+    std::ifstream ifs{path.string()};
+    std::string line;
+
+    if (!ifs || !std::getline(ifs, line) || line != cache_format) {
+        misses_++;
+        return false;
+    }
+
+    std::vector<include_edge_t> result;
+    bool valid{true};
+
+    while (valid && std::getline(ifs, line)) {
+        const auto fields = split(line);
+
+        // Numbers in a corrupted entry may fail to parse
+        try {
+            if (fields.size() != 5) {
+                valid = false;
+            }
+            else if (fields[0] == "D") {
+                file_stamp_t stored;
+                stored.size = std::stoull(fields[1]);
+                stored.mtime =
+                    static_cast<std::time_t>(std::stoll(fields[2]));
+                stored.hash = std::stoull(fields[3], nullptr, 16);
+                stored.has_hash = true;
+
+                valid = is_up_to_date(fields[4], stored);
+            }
+            else if (fields[0] == "E") {
+                const auto flags = std::stoull(fields[1]);
+
+                include_edge_t edge;
+                edge.from_translation_unit =
+                    (flags & from_translation_unit_flag) != 0U;
+                edge.is_system = (flags & is_system_flag) != 0U;
+                edge.to = fields[2];
+                edge.from = fields[3];
+                edge.include_spelling = fields[4];
+                result.emplace_back(std::move(edge));
+            }
+            else {
+                valid = false;
+            }
+        }
+        catch (const std::exception & /*e*/) {
+            valid = false;
+        }
+    }
+
+    if (!valid) {
+        misses_++;
+        return false;
+    }
+
+    // Mark the entry as recently used
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(path, std::time(nullptr), ec);
+
+    hits_++;
+    edges = std::move(result);
+    return true;
+}
+
+void translation_unit_cache_t::store(const std::string &key,
+    const boost::filesystem::path &tu_path,
+    const std::vector<include_edge_t> &edges)
+{
+    std::set<std::string> dependencies{tu_path.string()};
+    for (const auto &edge : edges) {
+        dependencies.emplace(edge.from);
+        dependencies.emplace(edge.to);
+    }
+
+    std::ostringstream entry;
+    entry << cache_format << '\n';
+
+    const auto now = std::time(nullptr);
+
+    for (const auto &dependency : dependencies) {
+        const auto stamp = current_stamp(dependency, true);
+        if (!stamp.has_hash) {
+            LOG(debug) << "Not caching translation unit " << tu_path
+                       << " - cannot read " << dependency;
+            return;
+        }
+
+        // Modification times have a resolution of one second, so a file
+        // modified within the last second could still change without
+        // changing its modification time. Such files are always verified
+        // by their content hash.
+        const auto mtime = stamp.mtime + 1 < now ? stamp.mtime : 0;
+
+        entry << "D\t" << stamp.size << '\t'
+              << static_cast<long long>(mtime) << '\t' << std::hex
+              << stamp.hash << std::dec << '\t' << dependency << '\n';
+    }
+
+    for (const auto &edge : edges) {
+        std::uint64_t flags{0};
+        if (edge.from_translation_unit)
+            flags |= from_translation_unit_flag;
+        if (edge.is_system)
+            flags |= is_system_flag;
+
+        entry << "E\t" << flags << '\t' << edge.to << '\t' << edge.from << '\t'
+              << edge.include_spelling << '\n';
+    }
+
+    // Write to a temporary file first, so that concurrent runs sharing the
+    // cache directory never see partially written entries
+    const auto path = entry_path(key);
+    const auto temporary_path =
+        directory_ / boost::filesystem::unique_path("%%%%%%%%%%%%.tmp");
+
+    {
+        std::ofstream ofs{temporary_path.string()};
+        ofs << entry.str();
+        if (!ofs) {
+            LOG(warning) << "Cannot write translation unit cache entry "
+                         << temporary_path;
+            boost::system::error_code ec;
+            boost::filesystem::remove(temporary_path, ec);
+            return;
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(temporary_path, path, ec);
+    if (ec) {
+        LOG(warning) << "Cannot write translation unit cache entry " << path
+                     << ": " << ec.message();
+        boost::filesystem::remove(temporary_path, ec);
+    }
+}
+
+void translation_unit_cache_t::collect_garbage()
+{
+    struct entry_t {
+        std::time_t last_used;
+        std::uint64_t size;
+        boost::filesystem::path path;
+    };
+
+    std::vector<entry_t> entries;
+    std::uint64_t total_size{0};
+
+    boost::system::error_code ec;
+    for (boost::filesystem::directory_iterator it{directory_, ec}, end;
+         !ec && it != end; it.increment(ec)) {
+        const auto &path = it->path();
+        if (path.extension() != entry_extension)
+            continue;
+
+        boost::system::error_code entry_ec;
+        entry_t entry{boost::filesystem::last_write_time(path, entry_ec),
+            boost::filesystem::file_size(path, entry_ec), path};
+        if (entry_ec)
+            continue;
+
+        total_size += entry.size;
+        entries.emplace_back(std::move(entry));
+    }
+
+    if (total_size <= size_limit_)
+        return;
+
+    std::sort(entries.begin(), entries.end(),
+        [](const auto &lhs, const auto &rhs) {
+            return lhs.last_used < rhs.last_used;
+        });
+
+    for (const auto &entry : entries) {
+        if (total_size <= size_limit_)
+            break;
+
+        if (boost::filesystem::remove(entry.path, ec)) {
+            total_size -= entry.size;
+            evictions_++;
+        }
+    }
+
+    LOG(debug) << "Evicted " << evictions_ << " translation unit cache entries";
+}
+
+void translation_unit_cache_t::forget_file_stamps()
+{
+    const std::lock_guard<std::mutex> guard{stamps_mutex_};
+    stamps_.clear();
+}
+
+std::uint64_t translation_unit_cache_t::hits() const noexcept { return hits_; }
+
+std::uint64_t translation_unit_cache_t::misses() const noexcept
+{
+    return misses_;
+}
+
+std::uint64_t translation_unit_cache_t::evictions() const noexcept
+{
+    return evictions_;
+}
+
+} // namespace clang_include_graph
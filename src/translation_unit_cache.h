@@ -0,0 +1,134 @@
+/**
+ * src/translation_unit_cache.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_CACHE_H
+#define CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_CACHE_H
+
+#include "include_graph.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Compute 64-bit FNV-1a hash of a buffer, optionally continuing from the
+ * hash of a previous buffer.
+ */
+std::uint64_t fnv1a_hash(const char *data, std::size_t size,
+    std::uint64_t hash = 14695981039346656037ULL);
+
+/**
+ * Persistent cache of the include edges of translation units, which lets
+ * repeated runs skip translation units whose sources, compile arguments
+ * and included files didn't change.
+ *
+ * Each translation unit is stored in a separate file named after its key.
+ * Along with the edges, an entry records the size, modification time and
+ * content hash of every file the translation unit included. An entry is
+ * reused only if all of them are unchanged. Files with a new modification
+ * time are hashed again, so touching a file or checking it out again
+ * doesn't invalidate entries.
+ *
+ * Entries are stored without applying any of the edge filters, so a cache
+ * directory can be shared by runs with different output options.
+ */
+class translation_unit_cache_t {
+public:
+    /**
+     * @param directory Cache directory, created if it doesn't exist
+     * @param size_limit Maximum total size of entries in bytes
+     */
+    translation_unit_cache_t(
+        boost::filesystem::path directory, std::uint64_t size_limit);
+
+    /**
+     * Make the key of a translation unit from everything which affects its
+     * includes, except for the contents of the included files.
+     */
+    static std::string key(const boost::filesystem::path &tu_path,
+        const std::string &directory, const std::vector<std::string> &args,
+        const std::string &options);
+
+    /**
+     * Load edges of translation unit if its entry is up to date.
+     */
+    bool load(const std::string &key, std::vector<include_edge_t> &edges);
+
+    void store(const std::string &key, const boost::filesystem::path &tu_path,
+        const std::vector<include_edge_t> &edges);
+
+    /**
+     * Remove least recently used entries until the cache fits in its size
+     * limit.
+     */
+    void collect_garbage();
+
+    /**
+     * Forget memoized stamps of files, so that files modified since they
+     * were checked are checked again.
+     */
+    void forget_file_stamps();
+
+    std::uint64_t hits() const noexcept;
+
+    std::uint64_t misses() const noexcept;
+
+    std::uint64_t evictions() const noexcept;
+
+private:
+    struct file_stamp_t {
+        bool exists{false};
+        std::uint64_t size{0};
+        std::time_t mtime{0};
+        bool has_hash{false};
+        std::uint64_t hash{0};
+    };
+
+    /**
+     * Get current stamp of a file, memoized for the entire run as
+     * translation units share most of their headers.
+     */
+    file_stamp_t current_stamp(const std::string &path, bool with_hash);
+
+    bool is_up_to_date(const std::string &path, const file_stamp_t &stored);
+
+    boost::filesystem::path entry_path(const std::string &key) const;
+
+    boost::filesystem::path directory_;
+    std::uint64_t size_limit_;
+
+    std::mutex stamps_mutex_;
+    std::unordered_map<std::string, file_stamp_t> stamps_;
+
+    std::atomic<std::uint64_t> hits_{0};
+    std::atomic<std::uint64_t> misses_{0};
+    std::atomic<std::uint64_t> evictions_{0};
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_CACHE_H
@@ -0,0 +1,211 @@
+/**
+ * src/translation_unit_schedule.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "translation_unit_schedule.h"
+#include "util.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <numeric>
+#include <utility>
+
+namespace clang_include_graph {
+
+namespace {
+std::uint64_t file_size_kb(const boost::filesystem::path &path)
+{
+    boost::system::error_code ec;
+    const auto size = boost::filesystem::file_size(path, ec);
+    if (ec)
+        return 0;
+
+    return std::max<std::uint64_t>(size / 1024, 1);
+}
+} // namespace
+
+parse_timings_t::parse_timings_t(boost::filesystem::path file)
+    : file_{std::move(file)}
+{
+}
+
+void parse_timings_t::load()
+{
+    std::ifstream ifs{file_.string()};
+    std::string line;
+
+    while (std::getline(ifs, line)) {
+        const auto separator = line.find('\t');
+        if (separator == std::string::npos)
+            continue;
+
+        // Skip lines which fail to parse
+        try {
+            history_us_[line.substr(separator + 1)] =
+                std::stoull(line.substr(0, separator));
+        }
+        catch (const std::exception & /*e*/) {
+        }
+    }
+
+    std::uint64_t total_us{0};
+    std::uint64_t total_kb{0};
+    for (const auto &timing : history_us_) {
+        const auto size_kb = file_size_kb(timing.first);
+        if (size_kb == 0)
+            continue;
+
+        total_us += timing.second;
+        total_kb += size_kb;
+    }
+
+    if (total_kb > 0)
+        us_per_kb_ = std::max<std::uint64_t>(total_us / total_kb, 1);
+
+    LOG(debug) << "Loaded parse times of " << history_us_.size()
+               << " translation units from " << file_;
+}
+
+void parse_timings_t::save() const
+{
+    auto timings = history_us_;
+    {
+        const std::lock_guard<std::mutex> guard{recorded_mutex_};
+        for (const auto &timing : recorded_us_)
+            timings[timing.first] = timing.second;
+    }
+
+    // Write to a temporary file first, so that concurrent runs never see
+    // partially written timings
+    const auto temporary_path = file_.parent_path() /
+        boost::filesystem::unique_path("%%%%%%%%%%%%.tmp");
+
+    boost::system::error_code ec;
+    boost::filesystem::create_directories(file_.parent_path(), ec);
+
+    {
+        std::ofstream ofs{temporary_path.string()};
+        for (const auto &timing : timings)
+            ofs << timing.second << '\t' << timing.first << '\n';
+
+        if (!ofs) {
+            LOG(warning) << "Cannot write parse times to " << temporary_path;
+            boost::filesystem::remove(temporary_path, ec);
+            return;
+        }
+    }
+
+    boost::filesystem::rename(temporary_path, file_, ec);
+    if (ec) {
+        LOG(warning) << "Cannot write parse times to " << file_ << ": "
+                     << ec.message();
+        boost::filesystem::remove(temporary_path, ec);
+    }
+}
+
+void parse_timings_t::record(
+    const boost::filesystem::path &tu_path, std::uint64_t duration_us)
+{
+    const std::lock_guard<std::mutex> guard{recorded_mutex_};
+
+    auto &recorded = recorded_us_[tu_path.string()];
+    recorded = std::max(recorded, duration_us);
+}
+
+std::uint64_t parse_timings_t::expected_duration_us(
+    const boost::filesystem::path &tu_path) const
+{
+    auto it = history_us_.find(tu_path.string());
+    if (it != history_us_.end())
+        return it->second;
+
+    return file_size_kb(tu_path) * us_per_kb_;
+}
+
+std::vector<std::size_t> schedule_translation_units(
+    const std::vector<boost::filesystem::path> &tu_paths,
+    schedule_t schedule, const parse_timings_t &timings)
+{
+    std::vector<std::size_t> order(tu_paths.size());
+    std::iota(order.begin(), order.end(), 0U);
+
+    if (schedule == schedule_t::database)
+        return order;
+
+    std::vector<std::uint64_t> expected_us;
+    expected_us.reserve(tu_paths.size());
+    for (const auto &tu_path : tu_paths)
+        expected_us.emplace_back(timings.expected_duration_us(tu_path));
+
+    const auto longest_first = [&expected_us](std::size_t lhs,
+                                   std::size_t rhs) {
+        return expected_us[lhs] > expected_us[rhs];
+    };
+
+    if (schedule == schedule_t::lpt) {
+        std::stable_sort(order.begin(), order.end(), longest_first);
+        return order;
+    }
+
+    // Translation units in the same directory usually include the same
+    // headers, parsing them together keeps the headers in the page cache.
+    // Directories with the longest total parse time start first, so that
+    // large directories don't form the tail.
+    std::map<boost::filesystem::path, std::vector<std::size_t>> directories;
+    for (const auto index : order)
+        directories[tu_paths[index].parent_path()].emplace_back(index);
+
+    std::vector<std::pair<std::uint64_t, std::vector<std::size_t>>> groups;
+    for (auto &directory : directories) {
+        auto &indices = directory.second;
+        std::stable_sort(indices.begin(), indices.end(), longest_first);
+
+        std::uint64_t total_us{0};
+        for (const auto index : indices)
+            total_us += expected_us[index];
+
+        groups.emplace_back(total_us, std::move(indices));
+    }
+
+    std::stable_sort(groups.begin(), groups.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.first > rhs.first; });
+
+    order.clear();
+    for (const auto &group : groups)
+        order.insert(order.end(), group.second.begin(), group.second.end());
+
+    return order;
+}
+
+std::uint64_t ideal_makespan_us(
+    const std::vector<std::uint64_t> &durations_us, unsigned workers)
+{
+    if (durations_us.empty() || workers == 0)
+        return 0;
+
+    const auto total_us = std::accumulate(
+        durations_us.begin(), durations_us.end(), std::uint64_t{0});
+    const auto longest_us =
+        *std::max_element(durations_us.begin(), durations_us.end());
+
+    return std::max(longest_us, (total_us + workers - 1) / workers);
+}
+
+} // namespace clang_include_graph
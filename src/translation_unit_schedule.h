@@ -0,0 +1,98 @@
+/**
+ * src/translation_unit_schedule.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_SCHEDULE_H
+#define CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_SCHEDULE_H
+
+#include "config.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Parse times of translation units measured in previous runs.
+ *
+ * Timings are stored in a text file with a `<microseconds>\t<path>` line
+ * per translation unit. Translation units without a recorded parse time
+ * are estimated from their size, scaled by the average parse time per
+ * byte of translation units which have one.
+ */
+class parse_timings_t {
+public:
+    explicit parse_timings_t(boost::filesystem::path file);
+
+    /**
+     * Load timings from file, a missing or malformed file is treated as an
+     * empty history.
+     */
+    void load();
+
+    /**
+     * Write recorded timings to file, keeping timings of translation units
+     * which were not parsed in this run.
+     */
+    void save() const;
+
+    /**
+     * Record parse time of a translation unit, the longest one is kept if
+     * it's parsed with several compile commands.
+     */
+    void record(
+        const boost::filesystem::path &tu_path, std::uint64_t duration_us);
+
+    std::uint64_t expected_duration_us(
+        const boost::filesystem::path &tu_path) const;
+
+private:
+    boost::filesystem::path file_;
+    std::map<std::string, std::uint64_t> history_us_;
+    // Average parse time per kilobyte of translation units in history
+    std::uint64_t us_per_kb_{1};
+
+    mutable std::mutex recorded_mutex_;
+    std::map<std::string, std::uint64_t> recorded_us_;
+};
+
+/**
+ * Get the order in which translation units should be parsed.
+ *
+ * @return Indices into `tu_paths`
+ */
+std::vector<std::size_t> schedule_translation_units(
+    const std::vector<boost::filesystem::path> &tu_paths,
+    schedule_t schedule, const parse_timings_t &timings);
+
+/**
+ * Lower bound of the time needed to run jobs with given durations on a
+ * number of workers: the longest job, or all jobs evenly divided between
+ * the workers.
+ */
+std::uint64_t ideal_makespan_us(
+    const std::vector<std::uint64_t> &durations_us, unsigned workers);
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_TRANSLATION_UNIT_SCHEDULE_H
@@ -17,6 +17,7 @@
  */
 
 #include "util.h"
+#include <boost/algorithm/string/predicate.hpp>
 
 #include <boost/core/null_deleter.hpp>
 #include <boost/filesystem/exception.hpp>
@@ -197,5 +198,11 @@ bool match_flag_glob(const std::string &flag, const std::string &glob)
     return m.size() == 1;
 }
 
+bool is_relative(const boost::filesystem::path &filepath,
+    const boost::filesystem::path &directory)
+{
+    return boost::starts_with(filepath, directory);
+}
+
 } // namespace util
 } // namespace clang_include_graph
@@ -61,6 +61,12 @@ void setup_logging(
 std::regex glob_to_regex(const std::string &glob_pattern);
 
 bool match_flag_glob(const std::string &flag, const std::string &glob);
+
+/**
+ * Check whether path is inside of a directory, comparing path elements.
+ */
+bool is_relative(const boost::filesystem::path &filepath,
+    const boost::filesystem::path &directory);
 } // namespace util
 } // namespace clang_include_graph
 
@@ -0,0 +1,142 @@
+/**
+ * src/vertex_properties.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vertex_properties.h"
+
+#include <algorithm>
+
+namespace clang_include_graph {
+
+constexpr vertex_properties_t::flags_t vertex_properties_t::system_header;
+constexpr vertex_properties_t::flags_t vertex_properties_t::translation_unit;
+constexpr vertex_properties_t::vertex_index_t vertex_properties_t::no_end;
+constexpr std::size_t vertex_properties_t::flags_count;
+constexpr std::size_t vertex_properties_t::word_size;
+
+namespace {
+unsigned count_trailing_zeros(std::uint64_t word) noexcept
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+    unsigned result{0};
+    for (; (word & 1U) == 0; word >>= 1U)
+        result++;
+    return result;
+#endif
+}
+} // namespace
+
+void vertex_properties_t::push_back(
+    path_id_t file, path_id_t include_spelling, flags_t flags)
+{
+    const auto v = files_.size();
+    files_.push_back(file);
+    include_spellings_.push_back(include_spelling);
+
+    for (auto flag = 0U; flag < flags_count; flag++) {
+        auto &bits = flags_[flag];
+        if (v % word_size == 0)
+            bits.push_back(0U);
+        if ((flags & (1U << flag)) != 0U)
+            bits.back() |= std::uint64_t{1} << (v % word_size);
+    }
+}
+
+path_id_t vertex_properties_t::file(vertex_index_t v) const noexcept
+{
+    return files_[v];
+}
+
+path_id_t vertex_properties_t::include_spelling(
+    vertex_index_t v) const noexcept
+{
+    return include_spellings_[v];
+}
+
+bool vertex_properties_t::is_system_header(vertex_index_t v) const noexcept
+{
+    return has_flags(v, system_header);
+}
+
+bool vertex_properties_t::is_translation_unit(vertex_index_t v) const noexcept
+{
+    return has_flags(v, translation_unit);
+}
+
+bool vertex_properties_t::has_flags(
+    vertex_index_t v, flags_t flags) const noexcept
+{
+    for (auto flag = 0U; flag < flags_count; flag++) {
+        if ((flags & (1U << flag)) != 0U &&
+            ((flags_[flag][v / word_size] >> (v % word_size)) & 1U) == 0U)
+            return false;
+    }
+
+    return true;
+}
+
+std::vector<vertex_properties_t::vertex_index_t> vertex_properties_t::select(
+    flags_t required, flags_t excluded, vertex_index_t end) const
+{
+    end = std::min(end, size());
+
+    std::vector<vertex_index_t> result;
+
+    const auto words_count = (end + word_size - 1) / word_size;
+    for (std::size_t w = 0; w < words_count; w++) {
+        auto word = ~std::uint64_t{0};
+        for (auto flag = 0U; flag < flags_count; flag++) {
+            if ((required & (1U << flag)) != 0U)
+                word &= flags_[flag][w];
+            if ((excluded & (1U << flag)) != 0U)
+                word &= ~flags_[flag][w];
+        }
+
+        // Clear bits past the end in the last word
+        const auto remaining = end - w * word_size;
+        if (remaining < word_size)
+            word &= (std::uint64_t{1} << remaining) - 1U;
+
+        for (; word != 0U; word &= word - 1U)
+            result.push_back(w * word_size + count_trailing_zeros(word));
+    }
+
+    return result;
+}
+
+std::vector<vertex_properties_t::vertex_index_t>
+vertex_properties_t::translation_units(vertex_index_t end) const
+{
+    return select(translation_unit, 0U, end);
+}
+
+std::size_t vertex_properties_t::size() const noexcept
+{
+    return files_.size();
+}
+
+void vertex_properties_t::clear()
+{
+    files_.clear();
+    include_spellings_.clear();
+    for (auto &bits : flags_)
+        bits.clear();
+}
+
+} // namespace clang_include_graph
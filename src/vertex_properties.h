@@ -0,0 +1,89 @@
+/**
+ * src/vertex_properties.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_VERTEX_PROPERTIES_H
+#define CLANG_INCLUDE_GRAPH_VERTEX_PROPERTIES_H
+
+#include "path_table.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Properties of include graph vertices, stored in parallel arrays indexed
+ * by vertex descriptors.
+ *
+ * Each flag is packed in a bitset of its own, so filters such as "all
+ * translation units" test the flags of 64 vertices with a single word
+ * instead of reading the properties of every vertex.
+ */
+class vertex_properties_t {
+public:
+    using vertex_index_t = std::size_t;
+    using flags_t = unsigned;
+
+    static constexpr flags_t system_header{1U};
+    static constexpr flags_t translation_unit{2U};
+
+    void push_back(path_id_t file, path_id_t include_spelling, flags_t flags);
+
+    path_id_t file(vertex_index_t v) const noexcept;
+
+    path_id_t include_spelling(vertex_index_t v) const noexcept;
+
+    bool is_system_header(vertex_index_t v) const noexcept;
+
+    bool is_translation_unit(vertex_index_t v) const noexcept;
+
+    /**
+     * Get vertices below `end` with all of the `required` flags and none of
+     * the `excluded` flags, in the order of their indices.
+     */
+    std::vector<vertex_index_t> select(flags_t required,
+        flags_t excluded = 0U, vertex_index_t end = no_end) const;
+
+    /**
+     * Get vertices of translation units below `end`.
+     */
+    std::vector<vertex_index_t> translation_units(
+        vertex_index_t end = no_end) const;
+
+    std::size_t size() const noexcept;
+
+    void clear();
+
+private:
+    static constexpr vertex_index_t no_end{~vertex_index_t{0}};
+    static constexpr std::size_t flags_count{2};
+    static constexpr std::size_t word_size{64};
+
+    bool has_flags(vertex_index_t v, flags_t flags) const noexcept;
+
+    std::vector<path_id_t> files_;
+    std::vector<path_id_t> include_spellings_;
+    // Bitset of each flag, the flag with value `1 << i` is at index `i`
+    std::array<std::vector<std::uint64_t>, flags_count> flags_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_VERTEX_PROPERTIES_H
@@ -0,0 +1,268 @@
+/**
+ * src/vertex_table.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "vertex_table.h"
+
+#include <boost/functional/hash.hpp>
+
+#include <algorithm>
+#include <tuple>
+
+namespace clang_include_graph {
+
+constexpr std::uint32_t vertex_table_t::no_index;
+constexpr std::size_t vertex_table_t::shards_count;
+
+namespace {
+constexpr vertex_table_t::vertex_id_t id_block_size{64};
+
+// Vertices with few edges are deduplicated every so many edges
+constexpr std::size_t min_unique_edges{16};
+
+std::atomic<std::uint64_t> next_generation{1};
+
+// Block of vertex IDs reserved by the current thread
+struct id_block_t {
+    std::uint64_t generation{0};
+    vertex_table_t::vertex_id_t next{0};
+    vertex_table_t::vertex_id_t end{0};
+};
+
+thread_local id_block_t id_block;
+} // namespace
+
+vertex_table_t::vertex_table_t()
+    : generation_{next_generation++}
+{
+}
+
+std::size_t vertex_table_t::path_hash_t::operator()(
+    boost::string_view path) const noexcept
+{
+    return boost::hash_range(path.begin(), path.end());
+}
+
+std::size_t vertex_table_t::shard_index(boost::string_view path) noexcept
+{
+    return path_hash_t{}(path) % shards_count;
+}
+
+std::uint64_t vertex_table_t::reserve_sequence(std::uint64_t count) noexcept
+{
+    return next_sequence_.fetch_add(count, std::memory_order_relaxed);
+}
+
+std::pair<vertex_table_t::vertex_t *, bool> vertex_table_t::emplace(
+    const std::string &path, std::uint64_t sequence)
+{
+    auto &shard = shards_[shard_index(path)];
+
+    const std::lock_guard<std::mutex> guard{shard.mutex};
+
+    // Most paths are already in the table, and emplace would allocate the
+    // entry before finding out
+    const auto existing = shard.vertices.find(path);
+    if (existing != shard.vertices.end())
+        return {&existing->second, false};
+
+    const auto it = shard.vertices.emplace(std::piecewise_construct,
+        std::forward_as_tuple(shard.paths.store(path)),
+        std::forward_as_tuple());
+    auto &vertex = it.first->second;
+    vertex.id = allocate_id();
+    vertex.sequence = sequence;
+    shard.added.emplace_back(it.first->first, &vertex);
+    set_pending();
+
+    return {&vertex, true};
+}
+
+vertex_table_t::vertex_t &vertex_table_t::insert(const std::string &path)
+{
+    auto &shard = shards_[shard_index(path)];
+
+    const auto it = shard.vertices.emplace(std::piecewise_construct,
+        std::forward_as_tuple(shard.paths.store(path)),
+        std::forward_as_tuple());
+    auto &vertex = it.first->second;
+    vertex.id = allocate_id();
+    vertex.sequence = reserve_sequence(1);
+    assign_index(vertex);
+
+    return vertex;
+}
+
+void vertex_table_t::add_edge(vertex_t &from, const vertex_t &to,
+    bool is_system, std::uint64_t sequence)
+{
+    const std::lock_guard<std::mutex> guard{from.mutex};
+
+    if (from.edges.empty()) {
+        from.next_pending = pending_sources_.load(std::memory_order_relaxed);
+        while (!pending_sources_.compare_exchange_weak(
+            from.next_pending, &from, std::memory_order_release)) {
+        }
+        set_pending();
+    }
+
+    from.edges.push_back({to.id, is_system, sequence});
+
+    // Keeps the vector within twice the number of distinct edges, while
+    // each edge is sorted a constant number of times on average
+    if (from.edges.size() >=
+        2 * std::max(from.unique_edges, min_unique_edges))
+        deduplicate_edges(from);
+}
+
+const vertex_table_t::vertex_t *vertex_table_t::find(
+    const std::string &path) const
+{
+    const auto &shard = shards_[shard_index(path)];
+
+    const auto it = shard.vertices.find(path);
+    if (it == shard.vertices.end())
+        return nullptr;
+
+    return &it->second;
+}
+
+vertex_table_t::vertex_t &vertex_table_t::at(std::uint32_t index)
+{
+    return *by_index_[index];
+}
+
+bool vertex_table_t::has_pending() const noexcept
+{
+    return has_pending_.load(std::memory_order_acquire);
+}
+
+void vertex_table_t::flush(
+    std::vector<std::pair<boost::string_view, const vertex_t *>> &vertices,
+    std::vector<flushed_edge_t> &edges)
+{
+    vertices.clear();
+    edges.clear();
+
+    std::vector<std::pair<boost::string_view, vertex_t *>> added;
+    for (auto &shard : shards_) {
+        added.insert(added.end(), shard.added.begin(), shard.added.end());
+        shard.added.clear();
+    }
+
+    std::sort(added.begin(), added.end(),
+        [](const auto &lhs, const auto &rhs) {
+            return lhs.second->sequence < rhs.second->sequence;
+        });
+
+    for (const auto &vertex : added) {
+        assign_index(*vertex.second);
+        vertices.emplace_back(vertex.first, vertex.second);
+    }
+
+    std::vector<std::pair<std::uint64_t, flushed_edge_t>> added_edges;
+    for (auto *source = pending_sources_.exchange(nullptr); source != nullptr;
+         source = source->next_pending) {
+        deduplicate_edges(*source);
+
+        for (const auto &edge : source->edges) {
+            added_edges.emplace_back(edge.sequence,
+                flushed_edge_t{
+                    source->index, by_id_[edge.target]->index, edge.is_system});
+        }
+        source->edges = std::vector<edge_t>{};
+        source->unique_edges = 0;
+    }
+
+    std::sort(added_edges.begin(), added_edges.end(),
+        [](const auto &lhs, const auto &rhs) { return lhs.first < rhs.first; });
+
+    edges.reserve(added_edges.size());
+    for (const auto &edge : added_edges)
+        edges.emplace_back(edge.second);
+
+    has_pending_.store(false, std::memory_order_release);
+}
+
+std::size_t vertex_table_t::size() const noexcept { return by_index_.size(); }
+
+void vertex_table_t::clear()
+{
+    for (auto &shard : shards_) {
+        shard.vertices.clear();
+        shard.added.clear();
+        shard.paths.reset();
+    }
+
+    generation_ = next_generation++;
+    next_id_block_ = 0;
+    next_sequence_ = 0;
+    pending_sources_ = nullptr;
+    has_pending_ = false;
+    by_index_.clear();
+    by_id_.clear();
+}
+
+vertex_table_t::vertex_id_t vertex_table_t::allocate_id()
+{
+    if (id_block.generation != generation_ || id_block.next == id_block.end) {
+        id_block.generation = generation_;
+        id_block.next = next_id_block_.fetch_add(
+            id_block_size, std::memory_order_relaxed);
+        id_block.end = id_block.next + id_block_size;
+    }
+
+    return id_block.next++;
+}
+
+void vertex_table_t::deduplicate_edges(vertex_t &vertex)
+{
+    auto &edges = vertex.edges;
+
+    std::sort(edges.begin(), edges.end(),
+        [](const edge_t &lhs, const edge_t &rhs) {
+            return std::tie(lhs.target, lhs.sequence) <
+                std::tie(rhs.target, rhs.sequence);
+        });
+    edges.erase(std::unique(edges.begin(), edges.end(),
+                    [](const edge_t &lhs, const edge_t &rhs) {
+                        return lhs.target == rhs.target;
+                    }),
+        edges.end());
+
+    vertex.unique_edges = edges.size();
+}
+
+void vertex_table_t::assign_index(vertex_t &vertex)
+{
+    vertex.index = static_cast<std::uint32_t>(by_index_.size());
+    by_index_.emplace_back(&vertex);
+
+    if (vertex.id >= by_id_.size())
+        by_id_.resize(vertex.id + 1, nullptr);
+    by_id_[vertex.id] = &vertex;
+}
+
+void vertex_table_t::set_pending() noexcept
+{
+    // Checked first, so that threads adding to a table which already has
+    // pending changes only read the flag
+    if (!has_pending_.load(std::memory_order_relaxed))
+        has_pending_.store(true, std::memory_order_relaxed);
+}
+
+} // namespace clang_include_graph
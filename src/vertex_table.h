@@ -0,0 +1,210 @@
+/**
+ * src/vertex_table.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_VERTEX_TABLE_H
+#define CLANG_INCLUDE_GRAPH_VERTEX_TABLE_H
+
+#include "arena.h"
+
+#include <boost/utility/string_view.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace clang_include_graph {
+
+/**
+ * Concurrent table of include graph vertices and their out edges, to
+ * which parser threads add include directives without locking the whole
+ * graph.
+ *
+ * Vertices are looked up by path in one of several shards, each with its
+ * own lock. IDs of new vertices are taken from blocks reserved by each
+ * thread, so threads don't update a shared counter for every vertex. Out
+ * edges are stored with their source vertex and added under the lock of
+ * that vertex only. Vertices and edges are added with a sequence number,
+ * by which `flush()` orders them as if they were added by one thread.
+ *
+ * The same include directive is usually added once for every translation
+ * unit including the file, so edges are appended to a vector of their
+ * source vertex, which is sorted and deduplicated whenever its size
+ * doubles, and once more by `flush()`. Only the first of repeated edges
+ * is kept, so the adjacency list receives each edge once.
+ */
+class vertex_table_t {
+public:
+    using vertex_id_t = std::uint32_t;
+
+    static constexpr std::uint32_t no_index{
+        std::numeric_limits<std::uint32_t>::max()};
+
+    struct edge_t {
+        vertex_id_t target;
+        bool is_system;
+        std::uint64_t sequence;
+    };
+
+    struct vertex_t {
+        vertex_id_t id{0};
+        std::uint64_t sequence{0};
+        // Index of the vertex in the adjacency list, set by `flush()`
+        std::uint32_t index{no_index};
+        std::string include_spelling;
+        bool is_system_header{false};
+        bool is_translation_unit{false};
+
+        // Guards the members below
+        std::mutex mutex;
+        // Edges added since the last `flush()`, the first `unique_edges`
+        // of which are sorted by target and have no duplicates
+        std::vector<edge_t> edges;
+        std::size_t unique_edges{0};
+        vertex_t *next_pending{nullptr};
+    };
+
+    /**
+     * Edge between adjacency list indices of its vertices.
+     */
+    struct flushed_edge_t {
+        std::uint32_t from;
+        std::uint32_t to;
+        bool is_system;
+    };
+
+    vertex_table_t();
+
+    vertex_table_t(const vertex_table_t &) = delete;
+    vertex_table_t &operator=(const vertex_table_t &) = delete;
+
+    /**
+     * Reserve `count` consecutive sequence numbers, e.g. for the vertices
+     * and edges of one translation unit, and return the first one.
+     */
+    std::uint64_t reserve_sequence(std::uint64_t count) noexcept;
+
+    /**
+     * Get the vertex of a path, adding it if it's not in the table yet.
+     * Properties of an added vertex are set by the caller, which is
+     * indicated by the second member of the result.
+     */
+    std::pair<vertex_t *, bool> emplace(
+        const std::string &path, std::uint64_t sequence);
+
+    /**
+     * Add vertex of a path which isn't in the table yet, and assign it the
+     * next adjacency list index right away. Must not be called
+     * concurrently with any other method.
+     */
+    vertex_t &insert(const std::string &path);
+
+    /**
+     * Add edge between two vertices. Edges repeated since the last
+     * `flush()` are removed later.
+     */
+    void add_edge(vertex_t &from, const vertex_t &to, bool is_system,
+        std::uint64_t sequence);
+
+    /**
+     * Get vertex of a path, or `nullptr` if the path isn't in the table.
+     * Must not be called concurrently with `emplace()`.
+     */
+    const vertex_t *find(const std::string &path) const;
+
+    /**
+     * Get vertex by its adjacency list index.
+     */
+    vertex_t &at(std::uint32_t index);
+
+    /**
+     * Whether any vertices or edges were added since the last `flush()`.
+     */
+    bool has_pending() const noexcept;
+
+    /**
+     * Assign adjacency list indices to vertices added since the last call
+     * and collect them along with their paths, and collect the edges added
+     * since the last call. Both are ordered by their sequence numbers.
+     * Must not be called concurrently with any other method.
+     */
+    void flush(
+        std::vector<std::pair<boost::string_view, const vertex_t *>> &vertices,
+        std::vector<flushed_edge_t> &edges);
+
+    /**
+     * Number of vertices with assigned adjacency list indices.
+     */
+    std::size_t size() const noexcept;
+
+    void clear();
+
+private:
+    struct path_hash_t {
+        std::size_t operator()(boost::string_view path) const noexcept;
+    };
+
+    // Each shard has its own lock to reduce contention between threads
+    struct shard_t {
+        std::mutex mutex;
+        // Paths of the shard's vertices, freed all at once by `clear()`
+        arena_t paths;
+        std::unordered_map<boost::string_view, vertex_t, path_hash_t>
+            vertices;
+        // Vertices added since the last `flush()`
+        std::vector<std::pair<boost::string_view, vertex_t *>> added;
+    };
+
+    static constexpr std::size_t shards_count{64};
+
+    static std::size_t shard_index(boost::string_view path) noexcept;
+
+    vertex_id_t allocate_id();
+
+    /**
+     * Sort edges of a vertex by target and remove all but the first added
+     * edge to each target.
+     */
+    static void deduplicate_edges(vertex_t &vertex);
+
+    void assign_index(vertex_t &vertex);
+
+    void set_pending() noexcept;
+
+    std::array<shard_t, shards_count> shards_;
+    // Distinguishes ID blocks reserved by threads from these of other
+    // tables, or of this table before it was cleared
+    std::uint64_t generation_;
+    std::atomic<vertex_id_t> next_id_block_{0};
+    std::atomic<std::uint64_t> next_sequence_{0};
+    // Sources of edges added since the last `flush()`
+    std::atomic<vertex_t *> pending_sources_{nullptr};
+    std::atomic<bool> has_pending_{false};
+    std::vector<vertex_t *> by_index_;
+    std::vector<vertex_t *> by_id_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_VERTEX_TABLE_H
@@ -0,0 +1,231 @@
+/**
+ * src/worker_message.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_message.h"
+#include "include_graph_parser.h"
+
+#if !defined(_WIN32)
+
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <unordered_map>
+
+namespace clang_include_graph {
+
+namespace {
+// Larger messages are treated as corrupted, instead of allocating memory
+// for them
+constexpr std::uint64_t max_message_size{1ULL << 32U};
+
+constexpr std::uint64_t from_translation_unit_flag{1U};
+constexpr std::uint64_t is_system_flag{2U};
+} // namespace
+
+bool write_all(int fd, const void *data, std::size_t size)
+{
+    const auto *ptr = static_cast<const char *>(data);
+    while (size > 0) {
+        const auto n = ::write(fd, ptr, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        ptr += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool read_all(int fd, void *data, std::size_t size)
+{
+    auto *ptr = static_cast<char *>(data);
+    while (size > 0) {
+        const auto n = ::read(fd, ptr, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        ptr += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+void message_writer_t::write(std::uint64_t value)
+{
+    for (auto i = 0U; i < sizeof(value); i++)
+        buffer_.push_back(static_cast<char>((value >> (8U * i)) & 0xFFU));
+}
+
+void message_writer_t::write(const std::string &value)
+{
+    write(static_cast<std::uint64_t>(value.size()));
+    buffer_.append(value);
+}
+
+bool message_writer_t::send(int fd) const
+{
+    message_writer_t size;
+    size.write(static_cast<std::uint64_t>(buffer_.size()));
+
+    return write_all(fd, size.buffer_.data(), size.buffer_.size()) &&
+        write_all(fd, buffer_.data(), buffer_.size());
+}
+
+bool message_reader_t::receive(int fd)
+{
+    std::array<unsigned char, sizeof(std::uint64_t)> size_bytes{};
+    if (!read_all(fd, size_bytes.data(), size_bytes.size()))
+        return false;
+
+    std::uint64_t size{0};
+    for (auto i = 0U; i < size_bytes.size(); i++)
+        size |= static_cast<std::uint64_t>(size_bytes[i]) << (8U * i);
+
+    if (size > max_message_size)
+        return false;
+
+    buffer_.resize(size);
+    position_ = 0;
+    return read_all(fd, &buffer_[0], buffer_.size());
+}
+
+std::uint64_t message_reader_t::read_uint64()
+{
+    std::uint64_t value{0};
+    if (position_ + sizeof(value) <= buffer_.size()) {
+        for (auto i = 0U; i < sizeof(value); i++) {
+            value |= static_cast<std::uint64_t>(
+                         static_cast<unsigned char>(buffer_[position_ + i]))
+                << (8U * i);
+        }
+    }
+    position_ += sizeof(value);
+    return value;
+}
+
+bool message_reader_t::is_truncated() const noexcept
+{
+    return position_ > buffer_.size();
+}
+
+std::string message_reader_t::read_string()
+{
+    const auto size = read_uint64();
+    if (position_ > buffer_.size() || size > buffer_.size() - position_) {
+        position_ = buffer_.size() + 1;
+        return {};
+    }
+    std::string value{buffer_.data() + position_, size};
+    position_ += size;
+    return value;
+}
+
+void write_statistics(
+    message_writer_t &message, const parse_statistics_t &statistics)
+{
+    message.write(statistics.translation_units.load());
+    message.write(statistics.parse_time_us.load());
+    message.write(statistics.full_parse_time_us.load());
+    message.write(statistics.scanned_translation_units.load());
+    message.write(statistics.scan_time_us.load());
+}
+
+void read_statistics(message_reader_t &message, parse_statistics_t &statistics)
+{
+    statistics.translation_units += message.read_uint64();
+    statistics.parse_time_us += message.read_uint64();
+    statistics.full_parse_time_us += message.read_uint64();
+    statistics.scanned_translation_units += message.read_uint64();
+    statistics.scan_time_us += message.read_uint64();
+}
+
+void write_edges(
+    message_writer_t &message, const std::vector<include_edge_t> &edges)
+{
+    // Most edges of a translation unit share their paths, so paths are
+    // written once in a table and edges refer to them by index
+    std::unordered_map<std::string, std::uint64_t> path_ids;
+    std::vector<const std::string *> paths;
+    const auto path_id = [&path_ids, &paths](const std::string &path) {
+        const auto it = path_ids.emplace(path, paths.size());
+        if (it.second)
+            paths.emplace_back(&it.first->first);
+        return it.first->second;
+    };
+
+    std::vector<std::uint64_t> edge_path_ids;
+    edge_path_ids.reserve(edges.size() * 2);
+    for (const auto &edge : edges) {
+        edge_path_ids.emplace_back(path_id(edge.to));
+        edge_path_ids.emplace_back(path_id(edge.from));
+    }
+
+    message.write(static_cast<std::uint64_t>(paths.size()));
+    for (const auto *path : paths)
+        message.write(*path);
+
+    message.write(static_cast<std::uint64_t>(edges.size()));
+    for (auto i = 0U; i < edges.size(); i++) {
+        const auto &edge = edges[i];
+
+        std::uint64_t flags{0};
+        if (edge.from_translation_unit)
+            flags |= from_translation_unit_flag;
+        if (edge.is_system)
+            flags |= is_system_flag;
+
+        message.write(flags);
+        message.write(edge_path_ids[2 * i]);
+        message.write(edge_path_ids[2 * i + 1]);
+        message.write(edge.include_spelling);
+    }
+}
+
+std::vector<include_edge_t> read_edges(message_reader_t &message)
+{
+    std::vector<std::string> paths;
+    const auto paths_size = message.read_uint64();
+    for (std::uint64_t i = 0; i < paths_size && !message.is_truncated(); i++)
+        paths.emplace_back(message.read_string());
+
+    const auto path = [&paths](std::uint64_t id) {
+        return id < paths.size() ? paths[id] : std::string{};
+    };
+
+    std::vector<include_edge_t> edges;
+    const auto edges_size = message.read_uint64();
+    for (std::uint64_t i = 0; i < edges_size && !message.is_truncated(); i++) {
+        include_edge_t edge;
+        const auto flags = message.read_uint64();
+        edge.from_translation_unit = (flags & from_translation_unit_flag) != 0U;
+        edge.is_system = (flags & is_system_flag) != 0U;
+        edge.to = path(message.read_uint64());
+        edge.from = path(message.read_uint64());
+        edge.include_spelling = message.read_string();
+        edges.emplace_back(std::move(edge));
+    }
+
+    return edges;
+}
+
+} // namespace clang_include_graph
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * src/worker_message.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_WORKER_MESSAGE_H
+#define CLANG_INCLUDE_GRAPH_WORKER_MESSAGE_H
+
+#include "include_graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace clang_include_graph {
+
+struct parse_statistics_t;
+
+/**
+ * Write all bytes to a pipe or socket, retrying interrupted and partial
+ * writes.
+ */
+bool write_all(int fd, const void *data, std::size_t size);
+
+/**
+ * Read exactly `size` bytes from a pipe or socket.
+ *
+ * @return False on error or end of file
+ */
+bool read_all(int fd, void *data, std::size_t size);
+
+/**
+ * Encodes a message exchanged with worker processes, as a size prefixed
+ * sequence of integers and strings. Integers are little endian, so that
+ * workers may run on other hosts.
+ */
+class message_writer_t {
+public:
+    void write(std::uint64_t value);
+
+    void write(const std::string &value);
+
+    bool send(int fd) const;
+
+private:
+    std::string buffer_;
+};
+
+class message_reader_t {
+public:
+    /**
+     * Wait for the next message.
+     *
+     * @return False on error, end of file or if the message is too large
+     */
+    bool receive(int fd);
+
+    /**
+     * Read the next integer, 0 if the message is truncated.
+     */
+    std::uint64_t read_uint64();
+
+    /**
+     * Read the next string, empty if the message is truncated.
+     */
+    std::string read_string();
+
+    /**
+     * Check whether more values were read than the message contains.
+     */
+    bool is_truncated() const noexcept;
+
+private:
+    std::string buffer_;
+    std::size_t position_{0};
+};
+
+void write_statistics(
+    message_writer_t &message, const parse_statistics_t &statistics);
+
+/**
+ * Add statistics from message to `statistics`.
+ */
+void read_statistics(message_reader_t &message, parse_statistics_t &statistics);
+
+/**
+ * Write include edges of a translation unit, with each distinct path
+ * written only once.
+ */
+void write_edges(
+    message_writer_t &message, const std::vector<include_edge_t> &edges);
+
+std::vector<include_edge_t> read_edges(message_reader_t &message);
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_WORKER_MESSAGE_H
@@ -0,0 +1,323 @@
+/**
+ * src/worker_pool.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "worker_pool.h"
+#include "include_graph_parser.h"
+#include "util.h"
+#include "worker_message.h"
+
+#if !defined(_WIN32)
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace clang_include_graph {
+
+worker_pool_t::worker_pool_t(
+    unsigned workers, std::chrono::seconds timeout, job_t job)
+    : workers_count_{std::max(workers, 1U)}
+    , timeout_{timeout}
+    , job_{std::move(job)}
+{
+}
+
+worker_pool_t::~worker_pool_t()
+{
+    for (auto &worker : workers_) {
+        if (worker.pid != -1)
+            stop_worker(worker, true);
+    }
+}
+
+bool worker_pool_t::start_worker(worker_t &worker)
+{
+    int request[2];  // NOLINT
+    int response[2]; // NOLINT
+
+    if (pipe(request) != 0)
+        return false;
+
+    if (pipe(response) != 0) {
+        close(request[0]);
+        close(request[1]);
+        return false;
+    }
+
+    const auto pid = fork();
+
+    if (pid < 0) {
+        close(request[0]);
+        close(request[1]);
+        close(response[0]);
+        close(response[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        close(request[1]);
+        close(response[0]);
+
+        // Don't keep pipes of other workers open, otherwise they wouldn't
+        // see the end of their request pipe on shutdown
+        for (const auto &other : workers_) {
+            if (other.request_fd != -1)
+                close(other.request_fd);
+            if (other.response_fd != -1)
+                close(other.response_fd);
+        }
+
+        worker_main(request[0], response[1]);
+    }
+
+    close(request[0]);
+    close(response[1]);
+
+    worker = worker_t{};
+    worker.pid = pid;
+    worker.request_fd = request[1];
+    worker.response_fd = response[0];
+
+    LOG(debug) << "Started worker process " << pid;
+
+    return true;
+}
+
+std::string worker_pool_t::stop_worker(worker_t &worker, bool kill)
+{
+    // Idle workers exit as soon as their request pipe is closed
+    close(worker.request_fd);
+
+    if (kill)
+        ::kill(worker.pid, SIGKILL);
+
+    close(worker.response_fd);
+
+    int status{0};
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) { }
+
+    std::string result;
+    if (WIFSIGNALED(status)) {
+        const auto signal_number = WTERMSIG(status);
+        result = "terminated by signal " + std::to_string(signal_number) +
+            " (" + strsignal(signal_number) + ")";
+    }
+    else {
+        result = "exited with status " + std::to_string(WEXITSTATUS(status));
+    }
+
+    LOG(debug) << "Worker process " << worker.pid << " " << result;
+
+    worker = worker_t{};
+
+    return result;
+}
+
+void worker_pool_t::worker_main(int request_fd, int response_fd)
+{
+    for (;;) {
+        std::uint64_t index{0};
+        if (!read_all(request_fd, &index, sizeof(index)))
+            _exit(0);
+
+        std::vector<include_edge_t> edges;
+        parse_statistics_t statistics;
+        std::string error;
+        bool success{false};
+
+        try {
+            success = job_(index, edges, statistics, error);
+        }
+        catch (const std::exception &e) {
+            error = e.what();
+        }
+
+        message_writer_t message;
+        message.write(success ? 1U : 0U);
+        write_statistics(message, statistics);
+
+        if (success) {
+            write_edges(message, edges);
+        }
+        else {
+            message.write(error);
+        }
+
+        // Exit without running destructors or atexit handlers, which
+        // belong to the supervisor
+        if (!message.send(response_fd))
+            _exit(1);
+    }
+}
+
+std::vector<failed_job_t> worker_pool_t::run(std::size_t job_count,
+    parse_statistics_t &statistics, const result_handler_t &on_result)
+{
+    std::vector<failed_job_t> failed_jobs;
+
+    // Writing to the request pipe of a crashed worker must not terminate
+    // the supervisor
+    auto *const previous_sigpipe_handler = signal(SIGPIPE, SIG_IGN);
+
+    workers_.resize(std::min<std::size_t>(workers_count_, job_count));
+
+    std::size_t next_job{0};
+    std::size_t finished_jobs{0};
+
+    while (finished_jobs < job_count) {
+        auto now = std::chrono::steady_clock::now();
+
+        for (auto &worker : workers_) {
+            if (worker.busy || next_job == job_count)
+                continue;
+
+            if (worker.pid == -1 && !start_worker(worker)) {
+                LOG(error) << "ERROR: Cannot start worker process: "
+                           << std::strerror(errno) << " - aborting..." << '\n';
+                exit(-1);
+            }
+
+            const auto index = static_cast<std::uint64_t>(next_job);
+            if (!write_all(worker.request_fd, &index, sizeof(index))) {
+                // The worker exited while idle, the job will be sent to
+                // its replacement
+                const auto pid = worker.pid;
+                LOG(warning) << "Worker process " << pid << " "
+                             << stop_worker(worker, true);
+                continue;
+            }
+
+            worker.busy = true;
+            worker.job = next_job++;
+            worker.job_start = now;
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<worker_t *> polled_workers;
+        int poll_timeout_ms{-1};
+
+        for (auto &worker : workers_) {
+            if (!worker.busy)
+                continue;
+
+            fds.push_back({worker.response_fd, POLLIN, 0});
+            polled_workers.push_back(&worker);
+
+            if (timeout_.count() > 0) {
+                const auto remaining_ms = std::max<std::int64_t>(0,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        worker.job_start + timeout_ - now)
+                        .count());
+                if (poll_timeout_ms < 0 || remaining_ms < poll_timeout_ms)
+                    poll_timeout_ms = static_cast<int>(remaining_ms);
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), poll_timeout_ms) < 0) {
+            if (errno == EINTR)
+                continue;
+
+            LOG(error) << "ERROR: Waiting for worker processes failed: "
+                       << std::strerror(errno) << " - aborting..." << '\n';
+            exit(-1);
+        }
+
+        now = std::chrono::steady_clock::now();
+
+        for (auto i = 0U; i < fds.size(); i++) {
+            auto &worker = *polled_workers[i];
+            const auto job = worker.job;
+            std::string reason;
+
+            if (fds[i].revents != 0) {
+                message_reader_t message;
+                if (message.receive(worker.response_fd)) {
+                    const auto success = message.read_uint64() == 1U;
+                    read_statistics(message, statistics);
+
+                    if (success) {
+                        worker.busy = false;
+                        finished_jobs++;
+
+                        auto edges = read_edges(message);
+
+                        on_result(job, edges,
+                            std::chrono::duration_cast<
+                                std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() -
+                                worker.job_start));
+                        continue;
+                    }
+
+                    // libclang state may be inconsistent after it recovered
+                    // from a crash, so the worker is replaced anyway
+                    reason = message.read_string();
+                    stop_worker(worker, false);
+                }
+                else {
+                    const auto pid = worker.pid;
+                    reason = "worker process " + std::to_string(pid) + " " +
+                        stop_worker(worker, true);
+                }
+            }
+            else if (timeout_.count() > 0 &&
+                now - worker.job_start >= timeout_) {
+                stop_worker(worker, true);
+                reason =
+                    "timed out after " + std::to_string(timeout_.count()) + "s";
+            }
+            else {
+                continue;
+            }
+
+            LOG(debug) << "Job " << job << " failed: " << reason;
+
+            failed_jobs.push_back({job, reason});
+            finished_jobs++;
+        }
+    }
+
+    for (auto &worker : workers_) {
+        if (worker.pid != -1)
+            stop_worker(worker, false);
+    }
+
+    signal(SIGPIPE, previous_sigpipe_handler);
+
+    std::sort(failed_jobs.begin(), failed_jobs.end(),
+        [](const auto &lhs, const auto &rhs) {
+            return lhs.index < rhs.index;
+        });
+
+    return failed_jobs;
+}
+
+} // namespace clang_include_graph
+
+#endif
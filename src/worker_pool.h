@@ -0,0 +1,126 @@
+/**
+ * src/worker_pool.h
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef CLANG_INCLUDE_GRAPH_WORKER_POOL_H
+#define CLANG_INCLUDE_GRAPH_WORKER_POOL_H
+
+#include "include_graph.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace clang_include_graph {
+
+struct parse_statistics_t;
+
+/**
+ * Job which could not be completed by a worker process.
+ */
+struct failed_job_t {
+    std::size_t index;
+    std::string reason;
+};
+
+/**
+ * Pool of forked worker processes, which run jobs in isolation from the
+ * supervisor process and from each other.
+ *
+ * The supervisor sends job indices to idle workers over a pipe and receives
+ * back the include edges and parse statistics of each job. A worker which
+ * crashes, or exceeds the job timeout and gets killed, is replaced by a new
+ * one and its current job is reported as failed, while the remaining jobs
+ * continue. Workers are forked from the supervisor, so a job function can
+ * refer to any state which was set up before `run()` is called.
+ *
+ * Only supported on POSIX systems.
+ */
+class worker_pool_t {
+public:
+    /**
+     * Function executed in a worker process for the job with given index.
+     *
+     * @return False and an error message if the job failed
+     */
+    using job_t = std::function<bool(std::size_t index,
+        std::vector<include_edge_t> &edges, parse_statistics_t &statistics,
+        std::string &error)>;
+
+    /**
+     * Function executed in the supervisor process for each completed job,
+     * along with the time elapsed since the job was sent to a worker.
+     */
+    using result_handler_t = std::function<void(std::size_t index,
+        std::vector<include_edge_t> &edges, std::chrono::microseconds elapsed)>;
+
+    /**
+     * @param workers Number of worker processes
+     * @param timeout Maximum time of a single job, 0 disables the timeout
+     * @param job Function executed by workers
+     */
+    worker_pool_t(unsigned workers, std::chrono::seconds timeout, job_t job);
+
+    ~worker_pool_t();
+    worker_pool_t(const worker_pool_t &) = delete;
+    worker_pool_t(worker_pool_t &&) = delete;
+    worker_pool_t &operator=(const worker_pool_t &) = delete;
+    worker_pool_t &operator=(worker_pool_t &&) = delete;
+
+    /**
+     * Run jobs with indices from 0 to `job_count` - 1 and wait until all of
+     * them complete or fail. Statistics reported by workers are added to
+     * `statistics`.
+     *
+     * @return Jobs which failed, ordered by job index
+     */
+    std::vector<failed_job_t> run(std::size_t job_count,
+        parse_statistics_t &statistics, const result_handler_t &on_result);
+
+private:
+    struct worker_t {
+        int pid{-1};
+        // Supervisor ends of the request and response pipes
+        int request_fd{-1};
+        int response_fd{-1};
+        bool busy{false};
+        std::size_t job{0};
+        std::chrono::steady_clock::time_point job_start;
+    };
+
+    bool start_worker(worker_t &worker);
+
+    /**
+     * Kill the worker if it's still running, wait for it to exit and return
+     * a description of how it terminated.
+     */
+    std::string stop_worker(worker_t &worker, bool kill);
+
+    [[noreturn]] void worker_main(int request_fd, int response_fd);
+
+    unsigned workers_count_;
+    std::chrono::seconds timeout_;
+    job_t job_;
+    std::vector<worker_t> workers_;
+};
+
+} // namespace clang_include_graph
+
+#endif // CLANG_INCLUDE_GRAPH_WORKER_POOL_H
@@ -0,0 +1,97 @@
+/**
+ * tests/test_arena.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of arena
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/arena.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace clang_include_graph;
+
+BOOST_AUTO_TEST_CASE(test_allocations_are_aligned_and_disjoint)
+{
+    arena_t arena{64};
+
+    const auto address = [](void *p) {
+        return reinterpret_cast<std::uintptr_t>(p);
+    };
+
+    const auto a = address(arena.allocate(3, 1));
+    const auto b = address(arena.allocate(8, 8));
+    const auto c = address(arena.allocate(32, 16));
+    // Larger than the maximum block size
+    auto *d = static_cast<char *>(arena.allocate(arena_t::max_block_size * 2));
+
+    BOOST_TEST(b % 8 == 0);
+    BOOST_TEST(c % 16 == 0);
+    BOOST_TEST(a + 3 <= b);
+    BOOST_TEST(b + 8 <= c);
+
+    d[0] = 'd';
+    d[arena_t::max_block_size * 2 - 1] = 'd';
+    BOOST_TEST(arena.capacity() >= arena_t::max_block_size * 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_strings_are_stored)
+{
+    arena_t arena;
+
+    std::string path{"/usr/include/stdio.h"};
+    const auto stored = arena.store(path);
+    path.clear();
+
+    BOOST_TEST(stored == "/usr/include/stdio.h");
+    BOOST_TEST(arena.store({}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_reset_reuses_blocks)
+{
+    arena_t arena{64};
+
+    std::vector<void *> first;
+    for (auto i = 0; i < 100; i++)
+        first.emplace_back(arena.allocate(16));
+
+    const auto capacity = arena.capacity();
+
+    arena.reset();
+
+    for (auto i = 0; i < 100; i++)
+        BOOST_TEST(arena.allocate(16) == first[i]);
+
+    BOOST_TEST(arena.capacity() == capacity);
+}
+
+BOOST_AUTO_TEST_CASE(test_containers_allocate_from_arena)
+{
+    arena_t arena;
+
+    std::vector<int, arena_allocator_t<int>> numbers{
+        arena_allocator_t<int>{arena}};
+    for (auto i = 0; i < 1000; i++)
+        numbers.push_back(i);
+
+    BOOST_TEST(numbers.size() == 1000);
+    BOOST_TEST(numbers[999] == 999);
+    BOOST_TEST(arena.capacity() >= 1000 * sizeof(int));
+}
@@ -0,0 +1,64 @@
+/**
+ * tests/test_compilation_database.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of compilation database functions
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/compilation_database.h"
+
+using namespace clang_include_graph;
+
+BOOST_AUTO_TEST_CASE(test_preprocessor_arguments_ignore_unrelated_flags)
+{
+    const std::vector<std::string> static_args{"/usr/bin/c++", "-I",
+        "include", "-DNDEBUG", "-std=c++17", "-O2", "-c", "src/a.cc", "-o",
+        "a.o"};
+    const std::vector<std::string> shared_args{"/usr/bin/c++", "-O3",
+        "-fPIC", "-Wall", "-Iinclude", "-D", "NDEBUG", "-std=c++17",
+        "-fsanitize=address", "-c", "src/a.cc", "-o", "shared/a.o"};
+
+    const auto expected = std::vector<std::string>{"/usr/bin/c++",
+        "-I/project/include", "-DNDEBUG", "-std=c++17", "-O"};
+
+    BOOST_TEST(get_preprocessor_arguments(static_args, "/project") ==
+        expected);
+    BOOST_TEST(get_preprocessor_arguments(shared_args, "/project") ==
+        expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_preprocessor_arguments_keep_related_flags)
+{
+    const std::vector<std::string> args{"clang++", "-isystem", "/opt/include",
+        "-include", "config.h", "-UDEBUG", "--target=aarch64-linux-gnu",
+        "--sysroot", "/sysroot", "-x", "c++", "-nostdinc++", "-Os", "-O0",
+        "-c", "a.cc"};
+
+    const auto expected = std::vector<std::string>{"clang++",
+        "-isystem/opt/include", "-include/project/config.h", "-UDEBUG",
+        "--target=aarch64-linux-gnu", "--sysroot/sysroot", "-xc++",
+        "-nostdinc++"};
+
+    BOOST_TEST(get_preprocessor_arguments(args, "/project") == expected);
+
+    // Only the last optimization level matters
+    const std::vector<std::string> optimized_args{
+        "clang++", "-O0", "-Oz", "-c", "a.cc"};
+    BOOST_TEST(get_preprocessor_arguments(optimized_args, "/project") ==
+        (std::vector<std::string>{"clang++", "-Os"}));
+}
@@ -0,0 +1,194 @@
+/**
+ * tests/test_coordinator.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of coordinator and remote workers
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../src/coordinator.h"
+#include "../src/include_graph_parser.h"
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace clang_include_graph;
+
+namespace {
+std::vector<remote_job_t> make_jobs(unsigned count)
+{
+    std::vector<remote_job_t> jobs;
+    for (auto i = 0U; i < count; i++) {
+        jobs.push_back({"/src/tu" + std::to_string(i) + ".cc", "/build",
+            {"clang++", "-DINDEX=" + std::to_string(i)}});
+    }
+    return jobs;
+}
+
+// Each translation unit includes a header named after its last argument
+bool parse_job(const remote_job_t &job, std::vector<include_edge_t> &edges,
+    parse_statistics_t &statistics, std::string & /*error*/)
+{
+    edges.push_back(
+        {job.directory + "/" + job.args.back() + ".h", job.tu_path,
+            job.args.back() + ".h", true, false});
+    statistics.translation_units++;
+    return true;
+}
+
+// Simulates a worker which crashes while parsing a translation unit
+pid_t start_crashing_worker(const endpoint_t &endpoint)
+{
+    const auto pid = fork();
+    if (pid == 0) {
+        run_remote_worker(endpoint, std::chrono::seconds{10},
+            [](const remote_job_t & /*job*/,
+                std::vector<include_edge_t> & /*edges*/,
+                parse_statistics_t & /*statistics*/,
+                std::string & /*error*/) -> bool { _exit(1); });
+        _exit(0);
+    }
+    return pid;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_parse_endpoint)
+{
+    BOOST_TEST(parse_endpoint("localhost:4000")->host == "localhost");
+    BOOST_TEST(parse_endpoint("localhost:4000")->port == "4000");
+    BOOST_TEST(parse_endpoint("[::1]:4000")->host == "::1");
+    BOOST_TEST(parse_endpoint("[::1]:4000")->to_string() == "[::1]:4000");
+    BOOST_TEST(parse_endpoint(":4000")->host.empty());
+    BOOST_TEST(
+        parse_endpoint("unix:/tmp/cig.sock")->unix_path == "/tmp/cig.sock");
+
+    BOOST_TEST(!parse_endpoint("localhost"));
+    BOOST_TEST(!parse_endpoint("localhost:http"));
+    BOOST_TEST(!parse_endpoint("unix:"));
+}
+
+BOOST_AUTO_TEST_CASE(test_jobs_are_distributed_to_workers)
+{
+    coordinator_t coordinator{*parse_endpoint("127.0.0.1:0")};
+    BOOST_TEST(coordinator.endpoint().port != "0");
+
+    // Boost.Test assertions are not thread safe
+    std::atomic<unsigned> disconnected_workers{0};
+    std::vector<std::thread> workers;
+    for (auto i = 0U; i < 3U; i++) {
+        workers.emplace_back([&coordinator, &disconnected_workers]() {
+            if (!run_remote_worker(coordinator.endpoint(),
+                    std::chrono::seconds{10}, parse_job))
+                disconnected_workers++;
+        });
+    }
+
+    const auto jobs = make_jobs(20);
+    std::map<std::size_t, std::vector<include_edge_t>> results;
+    parse_statistics_t statistics;
+
+    const auto failed_jobs = coordinator.run(jobs, statistics,
+        [&results](std::size_t index, std::vector<include_edge_t> &edges,
+            std::chrono::microseconds /*elapsed*/) {
+            BOOST_TEST(results.count(index) == 0);
+            results[index] = edges;
+        });
+
+    for (auto &worker : workers)
+        worker.join();
+
+    BOOST_TEST(disconnected_workers == 0U);
+    BOOST_TEST(failed_jobs.empty());
+    BOOST_TEST(results.size() == 20);
+    BOOST_TEST(statistics.translation_units == 20);
+    BOOST_TEST(coordinator.peak_workers() >= 1U);
+
+    const auto &edge = results.at(7).at(0);
+    BOOST_TEST(edge.from == "/src/tu7.cc");
+    BOOST_TEST(edge.to == "/build/-DINDEX=7.h");
+    BOOST_TEST(edge.include_spelling == "-DINDEX=7.h");
+    BOOST_TEST(edge.from_translation_unit);
+}
+
+BOOST_AUTO_TEST_CASE(test_jobs_of_lost_workers_are_reassigned)
+{
+    const auto socket_path = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("cig-%%%%-%%%%.sock");
+    coordinator_t coordinator{*parse_endpoint("unix:" + socket_path.string())};
+
+    // The second worker connects only after the first one crashed, so the
+    // job has to be reassigned to it
+    const auto crashing_worker = start_crashing_worker(coordinator.endpoint());
+
+    bool connected{false};
+    std::thread worker{[&coordinator, &connected, crashing_worker]() {
+        int status{0};
+        waitpid(crashing_worker, &status, 0);
+
+        connected = run_remote_worker(
+            coordinator.endpoint(), std::chrono::seconds{10}, parse_job);
+    }};
+
+    std::vector<std::size_t> results;
+    parse_statistics_t statistics;
+
+    const auto failed_jobs = coordinator.run(make_jobs(1), statistics,
+        [&results](std::size_t index, std::vector<include_edge_t> & /*edges*/,
+            std::chrono::microseconds /*elapsed*/) {
+            results.push_back(index);
+        });
+
+    worker.join();
+
+    BOOST_TEST(connected);
+    BOOST_TEST(failed_jobs.empty());
+    BOOST_TEST(results == std::vector<std::size_t>{0});
+}
+
+BOOST_AUTO_TEST_CASE(test_job_which_crashes_all_workers_fails)
+{
+    coordinator_t coordinator{*parse_endpoint("127.0.0.1:0")};
+
+    std::vector<pid_t> crashing_workers;
+    for (auto i = 0U; i < coordinator_t::max_attempts; i++)
+        crashing_workers.push_back(
+            start_crashing_worker(coordinator.endpoint()));
+
+    parse_statistics_t statistics;
+    const auto failed_jobs = coordinator.run(make_jobs(1), statistics,
+        [](std::size_t /*index*/, std::vector<include_edge_t> & /*edges*/,
+            std::chrono::microseconds /*elapsed*/) { BOOST_TEST(false); });
+
+    for (const auto pid : crashing_workers) {
+        int status{0};
+        waitpid(pid, &status, 0);
+    }
+
+    BOOST_TEST(failed_jobs.size() == 1);
+    BOOST_TEST(failed_jobs.at(0).index == 0);
+    BOOST_TEST(failed_jobs.at(0).reason ==
+        "lost connection to 3 workers parsing it");
+}
@@ -0,0 +1,155 @@
+/**
+ * tests/test_dag_view.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of DAG view
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/dag_view.h"
+
+#include <boost/graph/adjacency_list.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace clang_include_graph;
+
+namespace {
+struct edge_t {
+    bool is_system{false};
+};
+
+using graph_t = boost::adjacency_list<boost::setS, boost::vecS,
+    boost::bidirectionalS, boost::no_property, edge_t>;
+using ids = std::vector<frozen_graph_t::vertex_id_t>;
+
+ids to_vector(const dag_view_t::adjacency_t &adjacency)
+{
+    return {adjacency.begin(), adjacency.end()};
+}
+
+bool is_acyclic(const dag_view_t &dag)
+{
+    std::vector<frozen_graph_t::vertex_id_t> position(dag.vertex_count());
+    const auto order = dag.finish_order();
+    for (std::size_t i = 0; i < order.size(); i++)
+        position[order[i]] = static_cast<frozen_graph_t::vertex_id_t>(i);
+
+    // Every edge must go to a vertex finished earlier
+    for (frozen_graph_t::vertex_id_t v = 0; v < dag.vertex_count(); v++) {
+        for (const auto target : dag.out(v)) {
+            if (position[target] >= position[v])
+                return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_back_edges_are_masked)
+{
+    // 0 -> 2 -> 3, 0 -> 1 -> 3, 4 -> 1
+    graph_t graph{6};
+    boost::add_edge(0, 2, graph);
+    boost::add_edge(0, 1, graph);
+    boost::add_edge(2, 3, graph);
+    boost::add_edge(1, 3, graph);
+    boost::add_edge(4, 1, graph);
+    const frozen_graph_t frozen{graph};
+
+    std::vector<bool> is_back_edge(frozen.edge_count(), false);
+    is_back_edge[frozen.edge_index(0, 1)] = true;
+
+    const dag_view_t dag{frozen, is_back_edge};
+
+    BOOST_TEST(dag.vertex_count() == 6);
+    BOOST_TEST(dag.back_edge_count() == 1);
+    BOOST_TEST(dag.is_back_edge(frozen.edge_index(0, 1)));
+    BOOST_TEST(to_vector(dag.out(0)) == (ids{2}));
+    BOOST_TEST(to_vector(dag.out(1)) == (ids{3}));
+    BOOST_TEST(to_vector(dag.out(5)).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_cycles_are_broken_in_order_of_paths)
+{
+    // a.h -> b.h -> c.h -> a.h, c.h -> c.h, main.cc -> c.h
+    const std::vector<std::string> paths{"main.cc", "c.h", "b.h", "a.h"};
+    const auto path = [&paths](frozen_graph_t::vertex_id_t v) {
+        return paths[v];
+    };
+
+    graph_t graph{4};
+    boost::add_edge(0, 1, graph);
+    boost::add_edge(3, 2, graph);
+    boost::add_edge(2, 1, graph);
+    boost::add_edge(1, 3, graph);
+    boost::add_edge(1, 1, graph);
+    const frozen_graph_t frozen{graph};
+
+    const dag_view_t dag{frozen, path};
+
+    // The search starts from a.h, so c.h -> a.h closes the cycle, even
+    // though main.cc enters the cycle through c.h
+    BOOST_TEST(dag.back_edge_count() == 2);
+    BOOST_TEST(dag.is_back_edge(frozen.edge_index(1, 3)));
+    BOOST_TEST(dag.is_back_edge(frozen.edge_index(1, 1)));
+    BOOST_TEST(to_vector(dag.out(0)) == (ids{1}));
+    BOOST_TEST(to_vector(dag.out(1)).empty());
+    BOOST_TEST(is_acyclic(dag));
+}
+
+BOOST_AUTO_TEST_CASE(test_back_edges_do_not_depend_on_vertex_order)
+{
+    // The same graph with vertices added in two different orders
+    const std::vector<std::pair<std::string, std::string>> edges{
+        {"a.h", "b.h"}, {"b.h", "c.h"}, {"c.h", "a.h"}, {"b.h", "d.h"},
+        {"d.h", "b.h"}, {"d.h", "a.h"}, {"main.cc", "d.h"}};
+    const std::vector<std::vector<std::string>> orders{
+        {"a.h", "b.h", "c.h", "d.h", "main.cc"},
+        {"main.cc", "d.h", "c.h", "b.h", "a.h"}};
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> kept;
+    for (const auto &order : orders) {
+        const auto index = [&order](const std::string &file) {
+            return static_cast<std::size_t>(
+                std::find(order.begin(), order.end(), file) - order.begin());
+        };
+
+        graph_t graph{order.size()};
+        for (const auto &edge : edges)
+            boost::add_edge(index(edge.first), index(edge.second), graph);
+        const frozen_graph_t frozen{graph};
+
+        const dag_view_t dag{frozen,
+            [&order](frozen_graph_t::vertex_id_t v) { return order[v]; }};
+        BOOST_TEST(is_acyclic(dag));
+
+        std::vector<std::pair<std::string, std::string>> dag_edges;
+        for (frozen_graph_t::vertex_id_t v = 0; v < dag.vertex_count(); v++) {
+            for (const auto target : dag.out(v))
+                dag_edges.emplace_back(order[v], order[target]);
+        }
+        std::sort(dag_edges.begin(), dag_edges.end());
+        kept.emplace_back(std::move(dag_edges));
+    }
+
+    // Searched from a.h, c.h -> a.h, d.h -> a.h and d.h -> b.h are removed
+    BOOST_TEST((kept[0] == kept[1]));
+    BOOST_TEST(kept[0].size() == edges.size() - 3);
+}
@@ -0,0 +1,129 @@
+/**
+ * tests/test_frozen_graph.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of frozen graph
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/frozen_graph.h"
+
+#include <boost/graph/adjacency_list.hpp>
+#include <boost/graph/topological_sort.hpp>
+
+#include <iterator>
+#include <vector>
+
+using namespace clang_include_graph;
+
+namespace {
+struct edge_t {
+    bool is_system{false};
+};
+
+using graph_t = boost::adjacency_list<boost::setS, boost::vecS,
+    boost::bidirectionalS, boost::no_property, edge_t>;
+
+graph_t make_graph()
+{
+    // 0 -> 2 -> 3, 0 -> 1 -> 3, 4 -> 1, 5
+    graph_t graph{6};
+    boost::add_edge(0, 2, edge_t{false}, graph);
+    boost::add_edge(0, 1, edge_t{true}, graph);
+    boost::add_edge(2, 3, edge_t{true}, graph);
+    boost::add_edge(1, 3, edge_t{false}, graph);
+    boost::add_edge(4, 1, edge_t{false}, graph);
+    return graph;
+}
+
+std::vector<frozen_graph_t::vertex_id_t> to_vector(
+    const frozen_graph_t::adjacency_t &adjacency)
+{
+    return {adjacency.begin(), adjacency.end()};
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_adjacency_matches_source_graph)
+{
+    using ids = std::vector<frozen_graph_t::vertex_id_t>;
+
+    const auto graph = make_graph();
+    const frozen_graph_t frozen{graph};
+
+    BOOST_TEST(frozen.vertex_count() == 6);
+    BOOST_TEST(frozen.edge_count() == 5);
+
+    BOOST_TEST(to_vector(frozen.out(0)) == (ids{1, 2}));
+    BOOST_TEST(to_vector(frozen.out(4)) == (ids{1}));
+    BOOST_TEST(frozen.out_degree(5) == 0);
+
+    BOOST_TEST(to_vector(frozen.in(1)) == (ids{0, 4}));
+    BOOST_TEST(to_vector(frozen.in(3)) == (ids{1, 2}));
+    BOOST_TEST(frozen.in_degree(0) == 0);
+
+    BOOST_TEST(frozen.is_system(0, 0));
+    BOOST_TEST(!frozen.is_system(0, 1));
+    BOOST_TEST(frozen.is_system(2, 0));
+    BOOST_TEST(!frozen.is_system(1, 0));
+}
+
+BOOST_AUTO_TEST_CASE(test_finish_order_matches_topological_sort)
+{
+    const auto graph = make_graph();
+    const frozen_graph_t frozen{graph};
+
+    std::vector<graph_t::vertex_descriptor> expected;
+    boost::topological_sort(graph, std::back_inserter(expected));
+
+    const auto order = frozen.finish_order();
+    BOOST_TEST(std::vector<graph_t::vertex_descriptor>(
+                   order.begin(), order.end()) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(test_edges_are_indexed_in_order_of_sources)
+{
+    const auto graph = make_graph();
+    const frozen_graph_t frozen{graph};
+
+    BOOST_TEST(frozen.edge_index(2, 3) == 3);
+    BOOST_TEST(frozen.edge_index(3, 2) == frozen.edge_count());
+
+    BOOST_TEST(frozen.first_out_edge(2) == 3);
+    BOOST_TEST(frozen.target(frozen.first_out_edge(2)) == 3);
+    BOOST_TEST(frozen.first_out_edge(6) == frozen.edge_count());
+}
+
+BOOST_AUTO_TEST_CASE(test_strong_components_are_in_reverse_topological_order)
+{
+    // 0 -> 1 -> 2 -> 1, 2 -> 3 -> 3, 4
+    graph_t graph{5};
+    boost::add_edge(0, 1, graph);
+    boost::add_edge(1, 2, graph);
+    boost::add_edge(2, 1, graph);
+    boost::add_edge(2, 3, graph);
+    boost::add_edge(3, 3, graph);
+    const frozen_graph_t frozen{graph};
+
+    const auto component = frozen.strong_components();
+
+    BOOST_TEST(component[1] == component[2]);
+    BOOST_TEST(component[0] != component[1]);
+    BOOST_TEST(component[3] != component[1]);
+    BOOST_TEST(component[3] < component[1]);
+    BOOST_TEST(component[1] < component[0]);
+    BOOST_TEST(component[4] == 3);
+}
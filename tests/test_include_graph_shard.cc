@@ -0,0 +1,202 @@
+/**
+ * tests/test_include_graph_shard.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of include graph shards
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/include_graph_shard.h"
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+using namespace clang_include_graph;
+
+namespace {
+// Edges as (from, to, is_system) tuples, in the include direction
+std::set<std::tuple<std::string, std::string, bool>> edges_of(
+    const include_graph_t &include_graph)
+{
+    const auto &graph = include_graph.graph().graph();
+    const auto is_reversed = include_graph.printer() == printer_t::reverse_tree;
+
+    std::set<std::tuple<std::string, std::string, bool>> result;
+    for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+        auto from = include_graph.file(boost::source(e, graph));
+        auto to = include_graph.file(boost::target(e, graph));
+        if (is_reversed)
+            std::swap(from, to);
+        result.emplace(from, to, graph[e].is_system);
+    }
+    return result;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_partial_graph_round_trip)
+{
+    config_t config;
+
+    include_graph_t graph;
+    graph.init(config);
+    graph.add_edge(
+        "/src/include1.h", "/src/main.cc", std::string{"include1.h"}, true);
+    graph.add_edge("/usr/include/vector", "/src/main.cc",
+        std::string{"vector"}, true, true);
+    graph.add_edge(
+        "/src/include2.h", "/src/include1.h", std::string{"include2.h"});
+
+    std::stringstream ss;
+    write_partial_include_graph(ss, graph);
+
+    include_graph_t result;
+    result.init(config);
+    BOOST_TEST(read_partial_include_graph(ss, config, result));
+
+    BOOST_TEST(boost::num_vertices(result.graph().graph()) == 4);
+    BOOST_TEST((edges_of(result) == edges_of(graph)));
+
+    const auto &properties = result.vertex_properties();
+    const auto main_cc = result.vertex("/src/main.cc");
+    BOOST_TEST(properties.is_translation_unit(main_cc));
+    const auto vector = result.vertex("/usr/include/vector");
+    BOOST_TEST(properties.is_system_header(vector));
+    BOOST_TEST(result.include_spelling(vector) == "vector");
+}
+
+BOOST_AUTO_TEST_CASE(test_partial_graphs_are_merged_by_path)
+{
+    config_t config;
+
+    include_graph_t shard1;
+    shard1.init(config);
+    shard1.add_edge(
+        "/src/common.h", "/src/a.cc", std::string{"common.h"}, true);
+    shard1.add_edge("/src/util.h", "/src/common.h", std::string{"util.h"});
+
+    include_graph_t shard2;
+    shard2.init(config);
+    shard2.add_edge(
+        "/src/./common.h", "/src/b.cc", std::string{"common.h"}, true);
+    shard2.add_edge(
+        "/src/util.h", "/src/../src/common.h", std::string{"util.h"});
+
+    std::stringstream ss1;
+    write_partial_include_graph(ss1, shard1);
+    std::stringstream ss2;
+    write_partial_include_graph(ss2, shard2);
+
+    include_graph_t result;
+    result.init(config);
+    BOOST_TEST(read_partial_include_graph(ss1, config, result));
+    BOOST_TEST(read_partial_include_graph(ss2, config, result));
+
+    BOOST_TEST(boost::num_vertices(result.graph().graph()) == 4);
+    BOOST_TEST(boost::num_edges(result.graph().graph()) == 3);
+}
+
+BOOST_AUTO_TEST_CASE(test_partial_graph_direction_does_not_depend_on_printer)
+{
+    config_t reverse_config;
+    reverse_config.printer(printer_t::reverse_tree);
+
+    include_graph_t graph;
+    graph.init(reverse_config);
+    graph.add_edge(
+        "/src/include1.h", "/src/main.cc", std::string{"include1.h"}, true);
+    graph.add_edge(
+        "/src/include2.h", "/src/include1.h", std::string{"include2.h"});
+
+    std::stringstream ss;
+    write_partial_include_graph(ss, graph);
+
+    config_t config;
+    include_graph_t result;
+    result.init(config);
+    BOOST_TEST(read_partial_include_graph(ss, config, result));
+
+    BOOST_TEST((edges_of(result) == edges_of(graph)));
+}
+
+BOOST_AUTO_TEST_CASE(test_partial_graph_edges_are_filtered_when_merged)
+{
+    config_t config;
+
+    include_graph_t graph;
+    graph.init(config);
+    graph.add_edge(
+        "/src/include1.h", "/src/main.cc", std::string{"include1.h"}, true);
+    graph.add_edge("/usr/include/vector", "/src/main.cc",
+        std::string{"vector"}, true, true);
+
+    std::stringstream ss;
+    write_partial_include_graph(ss, graph);
+
+    config_t merge_config;
+    merge_config.exclude_system_headers(true);
+
+    include_graph_t result;
+    result.init(merge_config);
+    BOOST_TEST(read_partial_include_graph(ss, merge_config, result));
+
+    BOOST_TEST(boost::num_edges(result.graph().graph()) == 1);
+    BOOST_TEST(result.vertex("/usr/include/vector") ==
+        include_graph_t::graph_t::null_vertex());
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_partial_graph_is_rejected)
+{
+    config_t config;
+
+    std::stringstream not_a_graph{"digraph {}\n"};
+    include_graph_t result;
+    BOOST_TEST(!read_partial_include_graph(not_a_graph, config, result));
+
+    std::stringstream invalid_vertex{"clang-include-graph-partial-graph 1\n"
+                                     "V\t0\t/src/main.cc\t\n"
+                                     "E\t0\t0\t1\n"};
+    BOOST_TEST(!read_partial_include_graph(invalid_vertex, config, result));
+}
+
+BOOST_AUTO_TEST_CASE(test_translation_units_are_assigned_to_one_shard)
+{
+    const boost::filesystem::path directory{"/build"};
+
+    for (auto i = 0U; i < 100U; i++) {
+        const auto tu_path = "/src/file" + std::to_string(i) + ".cc";
+
+        auto shards = 0U;
+        for (auto number = 1U; number <= 3U; number++) {
+            if (is_in_shard(tu_path, directory, {number, 3U}))
+                shards++;
+        }
+        BOOST_TEST(shards == 1U);
+
+        BOOST_TEST(is_in_shard(tu_path, directory, {1U, 1U}));
+    }
+
+    // Assignment depends only on the path relative to the database directory
+    for (auto number = 1U; number <= 3U; number++) {
+        BOOST_TEST(
+            is_in_shard("/home/a/project/src/main.cc", "/home/a/project/build",
+                {number, 3U}) ==
+            is_in_shard("/ci/checkout/src/main.cc", "/ci/checkout/build",
+                {number, 3U}));
+    }
+}
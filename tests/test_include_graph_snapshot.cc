@@ -0,0 +1,193 @@
+/**
+ * tests/test_include_graph_snapshot.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of include graph snapshots
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/include_graph_snapshot.h"
+
+#include <boost/filesystem/operations.hpp>
+
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace clang_include_graph;
+
+namespace {
+// Edges as (from, to, is_system) tuples in the order of the edge list
+std::vector<std::tuple<std::string, std::string, bool>> edges_of(
+    const include_graph_t &include_graph)
+{
+    const auto &graph = include_graph.graph().graph();
+
+    std::vector<std::tuple<std::string, std::string, bool>> result;
+    for (auto e : boost::make_iterator_range(boost::edges(graph))) {
+        result.emplace_back(include_graph.file(boost::source(e, graph)),
+            include_graph.file(boost::target(e, graph)), graph[e].is_system);
+    }
+    return result;
+}
+
+void make_graph(include_graph_t &graph)
+{
+    graph.add_edge(
+        "/src/include1.h", "/src/main.cc", std::string{"include1.h"}, true);
+    graph.add_edge("/usr/include/vector", "/src/main.cc",
+        std::string{"vector"}, true, true);
+    graph.add_edge(
+        "/src/include2.h", "/src/include1.h", std::string{"include2.h"});
+    graph.add_edge(
+        "/src/include1.h", "/src/other.cc", std::string{"include1.h"}, true);
+}
+
+struct snapshot_file_t {
+    snapshot_file_t()
+        : path{boost::filesystem::temp_directory_path() /
+              boost::filesystem::unique_path("%%%%%%%%%%%%.cig")}
+    {
+    }
+
+    ~snapshot_file_t()
+    {
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+    }
+
+    snapshot_file_t(const snapshot_file_t &) = delete;
+    snapshot_file_t &operator=(const snapshot_file_t &) = delete;
+
+    boost::filesystem::path path;
+};
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_snapshot_round_trip)
+{
+    config_t config;
+
+    include_graph_t graph;
+    graph.init(config);
+    make_graph(graph);
+
+    const snapshot_file_t snapshot;
+    BOOST_TEST(save_include_graph(graph, snapshot.path));
+
+    include_graph_t result;
+    result.init(config);
+    std::string error;
+    BOOST_TEST(load_include_graph(snapshot.path, config, result, error));
+    BOOST_TEST(error.empty());
+
+    const auto &g = graph.graph().graph();
+    const auto &r = result.graph().graph();
+    BOOST_TEST(boost::num_vertices(r) == boost::num_vertices(g));
+    BOOST_TEST((edges_of(result) == edges_of(graph)));
+
+    // Vertices keep their descriptors, so printers output the same graph
+    const auto &gp = graph.vertex_properties();
+    const auto &rp = result.vertex_properties();
+    for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+        BOOST_TEST(result.file(v) == graph.file(v));
+        BOOST_TEST(result.include_spelling(v) == graph.include_spelling(v));
+        BOOST_TEST(rp.is_translation_unit(v) == gp.is_translation_unit(v));
+        BOOST_TEST(rp.is_system_header(v) == gp.is_system_header(v));
+        BOOST_TEST(result.vertex(graph.file(v)) == v);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_snapshot_direction_does_not_depend_on_printer)
+{
+    config_t reverse_config;
+    reverse_config.printer(printer_t::reverse_tree);
+
+    include_graph_t reversed;
+    reversed.init(reverse_config);
+    make_graph(reversed);
+
+    config_t config;
+    include_graph_t graph;
+    graph.init(config);
+    make_graph(graph);
+
+    const snapshot_file_t snapshot;
+    BOOST_TEST(save_include_graph(reversed, snapshot.path));
+
+    include_graph_t result;
+    result.init(config);
+    std::string error;
+    BOOST_TEST(load_include_graph(snapshot.path, config, result, error));
+
+    BOOST_TEST((edges_of(result) == edges_of(graph)));
+}
+
+BOOST_AUTO_TEST_CASE(test_snapshot_edges_are_filtered_when_loaded)
+{
+    config_t config;
+
+    include_graph_t graph;
+    graph.init(config);
+    make_graph(graph);
+
+    const snapshot_file_t snapshot;
+    BOOST_TEST(save_include_graph(graph, snapshot.path));
+
+    config_t load_config;
+    load_config.exclude_system_headers(true);
+
+    include_graph_t result;
+    result.init(load_config);
+    std::string error;
+    BOOST_TEST(load_include_graph(snapshot.path, load_config, result, error));
+
+    BOOST_TEST(boost::num_vertices(result.graph().graph()) == 4);
+    BOOST_TEST(boost::num_edges(result.graph().graph()) == 3);
+    BOOST_TEST(result.vertex("/usr/include/vector") ==
+        include_graph_t::graph_t::null_vertex());
+}
+
+BOOST_AUTO_TEST_CASE(test_invalid_snapshot_is_rejected)
+{
+    config_t config;
+    std::string error;
+
+    const snapshot_file_t not_a_snapshot;
+    {
+        std::ofstream ofs{not_a_snapshot.path.string()};
+        ofs << "clang-include-graph-partial-graph 1\n";
+    }
+    include_graph_t result;
+    result.init(config);
+    BOOST_TEST(!load_include_graph(not_a_snapshot.path, config, result, error));
+    BOOST_TEST(error == "not an include graph snapshot");
+
+    include_graph_t graph;
+    graph.init(config);
+    make_graph(graph);
+
+    const snapshot_file_t truncated;
+    BOOST_TEST(save_include_graph(graph, truncated.path));
+    boost::filesystem::resize_file(
+        truncated.path, boost::filesystem::file_size(truncated.path) - 1);
+    BOOST_TEST(!load_include_graph(truncated.path, config, result, error));
+    BOOST_TEST(error == "snapshot is truncated or corrupted");
+
+    BOOST_TEST(!load_include_graph(
+        "/non/existent/graph.cig", config, result, error));
+}
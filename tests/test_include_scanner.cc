@@ -0,0 +1,166 @@
+/**
+ * tests/test_include_scanner.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of include directive scanner
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../src/include_scanner.h"
+
+#include <fstream>
+
+using namespace clang_include_graph;
+
+namespace {
+file_directives_t lex(const std::string &source)
+{
+    return lex_directives(source.data(), source.size());
+}
+
+void write_file(const boost::filesystem::path &path, const std::string &content)
+{
+    boost::filesystem::create_directories(path.parent_path());
+    std::ofstream ofs{path.string()};
+    ofs << content;
+}
+
+bool has_edge(const std::vector<include_edge_t> &edges,
+    const boost::filesystem::path &from, const boost::filesystem::path &to)
+{
+    for (const auto &edge : edges) {
+        if (edge.from == from.string() && edge.to == to.string())
+            return true;
+    }
+    return false;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_lex_directives)
+{
+    const auto result = lex(R"(// #include "comment.h"
+/* #include "block_comment.h" */
+#include "a.h"
+  #  include <b.h>
+const char *s = "#include \"string.h\"";
+const char *r = R"x(
+#include "raw_string.h"
+)x";
+#define FOO(x) \
+    x + 1
+#pragma once
+#error not a tracked directive
+int x = FOO(1); # not a directive
+#if defined(FOO) && __has_include(<c.h>)
+#endif
+)");
+
+    const auto &directives = result.directives;
+    BOOST_REQUIRE_EQUAL(directives.size(), 6);
+
+    BOOST_TEST((directives[0].kind == directive_kind_t::include));
+    BOOST_TEST(directives[0].tokens[0].text == "\"a.h\"");
+
+    BOOST_TEST((directives[1].kind == directive_kind_t::include));
+    BOOST_TEST((directives[1].tokens[0].kind ==
+        pp_token_t::kind_t::header_name));
+    BOOST_TEST(directives[1].tokens[0].text == "<b.h>");
+
+    BOOST_TEST((directives[2].kind == directive_kind_t::define));
+    BOOST_REQUIRE_EQUAL(directives[2].tokens.size(), 7);
+    BOOST_TEST(directives[2].tokens[1].is_punctuator("("));
+    BOOST_TEST(!directives[2].tokens[1].has_leading_space);
+
+    BOOST_TEST((directives[3].kind == directive_kind_t::pragma_once));
+
+    BOOST_TEST((directives[4].kind == directive_kind_t::if_));
+    BOOST_TEST(directives[4].tokens.back().is_punctuator(")"));
+    BOOST_TEST(directives[4].tokens[7].text == "<c.h>");
+
+    BOOST_TEST((directives[5].kind == directive_kind_t::endif));
+}
+
+BOOST_AUTO_TEST_CASE(test_lex_include_guard)
+{
+    BOOST_TEST(lex("#ifndef A_H\n#define A_H\n#include \"b.h\"\n#endif\n")
+                   .include_guard == "A_H");
+
+    BOOST_TEST(lex("#if !defined(A_H)\n#define A_H\n#endif // A_H\n")
+                   .include_guard == "A_H");
+
+    BOOST_TEST(lex("#ifndef A_H\n#define A_H\n#endif\n#include \"b.h\"\n")
+                   .include_guard.empty());
+
+    BOOST_TEST(lex("#ifndef A_H\n#define A_H\n#else\n#endif\n")
+                   .include_guard.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_scan_translation_unit)
+{
+    const auto root = boost::filesystem::weakly_canonical(
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path());
+
+    write_file(root / "src" / "main.cc", R"(
+#include "a.h"
+#include "a.h"
+#if defined(USE_B) && USE_B > 1
+#include <b.h>
+#else
+#include "missing.h"
+#endif
+#define HEADER "c.h"
+#include HEADER
+#ifdef __cplusplus
+#include "d.h"
+#endif
+)");
+    write_file(root / "src" / "a.h", "#ifndef A_H\n#define A_H\n#endif\n");
+    write_file(root / "include" / "b.h",
+        "#pragma once\n#include \"../src/a.h\"\n");
+    write_file(root / "src" / "c.h", "");
+    write_file(root / "src" / "d.h", "");
+
+    include_scanner_t scanner;
+
+    std::vector<include_edge_t> edges;
+    const auto tu = root / "src" / "main.cc";
+    BOOST_REQUIRE(scanner.scan(tu, root.string(),
+        {"c++", "-Iinclude", "-DUSE_B=2", "-c", tu.string()}, edges));
+
+    BOOST_TEST(edges.size() == 6);
+    BOOST_TEST(has_edge(edges, tu, root / "src" / "a.h"));
+    BOOST_TEST(has_edge(edges, tu, root / "include" / "b.h"));
+    BOOST_TEST(
+        has_edge(edges, root / "include" / "b.h", root / "src" / "a.h"));
+    BOOST_TEST(has_edge(edges, tu, root / "src" / "c.h"));
+    BOOST_TEST(has_edge(edges, tu, root / "src" / "d.h"));
+
+    BOOST_TEST(edges[0].from_translation_unit);
+    BOOST_TEST(!edges[0].is_system);
+    BOOST_TEST(edges[2].is_system);
+    BOOST_TEST(edges[2].include_spelling == "b.h");
+
+    // Headers which cannot be found require fallback to libclang
+    edges.clear();
+    BOOST_TEST(!scanner.scan(
+        tu, root.string(), {"c++", "-Iinclude", "-c", tu.string()}, edges));
+    BOOST_TEST(edges.empty());
+
+    boost::filesystem::remove_all(root);
+}
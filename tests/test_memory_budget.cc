@@ -0,0 +1,84 @@
+/**
+ * tests/test_memory_budget.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of memory budget
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/memory_budget.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace clang_include_graph;
+
+BOOST_AUTO_TEST_CASE(test_memory_budget_adapts_to_measured_footprints)
+{
+    memory_budget_t budget{1000, 100, 300};
+
+    // Initial estimate allows 3 translation units
+    const auto first = budget.acquire();
+    const auto second = budget.acquire();
+    const auto third = budget.acquire();
+    BOOST_TEST(first == 300);
+    BOOST_TEST(budget.peak_admitted() == 3);
+
+    // Measured footprints are smaller, so the estimate drops to 150
+    budget.release(first, 100);
+    budget.release(second, 100);
+    BOOST_TEST(budget.acquire() == 150);
+    BOOST_TEST(budget.acquire() == 150);
+    BOOST_TEST(budget.acquire() == 150);
+    BOOST_TEST(budget.peak_admitted() == 4);
+    BOOST_TEST(budget.waits() == 0);
+
+    budget.release(third, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_budget_waits_for_release)
+{
+    memory_budget_t budget{1000, 0, 600};
+
+    const auto reserved = budget.acquire();
+
+    std::atomic<bool> admitted{false};
+    std::thread waiting{[&budget, &admitted]() {
+        const auto waiting_reserved = budget.acquire();
+        admitted = true;
+        budget.release(waiting_reserved, 0);
+    }};
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{50});
+    BOOST_TEST(!admitted);
+
+    budget.release(reserved, 0);
+    waiting.join();
+
+    BOOST_TEST(admitted);
+    BOOST_TEST(budget.waits() == 1);
+    BOOST_TEST(budget.peak_admitted() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_budget_always_admits_one)
+{
+    memory_budget_t budget{100, 200, 300};
+
+    const auto reserved = budget.acquire();
+    BOOST_TEST(reserved == 300);
+    budget.release(reserved, 0);
+}
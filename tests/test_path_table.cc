@@ -0,0 +1,83 @@
+/**
+ * tests/test_path_table.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of path table
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/path_table.h"
+
+#include <string>
+#include <vector>
+
+using namespace clang_include_graph;
+
+BOOST_AUTO_TEST_CASE(test_paths_are_decoded_as_interned)
+{
+    const std::vector<std::string> paths{"/usr/include/c++/12/vector",
+        "/usr/include/stdio.h", "relative/path.h", "file.h", "/", "",
+        "//double//slashes/", "C:\\windows\\style.h", "vector"};
+
+    path_table_t table;
+
+    std::vector<path_id_t> ids;
+    for (const auto &path : paths)
+        ids.emplace_back(table.intern(path));
+
+    for (auto i = 0U; i < paths.size(); i++) {
+        BOOST_TEST(table.path(ids[i]) == paths[i]);
+        BOOST_TEST(table.intern(paths[i]) == ids[i]);
+        BOOST_TEST(table.find(paths[i]).value() == ids[i]);
+    }
+
+    BOOST_TEST(table.path(path_table_t::empty_path).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_paths_share_parent_directories)
+{
+    path_table_t table;
+
+    const auto a = table.intern("/usr/include/a.h");
+    const auto size = table.size();
+
+    // Only the entry of the file is added for another file in the same
+    // directory
+    const auto b = table.intern("/usr/include/b.h");
+    BOOST_TEST(table.size() == size + 1);
+    BOOST_TEST(a != b);
+
+    // Directories are interned along with files
+    BOOST_TEST(table.find("/usr/include").has_value());
+    BOOST_TEST(table.path(*table.find("/usr/include")) == "/usr/include");
+}
+
+BOOST_AUTO_TEST_CASE(test_find_does_not_intern_paths)
+{
+    path_table_t table;
+    table.intern("/usr/include/a.h");
+    const auto size = table.size();
+
+    BOOST_TEST(!table.find("/usr/include/b.h").has_value());
+    BOOST_TEST(!table.find("/usr/lib").has_value());
+    BOOST_TEST(!table.find("usr/include/a.h").has_value());
+    BOOST_TEST(table.size() == size);
+
+    table.clear();
+    BOOST_TEST(!table.find("/usr/include/a.h").has_value());
+    BOOST_TEST(table.path(path_table_t::empty_path).empty());
+}
@@ -106,4 +106,68 @@ BOOST_AUTO_TEST_CASE(test_long_cyclic_graph_is_properly_sorted)
     BOOST_TEST(includes[2] == "include4.h");
     BOOST_TEST(includes[3] == "include1.h");
     BOOST_TEST(includes[4] == "main.cc");
-}
\ No newline at end of file
+}
+BOOST_AUTO_TEST_CASE(test_graph_built_from_edge_batches_is_properly_sorted)
+{
+    include_graph_t graph;
+
+    std::vector<include_edge_t> edges(3);
+    edges[0] = {"include1.h", "main.cc", "include1.h", true, false};
+    edges[1] = {"include2.h", "main.cc", "include2.h", true, false};
+    edges[2] = {"include3.h", "include1.h", "include3.h", false, false};
+    graph.add_edges(edges);
+    graph.add_edges({});
+
+    BOOST_TEST(graph.lock_statistics().acquisitions == 1);
+
+    graph.build_dag();
+
+    path_printer_t pp;
+
+    include_graph_topological_sort_printer_t p{graph, pp};
+
+    std::stringstream ss;
+    ss << p;
+
+    std::vector<std::string> includes;
+    read_lines(ss, includes);
+
+    BOOST_TEST(includes.size() == 4);
+    BOOST_TEST(includes[0] == "include3.h");
+    BOOST_TEST(includes[1] == "include1.h");
+    BOOST_TEST(includes[2] == "include2.h");
+    BOOST_TEST(includes[3] == "main.cc");
+}
+
+BOOST_AUTO_TEST_CASE(test_cleared_graph_is_properly_rebuilt)
+{
+    include_graph_t graph;
+
+    graph.add_edge("include1.h", "main.cc", true);
+    graph.add_edge("include2.h", "include1.h");
+    graph.build_dag();
+
+    graph.clear();
+
+    BOOST_TEST(!graph.dag());
+    BOOST_TEST(boost::num_vertices(graph.graph()) == 0);
+
+    graph.add_edge("include3.h", "main.cc", true);
+    graph.add_edge("include1.h", "main.cc", true);
+    graph.build_dag();
+
+    path_printer_t pp;
+
+    include_graph_topological_sort_printer_t p{graph, pp};
+
+    std::stringstream ss;
+    ss << p;
+
+    std::vector<std::string> includes;
+    read_lines(ss, includes);
+
+    BOOST_TEST(includes.size() == 3);
+    BOOST_TEST(includes[0] == "include3.h");
+    BOOST_TEST(includes[1] == "include1.h");
+    BOOST_TEST(includes[2] == "main.cc");
+}
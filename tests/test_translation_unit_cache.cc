@@ -0,0 +1,111 @@
+/**
+ * tests/test_translation_unit_cache.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of translation unit cache
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../src/translation_unit_cache.h"
+
+#include <fstream>
+
+using namespace clang_include_graph;
+
+namespace {
+void write_file(const boost::filesystem::path &path, const std::string &content)
+{
+    boost::filesystem::create_directories(path.parent_path());
+    std::ofstream ofs{path.string()};
+    ofs << content;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_cache_key)
+{
+    const auto key = translation_unit_cache_t::key(
+        "/src/main.cc", "/build", {"c++", "-Iinclude", "-o", "main.o"}, "0");
+
+    BOOST_TEST(key.size() == 16);
+
+    // Output files don't affect includes
+    BOOST_TEST(key ==
+        translation_unit_cache_t::key("/src/main.cc", "/build",
+            {"c++", "-Iinclude", "-o", "other/main.o"}, "0"));
+
+    BOOST_TEST(key !=
+        translation_unit_cache_t::key(
+            "/src/main.cc", "/build", {"c++", "-Iother", "-o", "main.o"}, "0"));
+    BOOST_TEST(key !=
+        translation_unit_cache_t::key("/src/main.cc", "/build",
+            {"c++", "-Iinclude", "-o", "main.o"}, "1"));
+}
+
+BOOST_AUTO_TEST_CASE(test_cache_load_and_store)
+{
+    const auto root = boost::filesystem::weakly_canonical(
+        boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path());
+
+    const auto tu = root / "main.cc";
+    const auto header = root / "a.h";
+    write_file(tu, "#include \"a.h\"\n");
+    write_file(header, "int a;\n");
+
+    std::vector<include_edge_t> edges(1);
+    edges[0] = {header.string(), tu.string(), "a.h", true, false};
+
+    std::vector<include_edge_t> loaded;
+    {
+        translation_unit_cache_t cache{root / "cache", 1024 * 1024};
+        BOOST_TEST(!cache.load("key", loaded));
+        cache.store("key", tu, edges);
+    }
+
+    {
+        translation_unit_cache_t cache{root / "cache", 1024 * 1024};
+        BOOST_REQUIRE(cache.load("key", loaded));
+        BOOST_REQUIRE(loaded.size() == 1);
+        BOOST_TEST(loaded[0].to == header.string());
+        BOOST_TEST(loaded[0].from == tu.string());
+        BOOST_TEST(loaded[0].include_spelling == "a.h");
+        BOOST_TEST(loaded[0].from_translation_unit);
+        BOOST_TEST(!loaded[0].is_system);
+        BOOST_TEST(cache.hits() == 1);
+    }
+
+    // Changing an included file invalidates the entry
+    write_file(header, "int b;\n");
+    {
+        translation_unit_cache_t cache{root / "cache", 1024 * 1024};
+        BOOST_TEST(!cache.load("key", loaded));
+        BOOST_TEST(cache.misses() == 1);
+
+        cache.store("key", tu, edges);
+    }
+
+    // Entries over the size limit are removed
+    {
+        translation_unit_cache_t cache{root / "cache", 0};
+        cache.collect_garbage();
+        BOOST_TEST(cache.evictions() == 1);
+        BOOST_TEST(!cache.load("key", loaded));
+    }
+
+    boost::filesystem::remove_all(root);
+}
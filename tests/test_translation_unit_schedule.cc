@@ -0,0 +1,88 @@
+/**
+ * tests/test_translation_unit_schedule.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of translation unit schedule
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "../src/translation_unit_schedule.h"
+
+#include <fstream>
+
+using namespace clang_include_graph;
+
+namespace {
+void write_file(const boost::filesystem::path &path, const std::string &content)
+{
+    boost::filesystem::create_directories(path.parent_path());
+    std::ofstream ofs{path.string()};
+    ofs << content;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_schedule_translation_units)
+{
+    const auto directory = boost::filesystem::temp_directory_path() /
+        boost::filesystem::unique_path("cig-schedule-%%%%-%%%%");
+    const auto timings_file = directory / "timings";
+
+    const std::vector<boost::filesystem::path> tu_paths{directory / "a/1.cc",
+        directory / "b/2.cc", directory / "a/3.cc", directory / "b/4.cc"};
+
+    write_file(timings_file,
+        "100\t" + tu_paths[0].string() + "\n300\t" + tu_paths[1].string() +
+            "\n200\t" + tu_paths[2].string() + "\n");
+    // Without history the parse time is estimated from the file size
+    write_file(tu_paths[3], std::string(4096, ' '));
+
+    parse_timings_t timings{timings_file};
+    timings.load();
+
+    BOOST_TEST(timings.expected_duration_us(tu_paths[1]) == 300);
+    BOOST_TEST(timings.expected_duration_us(tu_paths[3]) == 4);
+
+    BOOST_TEST(schedule_translation_units(
+                   tu_paths, schedule_t::database, timings) ==
+        (std::vector<std::size_t>{0, 1, 2, 3}));
+    BOOST_TEST(schedule_translation_units(tu_paths, schedule_t::lpt, timings) ==
+        (std::vector<std::size_t>{1, 2, 0, 3}));
+    BOOST_TEST(schedule_translation_units(
+                   tu_paths, schedule_t::locality, timings) ==
+        (std::vector<std::size_t>{1, 3, 2, 0}));
+
+    // Recorded times replace the history when saved
+    timings.record(tu_paths[0], 500);
+    timings.record(tu_paths[0], 400);
+    timings.save();
+
+    parse_timings_t saved_timings{timings_file};
+    saved_timings.load();
+    BOOST_TEST(saved_timings.expected_duration_us(tu_paths[0]) == 500);
+    BOOST_TEST(saved_timings.expected_duration_us(tu_paths[1]) == 300);
+
+    boost::filesystem::remove_all(directory);
+}
+
+BOOST_AUTO_TEST_CASE(test_ideal_makespan)
+{
+    BOOST_TEST(ideal_makespan_us({}, 4) == 0);
+    BOOST_TEST(ideal_makespan_us({10, 10, 10, 10}, 2) == 20);
+    BOOST_TEST(ideal_makespan_us({10, 10, 11}, 2) == 16);
+    BOOST_TEST(ideal_makespan_us({100, 1, 1}, 2) == 100);
+}
@@ -0,0 +1,99 @@
+/**
+ * tests/test_vertex_properties.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of vertex properties
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/vertex_properties.h"
+
+#include <vector>
+
+using namespace clang_include_graph;
+
+namespace {
+// Every third vertex is a translation unit, every fifth a system header
+vertex_properties_t make_properties(std::size_t count)
+{
+    vertex_properties_t properties;
+    for (std::size_t v = 0; v < count; v++) {
+        vertex_properties_t::flags_t flags{0U};
+        if (v % 3 == 0)
+            flags |= vertex_properties_t::translation_unit;
+        if (v % 5 == 0)
+            flags |= vertex_properties_t::system_header;
+        properties.push_back(static_cast<path_id_t>(v),
+            static_cast<path_id_t>(v + 1), flags);
+    }
+    return properties;
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(test_properties_are_stored_by_vertex)
+{
+    const auto properties = make_properties(200);
+
+    BOOST_TEST(properties.size() == 200);
+    for (std::size_t v = 0; v < 200; v++) {
+        BOOST_TEST(properties.file(v) == v);
+        BOOST_TEST(properties.include_spelling(v) == v + 1);
+        BOOST_TEST(properties.is_translation_unit(v) == (v % 3 == 0));
+        BOOST_TEST(properties.is_system_header(v) == (v % 5 == 0));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_vertices_are_selected_by_flags)
+{
+    const auto properties = make_properties(200);
+
+    std::vector<std::size_t> translation_units;
+    std::vector<std::size_t> non_system_translation_units;
+    std::vector<std::size_t> non_system_headers;
+    for (std::size_t v = 0; v < 200; v++) {
+        if (v % 3 == 0)
+            translation_units.emplace_back(v);
+        if (v % 3 == 0 && v % 5 != 0)
+            non_system_translation_units.emplace_back(v);
+        if (v % 5 != 0)
+            non_system_headers.emplace_back(v);
+    }
+
+    BOOST_TEST(properties.translation_units() == translation_units);
+    BOOST_TEST(properties.select(vertex_properties_t::translation_unit,
+                   vertex_properties_t::system_header) ==
+        non_system_translation_units);
+    BOOST_TEST(properties.select(0U, vertex_properties_t::system_header) ==
+        non_system_headers);
+
+    // Vertices at or past the end are not selected
+    const std::vector<std::size_t> first_translation_units{0, 3, 6, 9};
+    BOOST_TEST(properties.translation_units(10) == first_translation_units);
+    BOOST_TEST(properties.translation_units(1000) == translation_units);
+}
+
+BOOST_AUTO_TEST_CASE(test_clear_removes_all_vertices)
+{
+    auto properties = make_properties(70);
+    properties.clear();
+
+    BOOST_TEST(properties.size() == 0);
+    BOOST_TEST(properties.select(0U).empty());
+
+    properties.push_back(1, 2, vertex_properties_t::translation_unit);
+    BOOST_TEST(properties.translation_units() == std::vector<std::size_t>{0});
+}
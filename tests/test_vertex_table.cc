@@ -0,0 +1,191 @@
+/**
+ * tests/test_vertex_table.cc
+ *
+ * Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define BOOST_TEST_MODULE Unit test of vertex table
+
+#include <boost/test/unit_test.hpp>
+
+#include "../src/include_graph.h"
+#include "../src/vertex_table.h"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace clang_include_graph;
+
+BOOST_AUTO_TEST_CASE(test_vertices_and_edges_are_flushed_in_sequence_order)
+{
+    vertex_table_t table;
+
+    // Added out of order, as if by two threads
+    auto *b = table.emplace("b.h", 2).first;
+    auto *a = table.emplace("a.h", 0).first;
+    auto *main = table.emplace("main.cc", 1).first;
+
+    BOOST_TEST(table.emplace("a.h", 5).first == a);
+    BOOST_TEST(!table.emplace("a.h", 5).second);
+
+    table.add_edge(*main, *b, false, 2);
+    table.add_edge(*main, *a, true, 0);
+    table.add_edge(*main, *a, false, 4);
+
+    BOOST_TEST(table.has_pending());
+
+    std::vector<
+        std::pair<boost::string_view, const vertex_table_t::vertex_t *>>
+        vertices;
+    std::vector<vertex_table_t::flushed_edge_t> edges;
+    table.flush(vertices, edges);
+
+    BOOST_TEST(!table.has_pending());
+    BOOST_TEST(table.size() == 3);
+
+    BOOST_TEST(vertices.size() == 3);
+    BOOST_TEST(vertices[0].first == "a.h");
+    BOOST_TEST(vertices[1].first == "main.cc");
+    BOOST_TEST(vertices[2].first == "b.h");
+    BOOST_TEST(table.find("main.cc")->index == 1);
+    BOOST_TEST(&table.at(2) == b);
+    BOOST_TEST(table.find("c.h") == nullptr);
+
+    BOOST_TEST(edges.size() == 2);
+    BOOST_TEST(edges[0].from == 1);
+    BOOST_TEST(edges[0].to == 0);
+    BOOST_TEST(edges[0].is_system);
+    BOOST_TEST(edges[1].to == 2);
+
+    // Only edges added since the last flush are collected, including
+    // these repeating flushed edges
+    table.add_edge(*b, *a, false, 7);
+    table.add_edge(*main, *b, false, 6);
+    table.flush(vertices, edges);
+
+    BOOST_TEST(vertices.empty());
+    BOOST_TEST(edges.size() == 2);
+    BOOST_TEST(edges[0].from == 1);
+    BOOST_TEST(edges[1].from == 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_repeated_edges_keep_the_first_added_edge)
+{
+    constexpr auto targets_count = 20U;
+
+    vertex_table_t table;
+
+    auto *main = table.emplace("main.cc", 0).first;
+
+    std::vector<vertex_table_t::vertex_t *> targets;
+    for (auto i = 0U; i < targets_count; i++) {
+        targets.emplace_back(
+            table.emplace("include" + std::to_string(i) + ".h", i + 1)
+                .first);
+    }
+
+    // Enough repetitions to deduplicate the edges several times before
+    // the flush, with targets added in reverse order after the first round
+    std::uint64_t sequence{100};
+    for (auto round = 0U; round < 50; round++) {
+        for (auto i = 0U; i < targets_count; i++) {
+            const auto target = round == 0 ? i : targets_count - 1 - i;
+            table.add_edge(*main, *targets[target], round == 0, sequence++);
+        }
+    }
+
+    BOOST_TEST(main->edges.size() < 2 * 2 * targets_count);
+
+    std::vector<
+        std::pair<boost::string_view, const vertex_table_t::vertex_t *>>
+        vertices;
+    std::vector<vertex_table_t::flushed_edge_t> edges;
+    table.flush(vertices, edges);
+
+    BOOST_TEST(edges.size() == targets_count);
+    for (auto i = 0U; i < targets_count; i++) {
+        BOOST_TEST(edges[i].from == 0);
+        BOOST_TEST(edges[i].to == i + 1);
+        BOOST_TEST(edges[i].is_system);
+    }
+    BOOST_TEST(main->edges.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_vertices_are_added_once_by_concurrent_threads)
+{
+    constexpr auto threads_count = 8;
+    constexpr auto files_count = 200;
+
+    include_graph_t graph;
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < threads_count; t++) {
+        threads.emplace_back([&graph, t]() {
+            // Every thread adds the same edges, starting at another file
+            for (auto i = 0; i < files_count; i++) {
+                const auto file = (i + t * 25) % files_count;
+
+                std::vector<include_edge_t> edges;
+                edges.push_back({"header" + std::to_string(file) + ".h",
+                    "main" + std::to_string(file % 10) + ".cc", "", true,
+                    false});
+                edges.push_back({"common.h",
+                    "header" + std::to_string(file) + ".h", "", false,
+                    false});
+                graph.add_edges(edges);
+            }
+        });
+    }
+
+    for (auto &thread : threads)
+        thread.join();
+
+    const auto &g = graph.graph().graph();
+
+    BOOST_TEST(boost::num_vertices(g) == files_count + 10 + 1);
+    BOOST_TEST(boost::num_edges(g) == 2 * files_count);
+
+    std::set<std::string> files;
+    for (auto v : boost::make_iterator_range(boost::vertices(g))) {
+        files.emplace(graph.file(v));
+        BOOST_TEST(graph.vertex(graph.file(v)) == v);
+    }
+    BOOST_TEST(files.size() == boost::num_vertices(g));
+
+    BOOST_TEST(graph.lock_statistics().acquisitions >=
+        threads_count * files_count);
+}
+
+BOOST_AUTO_TEST_CASE(test_edges_repeated_after_flush_are_ignored)
+{
+    include_graph_t graph;
+
+    graph.add_edge("include1.h", "main.cc", true, true);
+    BOOST_TEST(boost::num_edges(graph.graph()) == 1);
+
+    graph.add_edge("include1.h", "main.cc", true, false);
+    graph.add_edge("include2.h", "main.cc", true, false);
+
+    const auto &g = graph.graph().graph();
+    BOOST_TEST(boost::num_edges(g) == 2);
+
+    const auto edge = boost::edge(
+        graph.vertex("main.cc"), graph.vertex("include1.h"), g);
+    BOOST_TEST(edge.second);
+    BOOST_TEST(g[edge.first].is_system);
+}
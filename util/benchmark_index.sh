@@ -0,0 +1,79 @@
+#!/bin/bash
+
+##
+## util/benchmark_index.sh
+##
+## Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+##
+## Licensed under the Apache License, Version 2.0 (the "License");
+## you may not use this file except in compliance with the License.
+## You may obtain a copy of the License at
+##
+##     http://www.apache.org/licenses/LICENSE-2.0
+##
+## Unless required by applicable law or agreed to in writing, software
+## distributed under the License is distributed on an "AS IS" BASIS,
+## WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+## See the License for the specific language governing permissions and
+## limitations under the License.
+##
+
+#
+# Compares parsing throughput with a single libclang index shared by all
+# threads against one index per thread, for an increasing number of jobs.
+#
+# Usage:
+#   util/benchmark_index.sh <compilation-database-dir> [jobs...]
+#
+# The binary can be overridden using CLANG_INCLUDE_GRAPH environment
+# variable (default: release/clang-include-graph), and each measurement is
+# repeated REPEAT times (default: 3) taking the best result.
+#
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 <compilation-database-dir> [jobs...]"
+  exit 1
+fi
+
+CLANG_INCLUDE_GRAPH=${CLANG_INCLUDE_GRAPH:-release/clang-include-graph}
+REPEAT=${REPEAT:-3}
+COMPILATION_DATABASE_DIR=$1
+shift
+
+if [ $# -gt 0 ]; then
+  JOBS=("$@")
+else
+  JOBS=()
+  for ((j = 1; j < $(nproc); j *= 2)); do
+    JOBS+=("$j")
+  done
+  JOBS+=("$(nproc)")
+fi
+
+# Prints the best wall time in milliseconds out of $REPEAT runs
+measure() {
+  local best=""
+  for ((i = 0; i < REPEAT; i++)); do
+    local start end elapsed
+    start=$(date +%s%N)
+    "$CLANG_INCLUDE_GRAPH" -d "$COMPILATION_DATABASE_DIR" \
+      --topological-sort "$@" > /dev/null
+    end=$(date +%s%N)
+    elapsed=$(( (end - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+  echo "$best"
+}
+
+printf "%6s %12s %12s %8s\n" "jobs" "shared [ms]" "per-thread" "speedup"
+
+for jobs in "${JOBS[@]}"; do
+  shared=$(measure -J "$jobs" --shared-index)
+  per_thread=$(measure -J "$jobs")
+  awk -v j="$jobs" -v s="$shared" -v p="$per_thread" \
+    'BEGIN { printf "%6s %12s %12s %7.2fx\n", j, s, p, s / p }'
+done
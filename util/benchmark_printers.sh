@@ -0,0 +1,82 @@
+#!/bin/bash
+
+##
+## util/benchmark_printers.sh
+##
+## Copyright (c) 2022-present Bartek Kryza <bkryza@gmail.com>
+##
+## Licensed under the Apache License, Version 2.0 (the "License");
+## you may not use this file except in compliance with the License.
+## You may obtain a copy of the License at
+##
+##     http://www.apache.org/licenses/LICENSE-2.0
+##
+## Unless required by applicable law or agreed to in writing, software
+## distributed under the License is distributed on an "AS IS" BASIS,
+## WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+## See the License for the specific language governing permissions and
+## limitations under the License.
+##
+
+#
+# Compares the time of printing an include graph saved with --save-graph
+# between two builds, e.g. before and after a change to the printers, so
+# that parsing doesn't affect the measurement.
+#
+# Usage:
+#   util/benchmark_printers.sh <snapshot> [printer options...]
+#
+# The binaries can be overridden using CLANG_INCLUDE_GRAPH (default:
+# release/clang-include-graph) and BASELINE (default:
+# baseline/clang-include-graph) environment variables, and each
+# measurement is repeated REPEAT times (default: 3) taking the best result.
+# Each printer option is measured separately (default: --topological-sort,
+# --reverse-tree and --tree).
+#
+
+set -e
+
+if [ $# -lt 1 ]; then
+  echo "Usage: $0 <snapshot> [printer options...]"
+  exit 1
+fi
+
+CLANG_INCLUDE_GRAPH=${CLANG_INCLUDE_GRAPH:-release/clang-include-graph}
+BASELINE=${BASELINE:-baseline/clang-include-graph}
+REPEAT=${REPEAT:-3}
+SNAPSHOT=$1
+shift
+
+if [ $# -gt 0 ]; then
+  PRINTERS=("$@")
+else
+  PRINTERS=(--topological-sort --reverse-tree --tree)
+fi
+
+# Prints the best wall time in milliseconds out of $REPEAT runs
+measure() {
+  local binary=$1
+  shift
+  local best=""
+  for ((i = 0; i < REPEAT; i++)); do
+    local start end elapsed
+    start=$(date +%s%N)
+    # shellcheck disable=SC2086
+    "$binary" --load-graph "$SNAPSHOT" $1 > /dev/null
+    end=$(date +%s%N)
+    elapsed=$(( (end - start) / 1000000 ))
+    if [ -z "$best" ] || [ "$elapsed" -lt "$best" ]; then
+      best=$elapsed
+    fi
+  done
+  echo "$best"
+}
+
+printf "%-40s %14s %12s %8s\n" "printer" "baseline [ms]" "new [ms]" "speedup"
+
+for printer in "${PRINTERS[@]}"; do
+  baseline=$(measure "$BASELINE" "$printer")
+  new=$(measure "$CLANG_INCLUDE_GRAPH" "$printer")
+  awk -v p="$printer" -v b="$baseline" -v n="$new" \
+    'BEGIN { printf "%-40s %14s %12s %7.2fx\n", p, b, n, b / n }'
+done